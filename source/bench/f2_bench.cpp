@@ -0,0 +1,245 @@
+// Times the CPU hot paths, so numbers quoted in change notes can be re-run:
+// f2_bench [suite [inputs...]]. With no arguments every synthetic suite
+// runs. Synthetic inputs come from a fixed seed; suites that need game data
+// take files extracted from the BNKs. Each case reports the best of several
+// runs.
+#include "BCDecode.h"
+#include "ModelParser.h"
+#include "PngEncode.h"
+#include "QoiEncode.h"
+#include "VertexDecode.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+    struct Rng {
+        uint64_t s = 0x9E3779B97F4A7C15ull;
+
+        uint32_t next() {
+            s ^= s << 13;
+            s ^= s >> 7;
+            s ^= s << 17;
+            return (uint32_t) (s >> 16);
+        }
+    };
+
+    std::vector<uint8_t> random_bytes(size_t n) {
+        Rng rng;
+        std::vector<uint8_t> out(n);
+        for (auto &b: out) b = (uint8_t) rng.next();
+        return out;
+    }
+
+    // Best wall time of `runs` calls after one warm-up, in milliseconds.
+    double best_ms(int runs, const std::function<void()> &fn) {
+        fn();
+        double best = 1e30;
+        for (int i = 0; i < runs; ++i) {
+            auto t0 = std::chrono::steady_clock::now();
+            fn();
+            auto t1 = std::chrono::steady_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::milli>(t1 - t0).count());
+        }
+        return best;
+    }
+
+    const char *format_name(BCFormat fmt) {
+        static const char *names[] = {"none", "bc1", "bc2", "bc3", "bc4", "bc5"};
+        return names[(int) fmt];
+    }
+
+    // Single-threaded decode of every format with every kernel the CPU has.
+    void bench_bc() {
+        const int w = 2048, h = 2048;
+        std::vector<uint8_t> rgba((size_t) w * h * 4);
+        std::printf("bc: %dx%d random blocks, one thread, MP/s\n", w, h);
+        for (BCFormat fmt: {BCFormat::BC1, BCFormat::BC2, BCFormat::BC3, BCFormat::BC4, BCFormat::BC5}) {
+            std::vector<uint8_t> src = random_bytes(bc_surface_bytes(fmt, w, h));
+            std::printf("  %s", format_name(fmt));
+            for (BCKernel k: {BCKernel::Scalar, BCKernel::SSE2, BCKernel::AVX2}) {
+                if (k > bc_best_kernel()) continue;
+                double ms = best_ms(5, [&] {
+                    bc_decode(fmt, src.data(), src.size(), w, h, rgba.data(), BCChannelOrder::RGBA, k, 1);
+                });
+                std::printf("  %s %.0f", bc_kernel_name(k), (double) w * h / 1e3 / ms);
+            }
+            std::printf("\n");
+        }
+    }
+
+    // Banded multi-threaded decode against the single-threaded result, which
+    // every thread count must reproduce byte for byte.
+    void bench_bc_bands() {
+        const int w = 4096, h = 4096;
+        std::vector<uint8_t> ref((size_t) w * h * 4), rgba(ref.size());
+        std::printf("bc-bands: %dx%d random blocks, best kernel, MP/s by thread count (0 = auto)\n", w, h);
+        for (BCFormat fmt: {BCFormat::BC1, BCFormat::BC3}) {
+            std::vector<uint8_t> src = random_bytes(bc_surface_bytes(fmt, w, h));
+            bc_decode(fmt, src.data(), src.size(), w, h, ref.data(), BCChannelOrder::RGBA, BCKernel::Auto, 1);
+            std::printf("  %s", format_name(fmt));
+            for (int threads: {1, 2, 4, 8, 0}) {
+                double ms = best_ms(5, [&] {
+                    bc_decode(fmt, src.data(), src.size(), w, h, rgba.data(), BCChannelOrder::RGBA, BCKernel::Auto, threads);
+                });
+                std::printf("  %d: %.0f%s", threads, (double) w * h / 1e3 / ms, rgba == ref ? "" : " MISMATCH");
+            }
+            std::printf("\n");
+        }
+    }
+
+    // Something texture-like for the encoders: smooth gradients with a little
+    // noise and a soft alpha edge, so neither runs nor noise dominate.
+    std::vector<uint8_t> synthetic_rgba(int w, int h) {
+        Rng rng;
+        std::vector<uint8_t> out((size_t) w * h * 4);
+        for (int y = 0; y < h; ++y) {
+            for (int x = 0; x < w; ++x) {
+                uint8_t *p = &out[((size_t) y * w + x) * 4];
+                uint32_t n = rng.next() & 7;
+                p[0] = (uint8_t) ((x * 255 / w + n) & 0xFF);
+                p[1] = (uint8_t) ((y * 255 / h + n) & 0xFF);
+                p[2] = (uint8_t) (((x ^ y) >> 4) & 0xFF);
+                p[3] = (uint8_t) (x < w / 2 ? 255 : std::max(0, 255 - (x - w / 2) / 2));
+            }
+        }
+        return out;
+    }
+
+    void bench_encode() {
+        const int w = 2048, h = 2048;
+        std::vector<uint8_t> rgba = synthetic_rgba(w, h), out;
+        const double mb = (double) rgba.size() / 1e6;
+        std::printf("encode: %dx%d synthetic RGBA, MB/s of input and output size\n", w, h);
+
+        double ms = best_ms(5, [&] { qoi_encode_rgba(rgba.data(), w, h, out); });
+        std::printf("  qoi           %6.0f MB/s  %.2f MB\n", mb / ms * 1e3, out.size() / 1e6);
+        for (int threads: {1, 0}) {
+            ms = best_ms(3, [&] { png_encode_rgba(rgba.data(), w, h, out, 6, threads); });
+            std::printf("  png l6 %s  %6.0f MB/s  %.2f MB\n", threads ? "1 thr" : "auto ", mb / ms * 1e3,
+                        out.size() / 1e6);
+        }
+    }
+
+    template<class Layout>
+    double vertex_mverts(const std::vector<uint8_t> &src, size_t count) {
+        std::vector<float> pos(count * 3), uv(count * 2), weights(count * 4);
+        std::vector<uint16_t> bones(count * 4);
+        VertexSink sink;
+        sink.position = pos.data();
+        sink.uv = uv.data();
+        if (Layout::skinned) {
+            sink.bone_ids = bones.data();
+            sink.bone_weights = weights.data();
+        }
+        double ms = best_ms(5, [&] { decode_mdl_vertices<Layout>(src.data(), count, sink); });
+        return (double) count / 1e3 / ms;
+    }
+
+    // Positions, UVs and skinning into packed arrays, as parse_mdl_geometry does.
+    void bench_vertex() {
+        const size_t count = 1 << 20;
+        std::vector<uint8_t> src = random_bytes(count * MdlVertexMain::stride);
+        std::printf("vertex: %zu random vertices, %s halfs, Mvert/s\n", count, cpu_has_f16c() ? "f16c" : "sse2");
+        std::printf("  main (28 B)  %.0f\n", vertex_mverts<MdlVertexMain>(src, count));
+        std::printf("  alt  (20 B)  %.0f\n", vertex_mverts<MdlVertexAlt>(src, count));
+    }
+
+    void put_be32(std::vector<unsigned char> &out, uint32_t v) {
+        for (int shift = 24; shift >= 0; shift -= 8) out.push_back((unsigned char) (v >> shift));
+    }
+
+    // Smallest model the parser accepts with two mesh buffers, the second
+    // found by the FF FF FF FF marker search across `gap` bytes that look
+    // like vertex data (0xFF bytes, never four in a row).
+    std::vector<unsigned char> synthetic_mdl(size_t gap) {
+        std::vector<unsigned char> m(32, 0);
+        put_be32(m, 0);  // bones
+        put_be32(m, 0);  // bone transforms
+        m.insert(m.end(), 40, 0);
+        put_be32(m, 2);  // meshes
+        m.insert(m.end(), 41, 0);
+        put_be32(m, 0);  // Unk6Count
+        put_be32(m, 1);  // string blocks
+        m.push_back('a');
+        m.push_back(0);
+        for (int mesh = 0; mesh < 2; ++mesh) {
+            put_be32(m, 0);
+            m.push_back('m');
+            m.push_back(0);
+            m.insert(m.end(), 8 + 21 + 4 + 12, 0);
+            put_be32(m, 0);  // materials
+        }
+        for (uint32_t v: {1u, 1u, 0u, 0u, 0u, 0u}) put_be32(m, v);  // first buffer, empty
+
+        Rng rng;
+        for (size_t i = 0; i < gap; ++i) m.push_back((unsigned char) (i % 4 == 3 ? 0 : rng.next() | (i % 4 == 0 ? 0xF0 : 0)));
+        for (uint32_t v: {2u, 2u, 0u, 0u, 0u, 0u}) put_be32(m, v);  // second buffer, empty
+        put_be32(m, 0xFFFFFFFFu);
+        return m;
+    }
+
+    // Header parsing with its mesh buffer searches. Without inputs it parses
+    // the synthetic model above; otherwise the given extracted .mdl files.
+    // One MDLView is reused, as the preview does.
+    void bench_mdl(const std::vector<std::string> &paths) {
+        std::vector<std::vector<unsigned char>> files;
+        if (paths.empty()) files.push_back(synthetic_mdl(8u << 20));
+        for (const auto &path: paths) {
+            std::ifstream in(path, std::ios::binary);
+            files.emplace_back(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        size_t bytes = 0;
+        for (const auto &f: files) bytes += f.size();
+
+        MDLView view;
+        size_t parsed = 0;
+        double ms = best_ms(5, [&] {
+            parsed = 0;
+            for (const auto &f: files) parsed += parse_mdl_view(f.data(), f.size(), view) ? 1 : 0;
+        });
+        std::printf("mdl: %s, %zu of %zu parsed, %.2f MB: %.2f ms\n", paths.empty() ? "synthetic 8 MB gap" : "files",
+                    parsed, files.size(), bytes / 1e6, ms);
+    }
+
+    void bench_mdl_synthetic() {
+        bench_mdl({});
+    }
+
+    struct Suite {
+        const char *name;
+        void (*run)();
+        void (*run_inputs)(const std::vector<std::string> &);
+    };
+
+    const Suite SUITES[] = {
+        {"bc", bench_bc, nullptr},
+        {"bc-bands", bench_bc_bands, nullptr},
+        {"encode", bench_encode, nullptr},
+        {"vertex", bench_vertex, nullptr},
+        {"mdl", bench_mdl_synthetic, bench_mdl},
+    };
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        for (const auto &s: SUITES) s.run();
+        return 0;
+    }
+    for (const auto &s: SUITES) {
+        if (std::strcmp(argv[1], s.name) != 0) continue;
+        if (argc > 2 && s.run_inputs) s.run_inputs(std::vector<std::string>(argv + 2, argv + argc));
+        else s.run();
+        return 0;
+    }
+    std::fprintf(stderr, "usage: f2_bench [");
+    for (const auto &s: SUITES) std::fprintf(stderr, " %s", s.name);
+    std::fprintf(stderr, " ] [inputs...]\n");
+    return 1;
+}
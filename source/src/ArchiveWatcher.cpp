@@ -0,0 +1,248 @@
+#include "ArchiveWatcher.h"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <algorithm>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+    constexpr auto QUIET_PERIOD = std::chrono::milliseconds(750);
+
+    struct Watcher {
+        std::mutex mutex;
+        std::unordered_map<std::string, Clock::time_point> pending;
+        std::atomic<bool> stop{false};
+        std::thread thread;
+        std::string root;
+        // Archive paths seen under the root. Only the watch thread touches it.
+        std::set<std::string> known;
+#if defined(_WIN32)
+        HANDLE stop_event = nullptr;
+#endif
+    };
+
+    Watcher g_watcher;
+
+    bool is_archive_path(const std::string &p) {
+        std::string ext = std::filesystem::path(p).extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        return ext == ".bnk" || ext == ".adb";
+    }
+
+    void note_change(const std::string &path) {
+        if (!is_archive_path(path)) return;
+        g_watcher.known.insert(path);
+        std::lock_guard<std::mutex> lock(g_watcher.mutex);
+        g_watcher.pending[path] = Clock::now();
+    }
+
+    // A folder deleted or moved away is reported on its own, not per file,
+    // so every archive known to have been under it is reported instead.
+    void note_tree_gone(const std::string &dir) {
+        std::string prefix = (std::filesystem::path(dir) / "").string();
+        auto &known = g_watcher.known;
+        auto begin = known.lower_bound(prefix), end = begin;
+        auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(g_watcher.mutex);
+        for (; end != known.end() && end->compare(0, prefix.size(), prefix) == 0; ++end) g_watcher.pending[*end] = now;
+        known.erase(begin, end);
+    }
+
+    void add_known_tree(const std::filesystem::path &dir) {
+        std::error_code ec;
+        for (std::filesystem::recursive_directory_iterator it(dir, std::filesystem::directory_options::skip_permission_denied, ec), end;
+             !ec && it != end; it.increment(ec)) {
+            std::string p = it->path().string();
+            if (is_archive_path(p)) g_watcher.known.insert(p);
+        }
+    }
+
+#if defined(__linux__)
+    void add_watch_tree(int fd, const std::filesystem::path &dir, std::unordered_map<int, std::string> &dirs) {
+        const uint32_t mask = IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_FROM | IN_MOVED_TO;
+        int wd = inotify_add_watch(fd, dir.string().c_str(), mask);
+        if (wd >= 0) dirs[wd] = dir.string();
+
+        std::error_code ec;
+        for (std::filesystem::recursive_directory_iterator it(dir, std::filesystem::directory_options::skip_permission_denied, ec), end;
+             !ec && it != end; it.increment(ec)) {
+            std::error_code eec;
+            if (it->is_directory(eec) && !it->is_symlink(eec)) {
+                int w = inotify_add_watch(fd, it->path().string().c_str(), mask);
+                if (w >= 0) dirs[w] = it->path().string();
+            }
+        }
+    }
+
+    // Watches on a folder that moved away would keep reporting under its old
+    // path; a deleted one has already been dropped by the kernel.
+    void drop_watch_tree(int fd, const std::filesystem::path &dir, std::unordered_map<int, std::string> &dirs) {
+        std::string d = dir.string(), prefix = (dir / "").string();
+        for (auto it = dirs.begin(); it != dirs.end();) {
+            if (it->second == d || it->second.compare(0, prefix.size(), prefix) == 0) {
+                inotify_rm_watch(fd, it->first);
+                it = dirs.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void watch_loop(std::string root) {
+        int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0) return;
+
+        std::unordered_map<int, std::string> dirs;
+        add_watch_tree(fd, root, dirs);
+        add_known_tree(root);
+
+        alignas(inotify_event) char buf[16 * 1024];
+        while (!g_watcher.stop) {
+            pollfd pfd{fd, POLLIN, 0};
+            if (poll(&pfd, 1, 200) <= 0) continue;
+
+            ssize_t n = read(fd, buf, sizeof(buf));
+            for (ssize_t off = 0; n > 0 && off < n;) {
+                auto *ev = reinterpret_cast<inotify_event *>(buf + off);
+                off += (ssize_t) sizeof(inotify_event) + ev->len;
+
+                auto it = dirs.find(ev->wd);
+                if (it == dirs.end() || ev->len == 0) continue;
+                std::filesystem::path full = std::filesystem::path(it->second) / ev->name;
+
+                if (ev->mask & IN_ISDIR) {
+                    if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+                        add_watch_tree(fd, full, dirs);
+                        std::error_code ec;
+                        for (std::filesystem::recursive_directory_iterator d(full, ec), end; !ec && d != end; d.increment(ec))
+                            note_change(d->path().string());
+                    } else if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                        note_tree_gone(full.string());
+                        drop_watch_tree(fd, full, dirs);
+                    }
+                    continue;
+                }
+                note_change(full.string());
+            }
+        }
+        close(fd);
+    }
+#elif defined(_WIN32)
+    void watch_loop(std::string root) {
+        HANDLE dir = CreateFileW(std::filesystem::path(root).wstring().c_str(), FILE_LIST_DIRECTORY,
+                                 FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                                 FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+        if (dir == INVALID_HANDLE_VALUE) return;
+
+        add_known_tree(root);
+        OVERLAPPED ov{};
+        ov.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        alignas(DWORD) BYTE buf[64 * 1024];
+        const DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME |
+                             FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE;
+
+        while (!g_watcher.stop) {
+            ResetEvent(ov.hEvent);
+            if (!ReadDirectoryChangesW(dir, buf, sizeof(buf), TRUE, filter, nullptr, &ov, nullptr)) break;
+
+            HANDLE waits[2] = {ov.hEvent, g_watcher.stop_event};
+            DWORD r = WaitForMultipleObjects(2, waits, FALSE, INFINITE);
+            DWORD bytes = 0;
+            if (r != WAIT_OBJECT_0) {
+                // buf and ov must outlive the read, so wait for the cancel
+                // to land before leaving the loop.
+                CancelIo(dir);
+                GetOverlappedResult(dir, &ov, &bytes, TRUE);
+                break;
+            }
+
+            if (!GetOverlappedResult(dir, &ov, &bytes, FALSE)) break;
+            if (bytes == 0) {
+                // Buffer overflow: too many changes to report individually.
+                std::error_code ec;
+                for (std::filesystem::recursive_directory_iterator d(root, ec), end; !ec && d != end; d.increment(ec))
+                    note_change(d->path().string());
+                continue;
+            }
+
+            for (DWORD off = 0;;) {
+                auto *info = reinterpret_cast<FILE_NOTIFY_INFORMATION *>(buf + off);
+                std::wstring rel(info->FileName, info->FileNameLength / sizeof(WCHAR));
+                std::string path = (std::filesystem::path(root) / rel).string();
+                if (info->Action == FILE_ACTION_REMOVED || info->Action == FILE_ACTION_RENAMED_OLD_NAME)
+                    note_tree_gone(path);
+                note_change(path);
+                if (!info->NextEntryOffset) break;
+                off += info->NextEntryOffset;
+            }
+        }
+
+        CloseHandle(ov.hEvent);
+        CloseHandle(dir);
+    }
+#else
+    void watch_loop(std::string) {}
+#endif
+}
+
+bool watcher_start(const std::string &root) {
+    watcher_stop();
+    std::error_code ec;
+    if (root.empty() || !std::filesystem::is_directory(root, ec)) return false;
+
+    g_watcher.stop = false;
+    g_watcher.root = root;
+#if defined(_WIN32)
+    g_watcher.stop_event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+#endif
+    g_watcher.thread = std::thread(watch_loop, root);
+    return true;
+}
+
+void watcher_stop() {
+    if (!g_watcher.thread.joinable()) return;
+    g_watcher.stop = true;
+#if defined(_WIN32)
+    if (g_watcher.stop_event) SetEvent(g_watcher.stop_event);
+#endif
+    g_watcher.thread.join();
+#if defined(_WIN32)
+    if (g_watcher.stop_event) CloseHandle(g_watcher.stop_event);
+    g_watcher.stop_event = nullptr;
+#endif
+    std::lock_guard<std::mutex> lock(g_watcher.mutex);
+    g_watcher.pending.clear();
+    g_watcher.root.clear();
+    g_watcher.known.clear();
+}
+
+bool watcher_running() {
+    return g_watcher.thread.joinable();
+}
+
+std::vector<std::string> watcher_poll() {
+    std::vector<std::string> out;
+    auto now = Clock::now();
+    std::lock_guard<std::mutex> lock(g_watcher.mutex);
+    for (auto it = g_watcher.pending.begin(); it != g_watcher.pending.end();) {
+        if (now - it->second >= QUIET_PERIOD) {
+            out.push_back(it->first);
+            it = g_watcher.pending.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return out;
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Watches a game root for .bnk/.adb files being added, removed or rewritten.
+// inotify on Linux, ReadDirectoryChangesW on Windows. Events are debounced:
+// a path is reported once it has been quiet for a short while, so a BNK
+// that is still being copied shows up once, after the copy finishes.
+bool watcher_start(const std::string &root);
+void watcher_stop();
+bool watcher_running();
+std::vector<std::string> watcher_poll();
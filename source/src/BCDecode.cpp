@@ -0,0 +1,505 @@
+#include "BCDecode.h"
+#include "Simd.h"
+#include "Utils.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+    inline uint16_t be16(const uint8_t *p) { return (uint16_t) ((p[0] << 8) | p[1]); }
+
+    inline uint32_t be32(const uint8_t *p) {
+        return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+    }
+
+    // Alpha index bits: the six bytes are stored in reverse order.
+    inline uint64_t be48(const uint8_t *p) {
+        uint64_t v = 0;
+        for (int i = 0; i < 6; ++i) v = (v << 8) | p[i];
+        return v;
+    }
+
+    inline uint64_t be64(const uint8_t *p) {
+        return ((uint64_t) be32(p) << 32) | be32(p + 4);
+    }
+
+    inline uint32_t ex5(uint32_t v) { return (v << 3) | (v >> 2); }
+    inline uint32_t ex6(uint32_t v) { return (v << 2) | (v >> 4); }
+
+    inline uint32_t pack(uint32_t r, uint32_t g, uint32_t b, uint32_t a, BCChannelOrder order) {
+        return order == BCChannelOrder::RGBA
+                   ? (a << 24) | (b << 16) | (g << 8) | r
+                   : (a << 24) | (r << 16) | (g << 8) | b;
+    }
+
+    // Endpoints and interpolants of a BC1-style colour block. BC1 switches to
+    // three colours plus transparent black when c0 <= c1; BC2/BC3 never do.
+    void color_palette(const uint8_t *b, bool four_color, BCChannelOrder order, uint32_t pal[4]) {
+        uint16_t c0 = be16(b), c1 = be16(b + 2);
+        uint32_t r0 = ex5((c0 >> 11) & 31), g0 = ex6((c0 >> 5) & 63), b0 = ex5(c0 & 31);
+        uint32_t r1 = ex5((c1 >> 11) & 31), g1 = ex6((c1 >> 5) & 63), b1 = ex5(c1 & 31);
+        pal[0] = pack(r0, g0, b0, 255, order);
+        pal[1] = pack(r1, g1, b1, 255, order);
+        if (four_color || c0 > c1) {
+            pal[2] = pack((2 * r0 + r1) / 3, (2 * g0 + g1) / 3, (2 * b0 + b1) / 3, 255, order);
+            pal[3] = pack((r0 + 2 * r1) / 3, (g0 + 2 * g1) / 3, (b0 + 2 * b1) / 3, 255, order);
+        } else {
+            pal[2] = pack((r0 + r1) >> 1, (g0 + g1) >> 1, (b0 + b1) >> 1, 255, order);
+            pal[3] = 0;
+        }
+    }
+
+    void alpha_palette(uint8_t a0, uint8_t a1, uint8_t tab[8]) {
+        tab[0] = a0;
+        tab[1] = a1;
+        if (a0 > a1) {
+            for (int i = 1; i <= 6; i++) tab[i + 1] = (uint8_t) (((7 - i) * a0 + i * a1) / 7);
+        } else {
+            for (int i = 1; i <= 4; i++) tab[i + 1] = (uint8_t) (((5 - i) * a0 + i * a1) / 5);
+            tab[6] = 0;
+            tab[7] = 255;
+        }
+    }
+
+    // BC5 texel for every (x, y) pair, Z rebuilt with the same float math the
+    // converter always used, so every kernel is a table lookup.
+    const uint32_t *bc5_lut(BCChannelOrder order) {
+        static std::once_flag once[2];
+        static std::vector<uint32_t> lut[2];
+        int k = order == BCChannelOrder::RGBA ? 0 : 1;
+        std::call_once(once[k], [&]() {
+            lut[k].resize(65536);
+            for (uint32_t r = 0; r < 256; ++r) {
+                for (uint32_t g = 0; g < 256; ++g) {
+                    float nx = (r / 255.0f) * 2.0f - 1.0f;
+                    float ny = (g / 255.0f) * 2.0f - 1.0f;
+                    float nz = sqrtf(std::max(0.0f, 1.0f - nx * nx - ny * ny));
+                    uint8_t br = (uint8_t) ((nx * 0.5f + 0.5f) * 255.0f);
+                    uint8_t bg = (uint8_t) ((ny * 0.5f + 0.5f) * 255.0f);
+                    uint8_t bb = (uint8_t) ((nz * 0.5f + 0.5f) * 255.0f);
+                    lut[k][(r << 8) | g] = pack(br, bg, bb, 255, order);
+                }
+            }
+        });
+        return lut[k].data();
+    }
+
+    void decode_block_scalar(BCFormat fmt, const uint8_t *b, BCChannelOrder order, const uint32_t *lut, uint32_t out[16]) {
+        uint32_t pal[4];
+        uint8_t ta[8], tb[8];
+        switch (fmt) {
+            case BCFormat::BC1: {
+                color_palette(b, false, order, pal);
+                uint32_t idx = be32(b + 4);
+                for (int i = 0; i < 16; ++i) out[i] = pal[(idx >> (2 * i)) & 3];
+                break;
+            }
+            case BCFormat::BC2: {
+                color_palette(b + 8, true, order, pal);
+                uint32_t idx = be32(b + 12);
+                uint64_t abits = be64(b);
+                for (int i = 0; i < 16; ++i) {
+                    uint32_t a = (uint32_t) ((abits >> (4 * i)) & 15) * 17;
+                    out[i] = (pal[(idx >> (2 * i)) & 3] & 0x00FFFFFFu) | (a << 24);
+                }
+                break;
+            }
+            case BCFormat::BC3: {
+                alpha_palette(b[0], b[1], ta);
+                uint64_t abits = be48(b + 2);
+                color_palette(b + 8, true, order, pal);
+                uint32_t idx = be32(b + 12);
+                for (int i = 0; i < 16; ++i)
+                    out[i] = (pal[(idx >> (2 * i)) & 3] & 0x00FFFFFFu) | ((uint32_t) ta[(abits >> (3 * i)) & 7] << 24);
+                break;
+            }
+            case BCFormat::BC4: {
+                alpha_palette(b[0], b[1], ta);
+                uint64_t bits = be48(b + 2);
+                for (int i = 0; i < 16; ++i) out[i] = 0xFF000000u | (ta[(bits >> (3 * i)) & 7] * 0x010101u);
+                break;
+            }
+            case BCFormat::BC5: {
+                alpha_palette(b[0], b[1], ta);
+                alpha_palette(b[8], b[9], tb);
+                uint64_t rbits = be48(b + 2), gbits = be48(b + 10);
+                for (int i = 0; i < 16; ++i)
+                    out[i] = lut[((uint32_t) ta[(rbits >> (3 * i)) & 7] << 8) | tb[(gbits >> (3 * i)) & 7]];
+                break;
+            }
+            default:
+                std::memset(out, 0, 16 * sizeof(uint32_t));
+                break;
+        }
+    }
+
+    // Writes a decoded 4x4 block, clipped to the surface edge.
+    void put_block(uint8_t *dst, size_t stride, int w, int h, int bx, int by, const uint32_t block[16]) {
+        int x0 = bx * 4, y0 = by * 4;
+        int cw = std::min(4, w - x0), ch = std::min(4, h - y0);
+        for (int py = 0; py < ch; ++py)
+            std::memcpy(dst + (size_t) (y0 + py) * stride + (size_t) x0 * 4, block + py * 4, (size_t) cw * 4);
+    }
+
+#if F2_SIMD_X86
+    // SSE2 has no variable shuffle, so palette entries are picked with one
+    // compare mask per entry; each row is four pixels of one block.
+    void color_rows_sse2(const uint32_t pal[4], uint32_t idx, __m128i rows[4]) {
+        const __m128i mask = _mm_setr_epi32(3, 3 << 2, 3 << 4, 3 << 6);
+        const __m128i k1 = _mm_setr_epi32(1, 1 << 2, 1 << 4, 1 << 6);
+        const __m128i k2 = _mm_slli_epi32(k1, 1);
+        const __m128i p0 = _mm_set1_epi32((int) pal[0]), p1 = _mm_set1_epi32((int) pal[1]);
+        const __m128i p2 = _mm_set1_epi32((int) pal[2]), p3 = _mm_set1_epi32((int) pal[3]);
+        __m128i v = _mm_set1_epi32((int) idx);
+        for (int r = 0; r < 4; ++r) {
+            __m128i m = _mm_and_si128(v, mask);
+            __m128i o = _mm_and_si128(_mm_cmpeq_epi32(m, _mm_setzero_si128()), p0);
+            o = _mm_or_si128(o, _mm_and_si128(_mm_cmpeq_epi32(m, k1), p1));
+            o = _mm_or_si128(o, _mm_and_si128(_mm_cmpeq_epi32(m, k2), p2));
+            o = _mm_or_si128(o, _mm_and_si128(_mm_cmpeq_epi32(m, mask), p3));
+            rows[r] = o;
+            v = _mm_srli_epi32(v, 8);
+        }
+    }
+
+    // 3-bit indices into an 8-entry table: a compare per entry costs more
+    // than it saves here, so the lookups stay scalar and only the merge with
+    // colour is vectorized.
+    void channel_rows_sse2(const uint8_t *b, __m128i rows[4]) {
+        uint8_t tab[8];
+        alpha_palette(b[0], b[1], tab);
+        uint64_t bits = be48(b + 2);
+        alignas(16) uint32_t v[16];
+        for (int i = 0; i < 16; ++i) v[i] = tab[(bits >> (3 * i)) & 7];
+        for (int r = 0; r < 4; ++r) rows[r] = _mm_load_si128((const __m128i *) (v + 4 * r));
+    }
+
+    // BC2 explicit alpha: each nibble is moved to the top of its 16-bit lane
+    // by a per-lane multiply, then scaled by 17.
+    void explicit_alpha_rows_sse2(uint64_t bits, __m128i rows[4]) {
+        const __m128i mul = _mm_setr_epi16(1 << 12, 0, 1 << 8, 0, 1 << 4, 0, 1, 0);
+        for (int r = 0; r < 4; ++r) {
+            __m128i v = _mm_set1_epi32((int) ((bits >> (16 * r)) & 0xFFFF));
+            v = _mm_srli_epi16(_mm_mullo_epi16(v, mul), 12);
+            rows[r] = _mm_or_si128(v, _mm_slli_epi32(v, 4));
+        }
+    }
+
+    inline __m128i with_alpha_sse2(__m128i color, __m128i alpha) {
+        return _mm_or_si128(_mm_and_si128(color, _mm_set1_epi32(0x00FFFFFF)), _mm_slli_epi32(alpha, 24));
+    }
+
+    inline __m128i grey_sse2(__m128i v) {
+        return _mm_or_si128(_mm_or_si128(v, _mm_slli_epi32(v, 8)),
+                            _mm_or_si128(_mm_slli_epi32(v, 16), _mm_set1_epi32((int) 0xFF000000u)));
+    }
+
+    void decode_block_sse2(BCFormat fmt, const uint8_t *b, BCChannelOrder order, const uint32_t *lut, uint8_t *dst, size_t stride) {
+        __m128i rows[4], alpha[4];
+        uint32_t pal[4];
+        switch (fmt) {
+            case BCFormat::BC1:
+                color_palette(b, false, order, pal);
+                color_rows_sse2(pal, be32(b + 4), rows);
+                break;
+            case BCFormat::BC2:
+                color_palette(b + 8, true, order, pal);
+                color_rows_sse2(pal, be32(b + 12), rows);
+                explicit_alpha_rows_sse2(be64(b), alpha);
+                for (int r = 0; r < 4; ++r) rows[r] = with_alpha_sse2(rows[r], alpha[r]);
+                break;
+            case BCFormat::BC3:
+                color_palette(b + 8, true, order, pal);
+                color_rows_sse2(pal, be32(b + 12), rows);
+                channel_rows_sse2(b, alpha);
+                for (int r = 0; r < 4; ++r) rows[r] = with_alpha_sse2(rows[r], alpha[r]);
+                break;
+            case BCFormat::BC4:
+                channel_rows_sse2(b, rows);
+                for (int r = 0; r < 4; ++r) rows[r] = grey_sse2(rows[r]);
+                break;
+            case BCFormat::BC5: {
+                __m128i g[4];
+                channel_rows_sse2(b, rows);
+                channel_rows_sse2(b + 8, g);
+                for (int r = 0; r < 4; ++r) {
+                    alignas(16) uint32_t key[4];
+                    _mm_store_si128((__m128i *) key, _mm_or_si128(_mm_slli_epi32(rows[r], 8), g[r]));
+                    rows[r] = _mm_setr_epi32((int) lut[key[0]], (int) lut[key[1]], (int) lut[key[2]], (int) lut[key[3]]);
+                }
+                break;
+            }
+            default:
+                return;
+        }
+        for (int r = 0; r < 4; ++r) _mm_storeu_si128((__m128i *) (dst + r * stride), rows[r]);
+    }
+
+    // AVX2 decodes two horizontally adjacent blocks per call: row r of both
+    // blocks is eight contiguous pixels, block A in lanes 0-3 and B in 4-7.
+    F2_TARGET_AVX2 void color_rows_avx2(const uint32_t pa[4], const uint32_t pb[4], uint32_t ia, uint32_t ib, __m256i rows[4]) {
+        const __m256i pal = _mm256_setr_epi32((int) pa[0], (int) pa[1], (int) pa[2], (int) pa[3],
+                                              (int) pb[0], (int) pb[1], (int) pb[2], (int) pb[3]);
+        const __m256i shift = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+        const __m256i upper = _mm256_setr_epi32(0, 0, 0, 0, 4, 4, 4, 4);
+        const __m256i three = _mm256_set1_epi32(3);
+        __m256i idx = _mm256_setr_epi32((int) ia, (int) ia, (int) ia, (int) ia, (int) ib, (int) ib, (int) ib, (int) ib);
+        for (int r = 0; r < 4; ++r) {
+            __m256i sel = _mm256_add_epi32(_mm256_and_si256(_mm256_srlv_epi32(idx, shift), three), upper);
+            rows[r] = _mm256_permutevar8x32_epi32(pal, sel);
+            idx = _mm256_srli_epi32(idx, 8);
+        }
+    }
+
+    F2_TARGET_AVX2 void channel_rows_avx2(const uint8_t *a, const uint8_t *b, __m256i rows[4]) {
+        uint8_t ta[8], tb[8];
+        alpha_palette(a[0], a[1], ta);
+        alpha_palette(b[0], b[1], tb);
+        uint64_t xa = be48(a + 2), xb = be48(b + 2);
+        const __m256i pa = _mm256_setr_epi32(ta[0], ta[1], ta[2], ta[3], ta[4], ta[5], ta[6], ta[7]);
+        const __m256i pb = _mm256_setr_epi32(tb[0], tb[1], tb[2], tb[3], tb[4], tb[5], tb[6], tb[7]);
+        const __m256i shift = _mm256_setr_epi32(0, 3, 6, 9, 0, 3, 6, 9);
+        const __m256i seven = _mm256_set1_epi32(7);
+        for (int r = 0; r < 4; ++r) {
+            int ra = (int) ((xa >> (12 * r)) & 0xFFF), rb = (int) ((xb >> (12 * r)) & 0xFFF);
+            __m256i v = _mm256_setr_epi32(ra, ra, ra, ra, rb, rb, rb, rb);
+            __m256i sel = _mm256_and_si256(_mm256_srlv_epi32(v, shift), seven);
+            rows[r] = _mm256_blend_epi32(_mm256_permutevar8x32_epi32(pa, sel), _mm256_permutevar8x32_epi32(pb, sel), 0xF0);
+        }
+    }
+
+    F2_TARGET_AVX2 void explicit_alpha_rows_avx2(uint64_t xa, uint64_t xb, __m256i rows[4]) {
+        const __m256i shift = _mm256_setr_epi32(0, 4, 8, 12, 0, 4, 8, 12);
+        const __m256i fifteen = _mm256_set1_epi32(15);
+        for (int r = 0; r < 4; ++r) {
+            int ra = (int) ((xa >> (16 * r)) & 0xFFFF), rb = (int) ((xb >> (16 * r)) & 0xFFFF);
+            __m256i v = _mm256_setr_epi32(ra, ra, ra, ra, rb, rb, rb, rb);
+            v = _mm256_and_si256(_mm256_srlv_epi32(v, shift), fifteen);
+            rows[r] = _mm256_or_si256(v, _mm256_slli_epi32(v, 4));
+        }
+    }
+
+    F2_TARGET_AVX2 void decode_pair_avx2(BCFormat fmt, const uint8_t *a, const uint8_t *b, BCChannelOrder order,
+                                         const uint32_t *lut, uint8_t *dst, size_t stride) {
+        __m256i rows[4], alpha[4];
+        uint32_t pa[4], pb[4];
+        const __m256i rgb_mask = _mm256_set1_epi32(0x00FFFFFF);
+        switch (fmt) {
+            case BCFormat::BC1:
+                color_palette(a, false, order, pa);
+                color_palette(b, false, order, pb);
+                color_rows_avx2(pa, pb, be32(a + 4), be32(b + 4), rows);
+                break;
+            case BCFormat::BC2:
+            case BCFormat::BC3:
+                color_palette(a + 8, true, order, pa);
+                color_palette(b + 8, true, order, pb);
+                color_rows_avx2(pa, pb, be32(a + 12), be32(b + 12), rows);
+                if (fmt == BCFormat::BC2) explicit_alpha_rows_avx2(be64(a), be64(b), alpha);
+                else channel_rows_avx2(a, b, alpha);
+                for (int r = 0; r < 4; ++r)
+                    rows[r] = _mm256_or_si256(_mm256_and_si256(rows[r], rgb_mask), _mm256_slli_epi32(alpha[r], 24));
+                break;
+            case BCFormat::BC4: {
+                const __m256i opaque = _mm256_set1_epi32((int) 0xFF000000u);
+                channel_rows_avx2(a, b, rows);
+                for (int r = 0; r < 4; ++r) {
+                    __m256i v = rows[r];
+                    rows[r] = _mm256_or_si256(_mm256_or_si256(v, _mm256_slli_epi32(v, 8)),
+                                              _mm256_or_si256(_mm256_slli_epi32(v, 16), opaque));
+                }
+                break;
+            }
+            case BCFormat::BC5: {
+                __m256i g[4];
+                channel_rows_avx2(a, b, rows);
+                channel_rows_avx2(a + 8, b + 8, g);
+                for (int r = 0; r < 4; ++r) {
+                    __m256i key = _mm256_or_si256(_mm256_slli_epi32(rows[r], 8), g[r]);
+                    rows[r] = _mm256_i32gather_epi32((const int *) lut, key, 4);
+                }
+                break;
+            }
+            default:
+                return;
+        }
+        for (int r = 0; r < 4; ++r) _mm256_storeu_si256((__m256i *) (dst + r * stride), rows[r]);
+    }
+#endif
+}
+
+BCFormat bc_format_from_pixel_format(uint32_t pixel_format) {
+    switch (pixel_format) {
+        case 35: return BCFormat::BC1;
+        case 39: return BCFormat::BC3;
+        case 40: return BCFormat::BC5;
+        default: return BCFormat::None;
+    }
+}
+
+BCFormat bc_format_from_comp_flag(uint32_t comp_flag) {
+    switch (comp_flag) {
+        case 7: return BCFormat::BC1;
+        case 8: return BCFormat::BC2;
+        case 9: return BCFormat::BC3;
+        case 10: return BCFormat::BC4;
+        case 11: return BCFormat::BC5;
+        default: return BCFormat::None;
+    }
+}
+
+size_t bc_block_bytes(BCFormat fmt) {
+    switch (fmt) {
+        case BCFormat::BC1:
+        case BCFormat::BC4: return 8;
+        case BCFormat::BC2:
+        case BCFormat::BC3:
+        case BCFormat::BC5: return 16;
+        default: return 0;
+    }
+}
+
+size_t bc_surface_bytes(BCFormat fmt, int w, int h) {
+    if (w <= 0 || h <= 0) return 0;
+    return (size_t) ((w + 3) / 4) * (size_t) ((h + 3) / 4) * bc_block_bytes(fmt);
+}
+
+void bc_to_little_endian(BCFormat fmt, const uint8_t *src, size_t size, uint8_t *dst) {
+    const size_t block_bytes = bc_block_bytes(fmt);
+    if (!block_bytes) return;
+
+    // Each field is stored as one big-endian integer; reversing its bytes
+    // gives the layout D3D expects. Alpha endpoints are single bytes.
+    auto reverse = [](uint8_t *d, const uint8_t *s, int n) {
+        for (int i = 0; i < n; ++i) d[i] = s[n - 1 - i];
+    };
+    auto color = [&](uint8_t *d, const uint8_t *s) {
+        reverse(d, s, 2);
+        reverse(d + 2, s + 2, 2);
+        reverse(d + 4, s + 4, 4);
+    };
+    auto alpha = [&](uint8_t *d, const uint8_t *s) {
+        d[0] = s[0];
+        d[1] = s[1];
+        reverse(d + 2, s + 2, 6);
+    };
+
+    for (size_t off = 0; off + block_bytes <= size; off += block_bytes) {
+        uint8_t s[16];
+        std::memcpy(s, src + off, block_bytes);
+        uint8_t *d = dst + off;
+        switch (fmt) {
+            case BCFormat::BC1: color(d, s); break;
+            case BCFormat::BC2: reverse(d, s, 8); color(d + 8, s + 8); break;
+            case BCFormat::BC3: alpha(d, s); color(d + 8, s + 8); break;
+            case BCFormat::BC4: alpha(d, s); break;
+            case BCFormat::BC5: alpha(d, s); alpha(d + 8, s + 8); break;
+            default: break;
+        }
+    }
+}
+
+BCKernel bc_best_kernel() {
+    if (cpu_has_avx2()) return BCKernel::AVX2;
+    if (cpu_has_sse2()) return BCKernel::SSE2;
+    return BCKernel::Scalar;
+}
+
+const char *bc_kernel_name(BCKernel kernel) {
+    switch (kernel) {
+        case BCKernel::Scalar: return "scalar";
+        case BCKernel::SSE2: return "sse2";
+        case BCKernel::AVX2: return "avx2";
+        default: return "auto";
+    }
+}
+
+namespace {
+    struct DecodeJob {
+        BCFormat fmt;
+        const uint8_t *src;
+        uint8_t *dst;
+        int w, h;
+        BCChannelOrder order;
+        BCKernel kernel;
+        const uint32_t *lut;
+    };
+
+    // Decodes block rows [by0, by1). Rows are independent and write disjoint
+    // pixel rows, so any split of the range can run concurrently.
+    void decode_block_rows(const DecodeJob &job, int by0, int by1) {
+        const size_t block_bytes = bc_block_bytes(job.fmt);
+        const int w = job.w, h = job.h;
+        const int bw = (w + 3) / 4;
+        const int full_cols = w / 4;
+        const size_t stride = (size_t) w * 4;
+
+        for (int by = by0; by < by1; ++by) {
+            const uint8_t *row = job.src + (size_t) by * bw * block_bytes;
+            uint8_t *out = job.dst + (size_t) by * 4 * stride;
+            int bx = 0;
+
+            // Edge blocks that are cut by the surface go through the clipped
+            // scalar path; everything else is written in place by the kernels.
+#if F2_SIMD_X86
+            if (by * 4 + 4 <= h && job.kernel != BCKernel::Scalar) {
+                if (job.kernel == BCKernel::AVX2) {
+                    for (; bx + 2 <= full_cols; bx += 2)
+                        decode_pair_avx2(job.fmt, row + bx * block_bytes, row + (bx + 1) * block_bytes, job.order, job.lut,
+                                         out + (size_t) bx * 16, stride);
+                }
+                for (; bx < full_cols; ++bx)
+                    decode_block_sse2(job.fmt, row + bx * block_bytes, job.order, job.lut, out + (size_t) bx * 16, stride);
+            }
+#endif
+            for (; bx < bw; ++bx) {
+                uint32_t block[16];
+                decode_block_scalar(job.fmt, row + bx * block_bytes, job.order, job.lut, block);
+                put_block(job.dst, stride, w, h, bx, by, block);
+            }
+        }
+    }
+
+    // Below this many pixels a surface decodes faster than threads start.
+    constexpr size_t PARALLEL_MIN_PIXELS = 512 * 512;
+    constexpr int ROWS_PER_BAND = 16;
+
+    // Decodes currently running; batch exports already decode from several
+    // workers, so the cores are shared out instead of each call taking all.
+    std::atomic<int> g_active_decodes{0};
+}
+
+bool bc_decode(BCFormat fmt, const uint8_t *src, size_t src_size, int w, int h, uint8_t *dst,
+               BCChannelOrder order, BCKernel kernel, int max_threads) {
+    if (!bc_block_bytes(fmt) || !src || !dst || w <= 0 || h <= 0) return false;
+    if (src_size < bc_surface_bytes(fmt, w, h)) return false;
+
+    if (kernel == BCKernel::Auto) kernel = bc_best_kernel();
+    if (kernel == BCKernel::AVX2 && !cpu_has_avx2()) kernel = BCKernel::SSE2;
+    if (kernel == BCKernel::SSE2 && !cpu_has_sse2()) kernel = BCKernel::Scalar;
+
+    DecodeJob job{fmt, src, dst, w, h, order, kernel, fmt == BCFormat::BC5 ? bc5_lut(order) : nullptr};
+    const int bh = (h + 3) / 4;
+
+    if (max_threads == 1 || (size_t) w * (size_t) h < PARALLEL_MIN_PIXELS) {
+        decode_block_rows(job, 0, bh);
+        return true;
+    }
+
+    int active = ++g_active_decodes;
+    if (max_threads <= 0) max_threads = std::max(1, (int) std::thread::hardware_concurrency() / active);
+
+    // Bands of block rows handed out from a shared counter, so a slow core
+    // does not hold up the rest of the image.
+    size_t bands = (size_t) ((bh + ROWS_PER_BAND - 1) / ROWS_PER_BAND);
+    parallel_for(bands, [&](size_t k) {
+        int by0 = (int) k * ROWS_PER_BAND;
+        decode_block_rows(job, by0, std::min(bh, by0 + ROWS_PER_BAND));
+    }, max_threads);
+    --g_active_decodes;
+    return true;
+}
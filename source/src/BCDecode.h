@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+enum class BCFormat : uint8_t {
+    None = 0,
+    BC1,
+    BC2,
+    BC3,
+    BC4,
+    BC5,
+};
+
+enum class BCChannelOrder : uint8_t {
+    RGBA = 0,
+    BGRA,
+};
+
+enum class BCKernel : uint8_t {
+    Auto = 0,
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+BCFormat bc_format_from_pixel_format(uint32_t pixel_format);
+BCFormat bc_format_from_comp_flag(uint32_t comp_flag);
+size_t bc_block_bytes(BCFormat fmt);
+size_t bc_surface_bytes(BCFormat fmt, int w, int h);
+// Rewrites whole big-endian blocks into the little-endian layout used by
+// D3D and DDS files, without decoding. src and dst may be the same buffer.
+void bc_to_little_endian(BCFormat fmt, const uint8_t *src, size_t size, uint8_t *dst);
+BCKernel bc_best_kernel();
+const char *bc_kernel_name(BCKernel kernel);
+
+// Decodes a big-endian (Xbox 360) block-compressed surface into w*h packed
+// 8-bit pixels. The byte swap is folded into the block reads, so src is read
+// as is. BC2/BC3 colour is always 4-colour as on the GPU, BC4 decodes to
+// grey and BC5 to a normal map with Z rebuilt from X and Y.
+// Scalar is the reference; the SIMD kernels produce identical output.
+// Large surfaces are split into bands of block rows decoded on up to
+// max_threads threads (0 = the cores shared among concurrent decodes),
+// each band writing straight into its final rows.
+bool bc_decode(BCFormat fmt, const uint8_t *src, size_t src_size, int w, int h, uint8_t *dst,
+               BCChannelOrder order = BCChannelOrder::RGBA, BCKernel kernel = BCKernel::Auto, int max_threads = 0);
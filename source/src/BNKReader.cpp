@@ -8,6 +8,7 @@
 #include <optional>
 #include <filesystem>
 #include <fstream>
+#include <mutex>
 #include <zlib.h>
 
 struct FileEntry {
@@ -57,6 +58,31 @@ public:
         extract_entry_to(*entry, out);
     }
 
+    // Appends the decompressed entry to out, for callers that stitch several
+    // entries into one buffer without a round trip through temp files.
+    void read_entry(size_t index, std::vector<uint8_t>& out) {
+        if (index >= file_entries.size()) throw std::runtime_error("index out of range");
+        const FileEntry& e = file_entries[index];
+        out.reserve(out.size() + e.uncompressed_size);
+        stream_entry(e, [&](const uint8_t* p, size_t n) { out.insert(out.end(), p, p + n); });
+    }
+
+    // Reads an entry's bytes as stored in the archive, compressed or not.
+    // Only this touches the file handle, so threads sharing one reader need
+    // to serialize just this call and can inflate_stored concurrently.
+    void read_stored(size_t index, std::vector<uint8_t>& stored) {
+        if (index >= file_entries.size()) throw std::runtime_error("index out of range");
+        read_stored_entry(file_entries[index], stored);
+    }
+
+    // Appends the decompressed entry to out, from what read_stored returned.
+    void inflate_stored(size_t index, const std::vector<uint8_t>& stored, std::vector<uint8_t>& out) const {
+        if (index >= file_entries.size()) throw std::runtime_error("index out of range");
+        const FileEntry& e = file_entries[index];
+        out.reserve(out.size() + e.uncompressed_size);
+        decode_stored(e, stored, [&](const uint8_t* p, size_t n) { out.insert(out.end(), p, p + n); });
+    }
+
     void extract_all(const std::filesystem::path& out_dir) {
         std::filesystem::create_directories(out_dir);
         for (auto& e : file_entries) {
@@ -307,18 +333,30 @@ private:
     }
 
     void extract_entry_to(const FileEntry& e, std::ofstream& out) {
+        stream_entry(e, [&](const uint8_t* p, size_t n) { out.write(reinterpret_cast<const char*>(p), std::streamsize(n)); });
+    }
+
+    template <class Sink>
+    void stream_entry(const FileEntry& e, Sink&& sink) {
+        std::vector<uint8_t> stored;
+        read_stored_entry(e, stored);
+        decode_stored(e, stored, sink);
+    }
+
+    void read_stored_entry(const FileEntry& e, std::vector<uint8_t>& stored) {
+        _fh.clear();
         _fh.seekg(e.offset, std::ios::beg);
+        stored.resize(e.is_compressed ? e.compressed_size : e.uncompressed_size);
+        read_exact(stored.data(), stored.size());
+    }
 
+    template <class Sink>
+    static void decode_stored(const FileEntry& e, const std::vector<uint8_t>& comp_blob, Sink&& sink) {
         if (!e.is_compressed) {
-            std::vector<uint8_t> buf(e.uncompressed_size);
-            read_exact(buf.data(), buf.size());
-            out.write(reinterpret_cast<const char*>(buf.data()), std::streamsize(buf.size()));
+            sink(comp_blob.data(), comp_blob.size());
             return;
         }
 
-        std::vector<uint8_t> comp_blob(e.compressed_size);
-        read_exact(comp_blob.data(), comp_blob.size());
-
         const size_t CHUNK_SIZE = 0x8000;  // 32KB
 
         for (size_t i = 0; i < e.decompressed_chunk_sizes.size(); ++i) {
@@ -371,7 +409,7 @@ private:
                 throw std::runtime_error("Failed to inflate chunk");
             }
 
-            out.write(reinterpret_cast<const char*>(chunk->data()), std::streamsize(chunk->size()));
+            sink(chunk->data(), chunk->size());
         }
     }
 
@@ -379,3 +417,22 @@ private:
         char buf[32]; std::snprintf(buf,sizeof(buf),"file_%08X.bin",off); return std::string(buf);
     }
 };
+
+// Appends entry `index` of a reader shared between threads. Only the raw
+// read holds `mutex`; inflating runs in parallel. On failure out is left as
+// it was and false is returned.
+inline bool read_and_inflate(BNKReader& reader, std::mutex& mutex, size_t index, std::vector<uint8_t>& out) {
+    size_t before = out.size();
+    try {
+        std::vector<uint8_t> stored;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            reader.read_stored(index, stored);
+        }
+        reader.inflate_stored(index, stored, out);
+    } catch (...) {
+        out.resize(before);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,112 @@
+#include "DdsExport.h"
+#include "BCDecode.h"
+#include "TexParser.h"
+#include "X360Tiling.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    constexpr uint32_t DDSD_CAPS = 0x1, DDSD_HEIGHT = 0x2, DDSD_WIDTH = 0x4, DDSD_PIXELFORMAT = 0x1000;
+    constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000, DDSD_LINEARSIZE = 0x80000;
+    constexpr uint32_t DDPF_FOURCC = 0x4;
+    constexpr uint32_t DDSCAPS_COMPLEX = 0x8, DDSCAPS_TEXTURE = 0x1000, DDSCAPS_MIPMAP = 0x400000;
+    constexpr uint32_t D3D10_RESOURCE_DIMENSION_TEXTURE2D = 3;
+
+    uint32_t dxgi_format(BCFormat fmt) {
+        switch (fmt) {
+            case BCFormat::BC1: return 71;  // DXGI_FORMAT_BC1_UNORM
+            case BCFormat::BC2: return 74;  // DXGI_FORMAT_BC2_UNORM
+            case BCFormat::BC3: return 77;  // DXGI_FORMAT_BC3_UNORM
+            case BCFormat::BC4: return 80;  // DXGI_FORMAT_BC4_UNORM
+            case BCFormat::BC5: return 83;  // DXGI_FORMAT_BC5_UNORM
+            default: return 0;
+        }
+    }
+
+    void put32(std::vector<uint8_t> &out, uint32_t v) {
+        out.push_back(v & 0xFF);
+        out.push_back((v >> 8) & 0xFF);
+        out.push_back((v >> 16) & 0xFF);
+        out.push_back((v >> 24) & 0xFF);
+    }
+
+    struct Level {
+        int w, h;
+        const TexInfo::MipDef *mip;
+    };
+}
+
+bool tex_to_dds(const std::vector<unsigned char> &tex_buf, std::vector<uint8_t> &out, bool tiled) {
+    TexInfo ti;
+    if (!parse_tex_info(tex_buf, ti) || ti.Mips.empty()) return false;
+    BCFormat fmt = bc_format_from_pixel_format(ti.PixelFormat);
+    if (fmt == BCFormat::None) return false;
+
+    std::vector<Level> raw;
+    for (size_t i = 0; i < ti.Mips.size(); ++i) {
+        const auto &m = ti.Mips[i];
+        if (m.CompFlag != 7 || m.MipDataOffset + m.MipDataSizeParsed > tex_buf.size()) continue;
+        int w = m.HasWH ? (int) m.MipWidth : std::max(1, (int) ti.TextureWidth >> (int) i);
+        int h = m.HasWH ? (int) m.MipHeight : std::max(1, (int) ti.TextureHeight >> (int) i);
+        if (w > 0 && h > 0) raw.push_back({w, h, &m});
+    }
+    if (raw.empty()) return false;
+    std::stable_sort(raw.begin(), raw.end(), [](const Level &a, const Level &b) {
+        return (size_t) a.w * a.h > (size_t) b.w * b.h;
+    });
+
+    // Keep the largest mip and every following level that halves it exactly
+    // and carries enough data; a DDS chain cannot have holes.
+    std::vector<Level> chain{raw[0]};
+    for (size_t i = 1; i < raw.size(); ++i) {
+        const Level &prev = chain.back();
+        int w = std::max(1, prev.w / 2), h = std::max(1, prev.h / 2);
+        if (raw[i].w == prev.w && raw[i].h == prev.h) continue;
+        if (raw[i].w != w || raw[i].h != h) break;
+        if (!tiled && raw[i].mip->MipDataSizeParsed < bc_surface_bytes(fmt, w, h)) break;
+        chain.push_back(raw[i]);
+    }
+    if (!tiled && chain[0].mip->MipDataSizeParsed < bc_surface_bytes(fmt, chain[0].w, chain[0].h)) return false;
+
+    const uint32_t mips = (uint32_t) chain.size();
+    const int w0 = chain[0].w, h0 = chain[0].h;
+
+    out.clear();
+    out.reserve(4 + 124 + 20 + tex_buf.size());
+    out.insert(out.end(), {'D', 'D', 'S', ' '});
+    put32(out, 124);
+    put32(out, DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE |
+               (mips > 1 ? DDSD_MIPMAPCOUNT : 0));
+    put32(out, (uint32_t) h0);
+    put32(out, (uint32_t) w0);
+    put32(out, (uint32_t) bc_surface_bytes(fmt, w0, h0));
+    put32(out, 0);
+    put32(out, mips);
+    for (int i = 0; i < 11; ++i) put32(out, 0);
+    put32(out, 32);
+    put32(out, DDPF_FOURCC);
+    out.insert(out.end(), {'D', 'X', '1', '0'});
+    for (int i = 0; i < 5; ++i) put32(out, 0);
+    put32(out, DDSCAPS_TEXTURE | (mips > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0));
+    for (int i = 0; i < 4; ++i) put32(out, 0);
+
+    put32(out, dxgi_format(fmt));
+    put32(out, D3D10_RESOURCE_DIMENSION_TEXTURE2D);
+    put32(out, 0);
+    put32(out, 1);
+    put32(out, 0);
+
+    std::vector<uint8_t> linear;
+    for (const Level &lv: chain) {
+        const uint8_t *src = tex_buf.data() + lv.mip->MipDataOffset;
+        size_t need = bc_surface_bytes(fmt, lv.w, lv.h);
+        if (tiled) {
+            if (!x360_untile_bc(fmt, src, lv.mip->MipDataSizeParsed, lv.w, lv.h, linear)) return false;
+            src = linear.data();
+        }
+        size_t at = out.size();
+        out.resize(at + need);
+        bc_to_little_endian(fmt, src, need, out.data() + at);
+    }
+    return true;
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Repackages the raw (CompFlag 7) mips of a rebuilt .tex as a DDS file with a
+// DX10 header, largest mip first. Block data is only byte-swapped (and
+// untiled when `tiled` is set), never decoded, so every mip keeps its
+// original encoding. The chain stops at the first missing or short level.
+bool tex_to_dds(const std::vector<unsigned char> &tex_buf, std::vector<uint8_t> &out, bool tiled = false);
@@ -0,0 +1,453 @@
+#include "FileTree.h"
+#include "Utils.h"
+#include "BNKCore.cpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <thread>
+#include <unordered_set>
+
+struct FileTreeJobs {
+    struct Child {
+        std::string name;
+        bool is_file;
+        uint32_t lo, hi, prefix_len;
+    };
+    struct Result {
+        uint32_t node;
+        uint32_t catalog_id;
+        std::shared_ptr<const FileTreeCatalog> catalog;
+        std::vector<Child> children;
+        std::string nested_key;
+        FileTreeNested nested;
+    };
+
+    std::mutex mutex;
+    std::vector<Result> done;
+};
+
+void FileTree::clear() {
+    nodes.clear();
+    sources.clear();
+    catalogs.clear();
+    nested.clear();
+    jobs.reset();
+    blocks.clear();
+    block_used = BLOCK_SIZE;
+    segs.clear();
+    seg_ids.clear();
+}
+
+uint32_t FileTree::intern(std::string_view seg) {
+    auto it = seg_ids.find(seg);
+    if (it != seg_ids.end()) return it->second;
+
+    char *dst;
+    if (seg.size() > BLOCK_SIZE) {
+        // Oversized segments get their own block, kept behind the block
+        // currently being filled.
+        auto pos = blocks.empty() ? blocks.end() : blocks.end() - 1;
+        dst = blocks.insert(pos, std::unique_ptr<char[]>(new char[seg.size()]))->get();
+    } else {
+        if (blocks.empty() || block_used + seg.size() > BLOCK_SIZE) {
+            blocks.emplace_back(new char[BLOCK_SIZE]);
+            block_used = 0;
+        }
+        dst = blocks.back().get() + block_used;
+        block_used += seg.size();
+    }
+    if (!seg.empty()) std::memcpy(dst, seg.data(), seg.size());
+
+    std::string_view stored(dst, seg.size());
+    uint32_t id = (uint32_t)segs.size();
+    segs.push_back(stored);
+    seg_ids.emplace(stored, id);
+    return id;
+}
+
+std::string FileTree::full_path(uint32_t node) const {
+    std::vector<uint32_t> chain;
+    for (uint32_t n = node; n != 0 && n != FT_NONE; n = nodes[n].parent) chain.push_back(n);
+    std::string out;
+    for (size_t i = chain.size(); i-- > 0;) {
+        out += name(chain[i]);
+        if (i) out += '/';
+    }
+    return out;
+}
+
+std::string FileTree::entry_path(uint32_t node) const {
+    const auto &n = nodes[node];
+    if (!n.is_file() || n.parent == FT_NONE) return full_path(node);
+    const auto &cat = catalogs[nodes[n.parent].catalog];
+    if (!cat || n.record >= cat->recs.size()) return full_path(node);
+    return cat->prefix + cat->recs[n.record].path;
+}
+
+namespace {
+    // Folders with more records than this are grouped on a worker thread.
+    constexpr uint32_t SYNC_LIST_LIMIT = 20000;
+
+    // Numbers each nested extraction, so two jobs for the same entry (say a
+    // refresh while the first is still listing) never write one temp file.
+    std::atomic<uint32_t> g_extract_serial{0};
+
+    bool is_header_bnk(const std::string &bnk_path) {
+        return to_lower(std::filesystem::path(bnk_path).filename().string()).find("header") != std::string::npos;
+    }
+
+    bool ends_with_bnk(std::string_view name) {
+        if (name.size() < 4) return false;
+        return to_lower(std::string(name.substr(name.size() - 4))) == ".bnk";
+    }
+
+    // Backslashes become '/', empty segments are dropped.
+    std::string normalize_path(const std::string &p) {
+        std::string out;
+        out.reserve(p.size());
+        for (char c : p) {
+            if (c == '\\') c = '/';
+            if (c == '/' && (out.empty() || out.back() == '/')) continue;
+            out.push_back(c);
+        }
+        while (!out.empty() && out.back() == '/') out.pop_back();
+        return out;
+    }
+
+    void list_into(const std::string &bnk_path, uint32_t source, std::vector<FileTreeRecord> &out) {
+        try {
+            BNKReader reader(bnk_path);
+            const auto &files = reader.list_files();
+            out.reserve(files.size());
+            for (size_t i = 0; i < files.size(); ++i) {
+                std::string p = normalize_path(files[i].name);
+                if (p.empty()) continue;
+                out.push_back({std::move(p), source, (int)i, files[i].uncompressed_size});
+            }
+        } catch (...) {
+            out.clear();
+        }
+    }
+
+    // Duplicate paths are kept, ordered by archive then entry; the last one
+    // is the one shown, so later archives win as with the old map insert.
+    // Keeping the shadowed records lets a refresh drop an archive without
+    // relisting the ones it was shadowing.
+    void sort_records(std::vector<FileTreeRecord> &recs) {
+        std::sort(recs.begin(), recs.end(), [](const FileTreeRecord &a, const FileTreeRecord &b) {
+            int c = a.path.compare(b.path);
+            if (c != 0) return c < 0;
+            if (a.source != b.source) return a.source < b.source;
+            return a.index < b.index;
+        });
+    }
+
+    std::string nested_key(const std::string &parent_source, const std::string &entry) {
+        return parent_source + '\n' + entry;
+    }
+
+    // Children of a folder are the distinct next segments of its record
+    // range. A record that ends at the segment is a file; any record that
+    // continues past it makes the segment a folder owning [lo, hi).
+    std::vector<FileTreeJobs::Child> group_children(const FileTreeCatalog &cat, uint32_t lo, uint32_t hi, uint32_t prefix_len) {
+        std::vector<FileTreeJobs::Child> out;
+        uint32_t i = lo;
+        while (i < hi) {
+            const std::string &p = cat.recs[i].path;
+            size_t end = p.find('/', prefix_len);
+            std::string_view seg(p.data() + prefix_len, (end == std::string::npos ? p.size() : end) - prefix_len);
+
+            FileTreeJobs::Child c{std::string(seg), true, i, i, prefix_len};
+            uint32_t cont = i;
+            while (i < hi) {
+                const std::string &pi = cat.recs[i].path;
+                if (pi.size() - prefix_len < seg.size() || pi.compare(prefix_len, seg.size(), seg) != 0) break;
+                size_t after = prefix_len + seg.size();
+                if (after == pi.size()) {
+                    cont = ++i;
+                    continue;
+                }
+                if (pi[after] != '/') break;
+                c.is_file = false;
+                ++i;
+            }
+            if (c.is_file) {
+                c.lo = i - 1;
+                c.hi = i;
+            } else {
+                c.lo = cont;
+                c.hi = i;
+                c.prefix_len = (uint32_t)(prefix_len + seg.size() + 1);
+            }
+            out.push_back(std::move(c));
+        }
+
+        std::sort(out.begin(), out.end(), [](const FileTreeJobs::Child &a, const FileTreeJobs::Child &b) {
+            if (a.is_file != b.is_file) return !a.is_file;
+            return a.name < b.name;
+        });
+        return out;
+    }
+
+    void attach_children(FileTree &tree, uint32_t node, const std::vector<FileTreeJobs::Child> &children) {
+        uint32_t first = (uint32_t)tree.nodes.size();
+        uint32_t cat_id = tree.nodes[node].catalog;
+        const FileTreeCatalog &cat = *tree.catalogs[cat_id];
+
+        tree.nodes.reserve(tree.nodes.size() + children.size());
+        for (const auto &c : children) {
+            FileTreeNode n;
+            n.name = tree.intern(c.name);
+            n.parent = node;
+            if (c.is_file) {
+                const FileTreeRecord &r = cat.recs[c.lo];
+                n.source = r.source;
+                n.bnk_index = r.index;
+                n.file_size = r.size;
+                n.record = c.lo;
+                n.is_archive = ends_with_bnk(c.name);
+                if (!n.is_archive) n.list_state = FT_LISTED;
+            } else {
+                n.catalog = cat_id;
+                n.lo = c.lo;
+                n.hi = c.hi;
+                n.prefix_len = c.prefix_len;
+            }
+            tree.nodes.push_back(n);
+        }
+
+        auto &parent = tree.nodes[node];
+        parent.first_child = first;
+        parent.child_count = (uint32_t)children.size();
+        parent.list_state = FT_LISTED;
+    }
+
+    void set_node_catalog(FileTree &tree, uint32_t node, uint32_t catalog_id, std::shared_ptr<const FileTreeCatalog> cat) {
+        auto &n = tree.nodes[node];
+        n.catalog = catalog_id;
+        n.lo = 0;
+        n.hi = (uint32_t)cat->recs.size();
+        n.prefix_len = 0;
+        tree.catalogs[catalog_id] = std::move(cat);
+    }
+
+    void attach_root(FileTree &tree, std::shared_ptr<FileTreeCatalog> cat) {
+        sort_records(cat->recs);
+        tree.catalogs.push_back(cat);
+
+        FileTreeNode root;
+        root.name = tree.intern("");
+        root.catalog = 0;
+        root.lo = 0;
+        root.hi = (uint32_t)cat->recs.size();
+        tree.nodes.push_back(root);
+        attach_children(tree, 0, group_children(*cat, root.lo, root.hi, 0));
+    }
+}
+
+void build_unified_file_tree(FileTree &tree, const std::vector<std::string> &bnk_paths) {
+    tree.clear();
+    tree.jobs = std::make_shared<FileTreeJobs>();
+
+    for (const auto &p : bnk_paths)
+        if (!is_header_bnk(p)) tree.sources.push_back(p);
+
+    std::vector<std::vector<FileTreeRecord>> listings(tree.sources.size());
+    parallel_for(tree.sources.size(), [&](size_t k) {
+        list_into(tree.sources[k], (uint32_t)k, listings[k]);
+    });
+
+    auto cat = std::make_shared<FileTreeCatalog>();
+    size_t total = 0;
+    for (auto &l : listings) total += l.size();
+    cat->recs.reserve(total);
+    for (auto &l : listings) {
+        for (auto &r : l) cat->recs.push_back(std::move(r));
+        std::vector<FileTreeRecord>().swap(l);
+    }
+    attach_root(tree, std::move(cat));
+}
+
+FileTreeSnapshot file_tree_snapshot(const FileTree &tree) {
+    FileTreeSnapshot snap;
+    snap.sources = tree.sources;
+    if (!tree.catalogs.empty()) snap.root = tree.catalogs[0];
+    snap.nested = tree.nested;
+    return snap;
+}
+
+void refresh_unified_file_tree(FileTree &tree, const FileTreeSnapshot &prev, const std::vector<std::string> &bnk_paths, const std::vector<std::string> &changed) {
+    tree.clear();
+    tree.jobs = std::make_shared<FileTreeJobs>();
+
+    std::unordered_map<std::string, uint32_t> source_ids;
+    for (const auto &p : bnk_paths) {
+        if (is_header_bnk(p)) continue;
+        source_ids.emplace(p, (uint32_t)tree.sources.size());
+        tree.sources.push_back(p);
+    }
+    std::unordered_set<std::string> dirty(changed.begin(), changed.end());
+
+    // Old source id -> new source id, for archives that are still present
+    // and were not touched. Everything else is listed again.
+    std::vector<uint32_t> remap(prev.sources.size(), FT_NONE);
+    std::vector<char> kept(tree.sources.size(), 0);
+    for (size_t k = 0; k < prev.sources.size(); ++k) {
+        if (dirty.count(prev.sources[k])) continue;
+        auto it = source_ids.find(prev.sources[k]);
+        if (it == source_ids.end()) continue;
+        remap[k] = it->second;
+        kept[it->second] = 1;
+    }
+
+    auto cat = std::make_shared<FileTreeCatalog>();
+    if (prev.root) {
+        cat->recs.reserve(prev.root->recs.size());
+        for (const auto &r : prev.root->recs) {
+            if (r.source >= remap.size() || remap[r.source] == FT_NONE) continue;
+            cat->recs.push_back({r.path, remap[r.source], r.index, r.size});
+        }
+    }
+
+    std::vector<uint32_t> todo;
+    for (uint32_t k = 0; k < (uint32_t)tree.sources.size(); ++k)
+        if (!kept[k]) todo.push_back(k);
+    std::vector<std::vector<FileTreeRecord>> listings(todo.size());
+    parallel_for(todo.size(), [&](size_t t) {
+        list_into(tree.sources[todo[t]], todo[t], listings[t]);
+    });
+    for (auto &l : listings)
+        for (auto &r : l) cat->recs.push_back(std::move(r));
+    attach_root(tree, std::move(cat));
+
+    for (const auto &kv : prev.nested) {
+        const auto &parent = kv.second.parent_source;
+        if (!dirty.count(parent) && source_ids.count(parent)) tree.nested.insert(kv);
+    }
+}
+
+void file_tree_expand(FileTree &tree, uint32_t node) {
+    if (node >= tree.nodes.size() || !tree.jobs) return;
+    FileTreeNode &n = tree.nodes[node];
+    if (n.list_state != FT_UNLISTED) return;
+
+    auto jobs = tree.jobs;
+
+    if (n.is_archive) {
+        std::string parent_source = tree.sources[n.source];
+        std::string entry = tree.entry_path(node);
+        int index = n.bnk_index;
+
+        auto tmpdir = std::filesystem::temp_directory_path() / "f2_nested_bnk_tree";
+        std::error_code ec;
+        std::filesystem::create_directories(tmpdir, ec);
+        std::string temp_path = (tmpdir / ("nested_" + std::to_string(std::hash<std::string>{}(parent_source + entry)) +
+                                           "_" + std::to_string(++g_extract_serial) + ".bnk")).string();
+
+        auto slash = entry.rfind('/');
+        std::string prefix = slash == std::string::npos ? "" : entry.substr(0, slash + 1);
+        std::string key = nested_key(parent_source, entry);
+
+        uint32_t source_id = (uint32_t)tree.sources.size();
+        uint32_t catalog_id = (uint32_t)tree.catalogs.size();
+
+        // Listed before the last refresh and its parent is unchanged: reuse
+        // the extracted copy, only the source id needs rewriting.
+        auto cached = tree.nested.find(key);
+        if (cached != tree.nested.end() && cached->second.catalog) {
+            auto cat = std::make_shared<FileTreeCatalog>(*cached->second.catalog);
+            for (auto &r : cat->recs) r.source = source_id;
+            tree.sources.push_back(cached->second.temp_path);
+            tree.catalogs.push_back(nullptr);
+            set_node_catalog(tree, node, catalog_id, cat);
+            attach_children(tree, node, group_children(*cat, 0, (uint32_t)cat->recs.size(), 0));
+            return;
+        }
+
+        tree.sources.push_back(temp_path);
+        tree.catalogs.push_back(nullptr);
+        n.list_state = FT_LISTING;
+
+        std::thread([jobs, node, parent_source, index, temp_path, prefix, key, source_id, catalog_id]() {
+            auto cat = std::make_shared<FileTreeCatalog>();
+            cat->prefix = prefix;
+            try {
+                extract_one(parent_source, index, temp_path);
+                list_into(temp_path, source_id, cat->recs);
+            } catch (...) {
+                cat->recs.clear();
+            }
+            sort_records(cat->recs);
+
+            FileTreeJobs::Result res{node, catalog_id, cat, group_children(*cat, 0, (uint32_t)cat->recs.size(), 0),
+                                     key, {parent_source, temp_path, cat}};
+            std::lock_guard<std::mutex> lock(jobs->mutex);
+            jobs->done.push_back(std::move(res));
+        }).detach();
+        return;
+    }
+
+    auto cat = tree.catalogs[n.catalog];
+    if (!cat) return;
+
+    if (n.hi - n.lo <= SYNC_LIST_LIMIT) {
+        attach_children(tree, node, group_children(*cat, n.lo, n.hi, n.prefix_len));
+        return;
+    }
+
+    n.list_state = FT_LISTING;
+    uint32_t lo = n.lo, hi = n.hi, prefix_len = n.prefix_len, catalog_id = n.catalog;
+    std::thread([jobs, node, cat, lo, hi, prefix_len, catalog_id]() {
+        FileTreeJobs::Result res{node, catalog_id, nullptr, group_children(*cat, lo, hi, prefix_len), {}, {}};
+        std::lock_guard<std::mutex> lock(jobs->mutex);
+        jobs->done.push_back(std::move(res));
+    }).detach();
+}
+
+void file_tree_poll(FileTree &tree) {
+    if (!tree.jobs) return;
+    std::vector<FileTreeJobs::Result> done;
+    {
+        std::lock_guard<std::mutex> lock(tree.jobs->mutex);
+        done.swap(tree.jobs->done);
+    }
+    for (auto &res : done) {
+        if (res.node >= tree.nodes.size()) continue;
+        if (res.catalog) {
+            set_node_catalog(tree, res.node, res.catalog_id, res.catalog);
+            if (!res.nested_key.empty()) tree.nested[res.nested_key] = std::move(res.nested);
+        }
+        attach_children(tree, res.node, res.children);
+    }
+}
+
+bool find_mdl_files_in_folder(const FileTree &tree, const std::string &folder_name, std::vector<std::pair<std::string, std::string>> &out_mdl_paths) {
+    out_mdl_paths.clear();
+
+    uint32_t folder = FT_NONE;
+    for (uint32_t n = 1; n < tree.nodes.size(); ++n) {
+        if (!tree.nodes[n].is_file() && tree.name(n) == folder_name) {
+            folder = n;
+            break;
+        }
+    }
+    if (folder == FT_NONE) return false;
+
+    // Direct children are read from the catalog so an unexpanded folder
+    // still answers.
+    const auto &f = tree.nodes[folder];
+    const auto &cat = tree.catalogs[f.catalog];
+    if (!cat) return false;
+    for (uint32_t i = f.lo; i < f.hi; ++i) {
+        const auto &r = cat->recs[i];
+        if (r.path.find('/', f.prefix_len) != std::string::npos) continue;
+        if (i + 1 < f.hi && cat->recs[i + 1].path == r.path) continue;
+        std::string fname = to_lower(r.path.substr(f.prefix_len));
+        if (fname == "interior.mdl" || fname == "exterior.mdl")
+            out_mdl_paths.push_back({cat->prefix + r.path, tree.sources[r.source]});
+    }
+
+    return !out_mdl_paths.empty();
+}
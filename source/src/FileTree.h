@@ -0,0 +1,109 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <cstdint>
+
+constexpr uint32_t FT_NONE = 0xFFFFFFFFu;
+
+enum : uint8_t {
+    FT_UNLISTED = 0,
+    FT_LISTING = 1,
+    FT_LISTED = 2,
+};
+
+struct FileTreeRecord {
+    std::string path;
+    uint32_t source;
+    int index;
+    uint32_t size;
+};
+
+// Sorted, normalized listing of one or more archives. Records sharing a path
+// prefix are contiguous, so any folder is a [lo, hi) range of records.
+struct FileTreeCatalog {
+    std::string prefix;
+    std::vector<FileTreeRecord> recs;
+};
+
+struct FileTreeNode {
+    uint32_t name = 0;
+    uint32_t parent = FT_NONE;
+    uint32_t first_child = 0;
+    uint32_t child_count = 0;
+    uint32_t source = FT_NONE;
+    int bnk_index = -1;
+    uint32_t file_size = 0;
+    uint32_t record = FT_NONE;
+    uint32_t catalog = FT_NONE;
+    uint32_t lo = 0, hi = 0;
+    uint32_t prefix_len = 0;
+    uint8_t list_state = FT_UNLISTED;
+    bool is_archive = false;
+
+    bool is_file() const { return source != FT_NONE; }
+    bool expandable() const { return !is_file() || is_archive; }
+};
+
+// Listing of a nested archive extracted to temp_path, kept so a rebuild can
+// reattach it without extracting again while its parent is unchanged.
+struct FileTreeNested {
+    std::string parent_source;
+    std::string temp_path;
+    std::shared_ptr<const FileTreeCatalog> catalog;
+};
+
+struct FileTreeJobs;
+
+// Flat tree: nodes[0] is the root, children of a node are contiguous and
+// already ordered for display (folders first, then by name). Segment names
+// are interned once into a block arena and referenced by id.
+//
+// The tree is lazy: only the root is listed up front from the catalog.
+// Folders and nested archives get their children on first expand; large
+// folders and nested archives are listed on a background thread and
+// attached by file_tree_poll() on the UI thread.
+class FileTree {
+public:
+    std::vector<FileTreeNode> nodes;
+    std::vector<std::string> sources;
+    std::vector<std::shared_ptr<const FileTreeCatalog>> catalogs;
+    std::unordered_map<std::string, FileTreeNested> nested;
+    std::shared_ptr<FileTreeJobs> jobs;
+
+    void clear();
+    uint32_t intern(std::string_view seg);
+    std::string_view name(uint32_t node) const { return segs[nodes[node].name]; }
+    std::string full_path(uint32_t node) const;
+    std::string entry_path(uint32_t node) const;
+    size_t arena_bytes() const { return blocks.size() * BLOCK_SIZE; }
+
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t block_used = BLOCK_SIZE;
+    std::vector<std::string_view> segs;
+    std::unordered_map<std::string_view, uint32_t> seg_ids;
+};
+
+// What a refresh needs from the previous tree; taken on the UI thread so the
+// live tree can keep being expanded while the new one is built.
+struct FileTreeSnapshot {
+    std::vector<std::string> sources;
+    std::shared_ptr<const FileTreeCatalog> root;
+    std::unordered_map<std::string, FileTreeNested> nested;
+};
+
+void build_unified_file_tree(FileTree &tree, const std::vector<std::string> &bnk_paths);
+FileTreeSnapshot file_tree_snapshot(const FileTree &tree);
+// Rebuilds from prev, relisting only the archives in changed (added,
+// removed or rewritten). Records and nested listings of every other archive
+// are carried over.
+void refresh_unified_file_tree(FileTree &tree, const FileTreeSnapshot &prev, const std::vector<std::string> &bnk_paths, const std::vector<std::string> &changed);
+void file_tree_expand(FileTree &tree, uint32_t node);
+void file_tree_poll(FileTree &tree);
+bool find_mdl_files_in_folder(const FileTree &tree, const std::string &folder_name, std::vector<std::pair<std::string, std::string>> &out_mdl_paths);
@@ -6,6 +6,7 @@
 #include "TexParser.h"
 #include "ModelParser.h"
 #include "ModelPreview.h"
+#include "X360Tiling.h"
 #include "BNKCore.cpp"
 #include "imgui.h"
 #include "imgui_hex.h"
@@ -49,76 +50,6 @@ static bool is_bc_format(uint32_t comp_flag, DXGI_FORMAT& out_fmt) {
     return false;
 }
 
-static bool reconstruct_nested_mdl(const std::string& nested_bnk_path, int file_index, std::vector<unsigned char>& out) {
-    try {
-        BNKReader nested_reader(nested_bnk_path);
-        const auto& files = nested_reader.list_files();
-        if (file_index < 0 || file_index >= (int)files.size()) return false;
-
-        std::string mdl_name = files[file_index].name;
-
-        auto tmpdir = std::filesystem::temp_directory_path() / "f2_nested_mdl_reconstruct";
-        std::error_code ec;
-        std::filesystem::create_directories(tmpdir, ec);
-
-        auto tmp_body = tmpdir / "body.bin";
-        extract_one(nested_bnk_path, file_index, tmp_body.string());
-        auto body_data = read_all_bytes(tmp_body);
-        std::filesystem::remove(tmp_body, ec);
-
-        if (body_data.empty()) return false;
-
-        auto p_headers = find_bnk_by_filename("globals_model_headers.bnk");
-        if (!p_headers) {
-            out = body_data;
-            return true;
-        }
-
-        BNKReader r_headers(*p_headers);
-        const auto& header_files = r_headers.list_files();
-
-        std::string mdl_filename = std::filesystem::path(mdl_name).filename().string();
-        std::string mdl_lower = mdl_filename;
-        std::transform(mdl_lower.begin(), mdl_lower.end(), mdl_lower.begin(), ::tolower);
-
-        int header_idx = -1;
-        for (size_t i = 0; i < header_files.size(); ++i) {
-            std::string hname = std::filesystem::path(header_files[i].name).filename().string();
-            std::string hname_lower = hname;
-            std::transform(hname_lower.begin(), hname_lower.end(), hname_lower.begin(), ::tolower);
-            if (hname_lower == mdl_lower) {
-                header_idx = (int)i;
-                break;
-            }
-        }
-
-        if (header_idx == -1) {
-            out = body_data;
-            return true;
-        }
-
-        auto tmp_header = tmpdir / "header.bin";
-        extract_one(*p_headers, header_idx, tmp_header.string());
-        auto header_data = read_all_bytes(tmp_header);
-        std::filesystem::remove(tmp_header, ec);
-
-        if (header_data.empty()) {
-            out = body_data;
-            return true;
-        }
-
-        out.clear();
-        out.reserve(header_data.size() + body_data.size());
-        out.insert(out.end(), header_data.begin(), header_data.end());
-        out.insert(out.end(), body_data.begin(), body_data.end());
-
-        return true;
-
-    } catch (...) {
-        return false;
-    }
-}
-
 std::vector<ADBEntry> decompress_adb(const std::string& path) {
     std::vector<ADBEntry> result;
 
@@ -258,10 +189,8 @@ void open_hex_for_selected() {
 
     auto item = S.files[(size_t) idx];
     auto name = item.name;
-    std::string lower = name;
-    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
-    bool want_tex = is_tex_file(lower);
-    bool want_mdl = is_mdl_file(lower);
+    bool want_tex = item.type == AssetType::Tex;
+    bool want_mdl = item.type == AssetType::Mdl;
 
     progress_open(0, "Loading hex.");
     S.hex_loading.store(true);
@@ -275,7 +204,7 @@ void open_hex_for_selected() {
                 ok = build_any_tex_buffer_for_name(name, buf);
             } else if (want_mdl) {
                 if (is_nested) {
-                    ok = reconstruct_nested_mdl(bnk_to_use, item.index, buf);
+                    ok = build_nested_mdl_buffer(bnk_to_use, item.index, buf);
                 } else {
                     ok = build_mdl_buffer_for_name(name, buf);
                 }
@@ -548,6 +477,14 @@ void draw_hex_window(ID3D11Device *device) {
     if(ImGui::BeginPopupModal("Mip Preview", nullptr, ImGuiWindowFlags_None)){
         if(S.preview_mip_index >= 0 && S.preview_mip_index < (int)S.tex_info.Mips.size()){
             const auto& m = S.tex_info.Mips[S.preview_mip_index];
+            std::string tex_name;
+            if(S.selected_file_index >= 0 && S.selected_file_index < (int)S.files.size())
+                tex_name = S.files[(size_t)S.selected_file_index].name;
+            bool tiled = !tex_name.empty() && texture_is_tiled(tex_name);
+            if(!tex_name.empty() && ImGui::Checkbox("Tiled (Xbox 360)", &tiled)){
+                set_texture_tiled(tex_name, tiled);
+                if(S.preview_srv) { S.preview_srv->Release(); S.preview_srv = nullptr; }
+            }
             if(!S.preview_srv){
                 uint32_t base_w = S.tex_info.TextureWidth;
                 uint32_t base_h = S.tex_info.TextureHeight;
@@ -562,7 +499,10 @@ void draw_hex_window(ID3D11Device *device) {
                     else if(S.tex_info.PixelFormat == 40) fmt = DXGI_FORMAT_BC5_UNORM;
 
                     size_t blocks_x = (w + 3) / 4;
-                    std::vector<uint8_t> payload(src, src + src_sz);
+                    std::vector<uint8_t> payload;
+                    BCFormat bc_fmt = bc_format_from_pixel_format(S.tex_info.PixelFormat);
+                    if(tiled && bc_fmt != BCFormat::None) x360_untile_bc(bc_fmt, src, src_sz, (int)w, (int)h, payload);
+                    else payload.assign(src, src + src_sz);
 
                     for(size_t i = 0; i + 8 <= payload.size(); i += 8) {
                         uint16_t c0 = (payload[i+0] << 8) | payload[i+1];
@@ -0,0 +1,733 @@
+#include "MeshProcess.h"
+#include "Simd.h"
+#include "Utils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+namespace {
+    // Below this many items per chunk the thread start-up costs more than it saves.
+    constexpr size_t GRAIN = 16384;
+
+    int resolve_threads(int max_threads) {
+        int cores = (int) std::max(1u, std::thread::hardware_concurrency());
+        return max_threads <= 0 ? cores : std::min(max_threads, cores);
+    }
+
+    template<class Fn>
+    void for_ranges(size_t count, int max_threads, const Fn &fn) {
+        if (count == 0) return;
+        max_threads = resolve_threads(max_threads);
+        size_t chunks = (count + GRAIN - 1) / GRAIN;
+        parallel_for(chunks, [&](size_t c) { fn(c * GRAIN, std::min(count, (c + 1) * GRAIN)); }, max_threads);
+    }
+
+    // Corners grouped by vertex: corners[begin[v] .. begin[v + 1]) are the
+    // index-buffer positions referencing v, in ascending order. Triangles
+    // with an out-of-range index are left out.
+    struct VertexCorners {
+        std::vector<uint32_t> begin;
+        std::vector<uint32_t> corners;
+    };
+
+    bool face_valid(const std::vector<uint32_t> &idx, size_t f, size_t vcount) {
+        return idx[f * 3] < vcount && idx[f * 3 + 1] < vcount && idx[f * 3 + 2] < vcount;
+    }
+
+    VertexCorners sort_corners(const std::vector<uint32_t> &idx, size_t vcount) {
+        VertexCorners vc;
+        vc.begin.assign(vcount + 1, 0);
+        size_t faces = idx.size() / 3;
+        for (size_t f = 0; f < faces; ++f) {
+            if (!face_valid(idx, f, vcount)) continue;
+            for (int k = 0; k < 3; ++k) ++vc.begin[idx[f * 3 + k] + 1];
+        }
+        for (size_t v = 0; v < vcount; ++v) vc.begin[v + 1] += vc.begin[v];
+        vc.corners.resize(vc.begin[vcount]);
+        std::vector<uint32_t> fill(vc.begin.begin(), vc.begin.end() - 1);
+        for (size_t f = 0; f < faces; ++f) {
+            if (!face_valid(idx, f, vcount)) continue;
+            for (int k = 0; k < 3; ++k) vc.corners[fill[idx[f * 3 + k]]++] = (uint32_t) (f * 3 + k);
+        }
+        return vc;
+    }
+
+    // Cross product of the edges from a, twice the triangle's area vector.
+    void cross3(const float *a, const float *b, const float *c, float *out) {
+        float ux = b[0] - a[0], uy = b[1] - a[1], uz = b[2] - a[2];
+        float vx = c[0] - a[0], vy = c[1] - a[1], vz = c[2] - a[2];
+        out[0] = uy * vz - uz * vy;
+        out[1] = uz * vx - ux * vz;
+        out[2] = ux * vy - uy * vx;
+    }
+
+    // Unnormalized normal of face f (cross of the edges, so area-weighted)
+    // into out[0..2]; out[3] is scratch. False for a face with an
+    // out-of-range index.
+    inline bool face_normal(const std::vector<float> &pos, const std::vector<uint32_t> &idx, size_t f,
+                            size_t vcount, float *out) {
+        uint32_t i0 = idx[f * 3], i1 = idx[f * 3 + 1], i2 = idx[f * 3 + 2];
+        uint32_t top = std::max(i0, std::max(i1, i2));
+        if (top >= vcount) return false;
+#if F2_SIMD_X86
+        // Each corner loads as xyz plus the next float, so only faces using
+        // the last vertex (nothing after it) take the scalar path.
+        if (top + 1 < vcount) {
+            __m128 a = _mm_loadu_ps(&pos[(size_t) i0 * 3]);
+            __m128 u = _mm_sub_ps(_mm_loadu_ps(&pos[(size_t) i1 * 3]), a);
+            __m128 v = _mm_sub_ps(_mm_loadu_ps(&pos[(size_t) i2 * 3]), a);
+            __m128 u_yzx = _mm_shuffle_ps(u, u, _MM_SHUFFLE(3, 0, 2, 1));
+            __m128 v_yzx = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 2, 1));
+            __m128 c = _mm_sub_ps(_mm_mul_ps(u, v_yzx), _mm_mul_ps(u_yzx, v));
+            _mm_storeu_ps(out, _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1)));
+            return true;
+        }
+#endif
+        cross3(&pos[(size_t) i0 * 3], &pos[(size_t) i1 * 3], &pos[(size_t) i2 * 3], out);
+        return true;
+    }
+
+    void normalize3(float *v, float fx, float fy, float fz) {
+        float l = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        if (l > 1e-6f) {
+            v[0] /= l;
+            v[1] /= l;
+            v[2] /= l;
+        } else {
+            v[0] = fx;
+            v[1] = fy;
+            v[2] = fz;
+        }
+    }
+
+    uint64_t hash_bytes(uint64_t h, const uint8_t *p, size_t n) {
+        for (size_t i = 0; i < n; ++i) h = (h ^ p[i]) * 0x100000001b3ull;
+        return h;
+    }
+
+    // Slots for vertices whose bytes match in every stream, numbered in
+    // order of first occurrence.
+    size_t weld_slots(const std::vector<VertexStream> &streams, size_t vcount, std::vector<uint32_t> &remap) {
+        remap.assign(vcount, UINT32_MAX);
+        auto same = [&](size_t a, size_t b) {
+            for (const VertexStream &s : streams) {
+                const uint8_t *p = (const uint8_t *) s.data;
+                if (std::memcmp(p + a * s.stride, p + b * s.stride, s.stride) != 0) return false;
+            }
+            return true;
+        };
+
+        // Open addressing over the first vertex of each slot, at most half full.
+        size_t buckets = 1;
+        while (buckets < vcount * 2) buckets <<= 1;
+        std::vector<uint32_t> table(buckets, UINT32_MAX);
+        size_t slots = 0;
+        for (size_t v = 0; v < vcount; ++v) {
+            uint64_t h = 0xcbf29ce484222325ull;
+            for (const VertexStream &s : streams) h = hash_bytes(h, (const uint8_t *) s.data + v * s.stride, s.stride);
+            size_t b = (size_t) (h ^ (h >> 32)) & (buckets - 1);
+            while (table[b] != UINT32_MAX && !same(table[b], v)) b = (b + 1) & (buckets - 1);
+            if (table[b] == UINT32_MAX) {
+                table[b] = (uint32_t) v;
+                remap[v] = (uint32_t) slots++;
+            } else {
+                remap[v] = remap[table[b]];
+            }
+        }
+        return slots;
+    }
+
+    // Post-transform cache model shared by Tipsify and the cluster split:
+    // a vertex is a hit while fewer than `size` misses came after its own.
+    struct CacheSim {
+        std::vector<uint32_t> stamp;
+        uint32_t time;
+        uint32_t size;
+
+        CacheSim(size_t vcount, int cache_size) : stamp(vcount, 0), time((uint32_t) cache_size + 1), size((uint32_t) cache_size) {}
+
+        bool hit(uint32_t v) const { return time - stamp[v] <= size; }
+
+        int touch(uint32_t v) {
+            if (hit(v)) return 0;
+            stamp[v] = time++;
+            return 1;
+        }
+
+        int touch_face(const uint32_t *t) { return touch(t[0]) + touch(t[1]) + touch(t[2]); }
+
+        // Everything misses again, as after a flush.
+        void reset() { time += size + 1; }
+    };
+
+    // Tipsify (Sander, Nehab and Barczak 2007): fan around one vertex at a
+    // time, moving to the neighbour that will still be in the cache for all
+    // its remaining faces, else to the most recent dead end. The returned
+    // order is of face numbers.
+    std::vector<uint32_t> tipsify(const std::vector<uint32_t> &idx, size_t vcount, int cache_size) {
+        size_t faces = idx.size() / 3;
+        VertexCorners vc = sort_corners(idx, vcount);
+        std::vector<uint32_t> live(vcount);
+        for (size_t v = 0; v < vcount; ++v) live[v] = vc.begin[v + 1] - vc.begin[v];
+
+        std::vector<uint32_t> order;
+        order.reserve(faces);
+        std::vector<uint8_t> emitted(faces, 0);
+        std::vector<uint32_t> dead_ends, candidates;
+        CacheSim cache(vcount, cache_size);
+        size_t scan = 0;
+        uint32_t fan = 0;
+        while (scan < vcount && live[scan] == 0) ++scan;
+        if (scan == vcount) return order;
+        fan = (uint32_t) scan;
+
+        for (;;) {
+            candidates.clear();
+            for (uint32_t k = vc.begin[fan]; k < vc.begin[fan + 1]; ++k) {
+                uint32_t f = vc.corners[k] / 3;
+                if (emitted[f]) continue;
+                emitted[f] = 1;
+                order.push_back(f);
+                for (int c = 0; c < 3; ++c) {
+                    uint32_t v = idx[(size_t) f * 3 + c];
+                    dead_ends.push_back(v);
+                    candidates.push_back(v);
+                    --live[v];
+                    cache.touch(v);
+                }
+            }
+
+            // Best neighbour: the oldest one whose remaining faces still
+            // fit before it leaves the cache.
+            int64_t best_priority = -1;
+            int64_t next = -1;
+            for (uint32_t v : candidates) {
+                if (live[v] == 0) continue;
+                int64_t priority = 0;
+                int64_t age = (int64_t) cache.time - cache.stamp[v];
+                if (age + 2 * (int64_t) live[v] <= (int64_t) cache.size) priority = age;
+                if (priority > best_priority) {
+                    best_priority = priority;
+                    next = v;
+                }
+            }
+            while (next < 0 && !dead_ends.empty()) {
+                uint32_t v = dead_ends.back();
+                dead_ends.pop_back();
+                if (live[v] > 0) next = v;
+            }
+            while (next < 0 && scan < vcount) {
+                if (live[scan] > 0) next = (int64_t) scan;
+                else ++scan;
+            }
+            if (next < 0) break;
+            fan = (uint32_t) next;
+        }
+        return order;
+    }
+
+    // Cluster starts in a face order: hard ones where a face misses on all
+    // three vertices (the cache has been flushed anyway), then soft ones
+    // inside each hard cluster wherever the run so far is within `threshold`
+    // of the whole cluster's miss rate, so moving the pieces apart costs
+    // little cache efficiency.
+    std::vector<size_t> split_clusters(const std::vector<uint32_t> &idx, size_t vcount, int cache_size,
+                                       float threshold) {
+        size_t faces = idx.size() / 3;
+        std::vector<size_t> hard;
+        CacheSim cache(vcount, cache_size);
+        for (size_t f = 0; f < faces; ++f)
+            if (cache.touch_face(&idx[f * 3]) == 3) hard.push_back(f);
+        if (hard.empty() || hard[0] != 0) hard.insert(hard.begin(), 0);
+        hard.push_back(faces);
+
+        std::vector<size_t> starts;
+        for (size_t c = 0; c + 1 < hard.size(); ++c) {
+            size_t lo = hard[c], hi = hard[c + 1];
+            cache.reset();
+            int misses = 0;
+            for (size_t f = lo; f < hi; ++f) misses += cache.touch_face(&idx[f * 3]);
+            float limit = threshold * (float) misses / (float) (hi - lo);
+
+            starts.push_back(lo);
+            cache.reset();
+            int run_misses = 0;
+            size_t run_faces = 0;
+            for (size_t f = lo; f < hi; ++f) {
+                run_misses += cache.touch_face(&idx[f * 3]);
+                ++run_faces;
+                if (f + 1 < hi && (float) run_misses <= limit * (float) run_faces) {
+                    starts.push_back(f + 1);
+                    cache.reset();
+                    run_misses = 0;
+                    run_faces = 0;
+                }
+            }
+        }
+        return starts;
+    }
+
+    // Garland-Heckbert error quadric: the area-weighted sum of squared
+    // distances to a set of planes, with the total weight kept alongside so
+    // evaluate() can return a mean squared distance.
+    struct Quadric {
+        double a2 = 0, b2 = 0, c2 = 0, ab = 0, ac = 0, bc = 0, ad = 0, bd = 0, cd = 0, d2 = 0, w = 0;
+
+        void add_plane(const double *n, double d, double weight) {
+            a2 += weight * n[0] * n[0];
+            b2 += weight * n[1] * n[1];
+            c2 += weight * n[2] * n[2];
+            ab += weight * n[0] * n[1];
+            ac += weight * n[0] * n[2];
+            bc += weight * n[1] * n[2];
+            ad += weight * n[0] * d;
+            bd += weight * n[1] * d;
+            cd += weight * n[2] * d;
+            d2 += weight * d * d;
+            w += weight;
+        }
+
+        void add(const Quadric &q) {
+            a2 += q.a2, b2 += q.b2, c2 += q.c2, ab += q.ab, ac += q.ac, bc += q.bc;
+            ad += q.ad, bd += q.bd, cd += q.cd, d2 += q.d2, w += q.w;
+        }
+
+        double evaluate(const float *p) const {
+            double x = p[0], y = p[1], z = p[2];
+            double e = a2 * x * x + b2 * y * y + c2 * z * z + 2 * (ab * x * y + ac * x * z + bc * y * z) +
+                       2 * (ad * x + bd * y + cd * z) + d2;
+            return w > 0 ? std::fabs(e) / w : 0.0;
+        }
+    };
+
+    // Share of skinning weight that changes when one vertex takes the other's
+    // influences: 0 for identical skinning, 1 for disjoint bones.
+    float skin_distance(const uint16_t *ja, const float *wa, const uint16_t *jb, const float *wb) {
+        float sum = 0.0f;
+        for (int i = 0; i < 4; ++i) {
+            if (wa[i] <= 0.0f) continue;
+            float other = 0.0f;
+            for (int k = 0; k < 4; ++k)
+                if (jb[k] == ja[i]) other += wb[k];
+            sum += std::fabs(wa[i] - other);
+        }
+        for (int i = 0; i < 4; ++i) {
+            if (wb[i] <= 0.0f) continue;
+            bool shared = false;
+            for (int k = 0; k < 4; ++k) shared |= ja[k] == jb[i] && wa[k] > 0.0f;
+            if (!shared) sum += wb[i];
+        }
+        return sum * 0.5f;
+    }
+
+    // Collapses that move more skinning than this would tear the mesh apart
+    // in motion even where the bind pose error is small.
+    constexpr float SKIN_TOLERANCE = 0.25f;
+}
+
+void generate_normals(const std::vector<float> &positions, const std::vector<uint32_t> &indices,
+                      std::vector<float> &normals, int max_threads) {
+    size_t vcount = positions.size() / 3;
+    normals.assign(vcount * 3, 0.0f);
+    if (vcount == 0) return;
+
+    // On one thread scattering each face as it is computed beats sorting
+    // corners, and adds every vertex's faces in the same ascending order.
+    size_t faces = indices.size() / 3;
+    if (resolve_threads(max_threads) <= 1 || vcount <= GRAIN) {
+        float f4[4];
+        for (size_t f = 0; f < faces; ++f) {
+            if (!face_normal(positions, indices, f, vcount, f4)) continue;
+            for (int k = 0; k < 3; ++k) {
+                float *n = &normals[(size_t) indices[f * 3 + k] * 3];
+                n[0] += f4[0];
+                n[1] += f4[1];
+                n[2] += f4[2];
+            }
+        }
+        for (size_t v = 0; v < vcount; ++v) normalize3(&normals[v * 3], 0.0f, 1.0f, 0.0f);
+        return;
+    }
+
+    // Four floats per face so each one is a single store; invalid faces
+    // stay zero (and are not in the corner lists anyway).
+    std::vector<float> fn(faces * 4, 0.0f);
+    for_ranges(faces, max_threads, [&](size_t lo, size_t hi) {
+        for (size_t f = lo; f < hi; ++f) face_normal(positions, indices, f, vcount, &fn[f * 4]);
+    });
+    VertexCorners vc = sort_corners(indices, vcount);
+
+    for_ranges(vcount, max_threads, [&](size_t lo, size_t hi) {
+        for (size_t v = lo; v < hi; ++v) {
+            float *n = &normals[v * 3];
+            for (uint32_t k = vc.begin[v]; k < vc.begin[v + 1]; ++k) {
+                const float *f = &fn[(size_t) (vc.corners[k] / 3) * 4];
+                n[0] += f[0];
+                n[1] += f[1];
+                n[2] += f[2];
+            }
+            normalize3(n, 0.0f, 1.0f, 0.0f);
+        }
+    });
+}
+
+void generate_tangents(const std::vector<float> &positions, const std::vector<float> &normals,
+                       const std::vector<float> &uvs, const std::vector<uint32_t> &indices,
+                       std::vector<float> &tangents, int max_threads) {
+    size_t vcount = positions.size() / 3;
+    tangents.assign(vcount * 4, 0.0f);
+    if (vcount == 0 || normals.size() < vcount * 3 || uvs.size() < vcount * 2) return;
+
+    // Per face: the unit UV-space tangent (MikkTSpace's vOs, sign-corrected
+    // for mirrored faces) and whether the UV mapping keeps orientation.
+    size_t faces = indices.size() / 3;
+    std::vector<float> face_t(faces * 3, 0.0f);
+    std::vector<int8_t> face_sign(faces, 0);
+    for_ranges(faces, max_threads, [&](size_t lo, size_t hi) {
+        for (size_t f = lo; f < hi; ++f) {
+            if (!face_valid(indices, f, vcount)) continue;
+            const float *p0 = &positions[(size_t) indices[f * 3] * 3];
+            const float *p1 = &positions[(size_t) indices[f * 3 + 1] * 3];
+            const float *p2 = &positions[(size_t) indices[f * 3 + 2] * 3];
+            const float *t0 = &uvs[(size_t) indices[f * 3] * 2];
+            const float *t1 = &uvs[(size_t) indices[f * 3 + 1] * 2];
+            const float *t2 = &uvs[(size_t) indices[f * 3 + 2] * 2];
+            float t21x = t1[0] - t0[0], t21y = t1[1] - t0[1];
+            float t31x = t2[0] - t0[0], t31y = t2[1] - t0[1];
+            float area = t21x * t31y - t21y * t31x;
+            if (std::fabs(area) < 1e-20f) continue;
+            float sign = area > 0.0f ? 1.0f : -1.0f;
+            float os[3];
+            for (int a = 0; a < 3; ++a) os[a] = t31y * (p1[a] - p0[a]) - t21y * (p2[a] - p0[a]);
+            float l = std::sqrt(os[0] * os[0] + os[1] * os[1] + os[2] * os[2]);
+            if (l < 1e-20f) continue;
+            for (int a = 0; a < 3; ++a) face_t[f * 3 + a] = os[a] * sign / l;
+            face_sign[f] = (int8_t) sign;
+        }
+    });
+
+    VertexCorners vc = sort_corners(indices, vcount);
+    for_ranges(vcount, max_threads, [&](size_t lo, size_t hi) {
+        for (size_t v = lo; v < hi; ++v) {
+            const float *n = &normals[v * 3];
+            const float *p = &positions[v * 3];
+            float sum[3] = {0.0f, 0.0f, 0.0f};
+            float orient = 0.0f;
+            for (uint32_t k = vc.begin[v]; k < vc.begin[v + 1]; ++k) {
+                size_t c = vc.corners[k], f = c / 3;
+                if (!face_sign[f]) continue;
+                const float *ft = &face_t[f * 3];
+                float d = ft[0] * n[0] + ft[1] * n[1] + ft[2] * n[2];
+                float t[3] = {ft[0] - d * n[0], ft[1] - d * n[1], ft[2] - d * n[2]};
+                float tl = std::sqrt(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+                if (tl < 1e-20f) continue;
+
+                // Corner angle between the two edges, both projected onto
+                // the normal's plane first.
+                const float *pa = &positions[(size_t) indices[f * 3 + (c + 1) % 3] * 3];
+                const float *pb = &positions[(size_t) indices[f * 3 + (c + 2) % 3] * 3];
+                float e1[3] = {pa[0] - p[0], pa[1] - p[1], pa[2] - p[2]};
+                float e2[3] = {pb[0] - p[0], pb[1] - p[1], pb[2] - p[2]};
+                float d1 = e1[0] * n[0] + e1[1] * n[1] + e1[2] * n[2];
+                float d2 = e2[0] * n[0] + e2[1] * n[1] + e2[2] * n[2];
+                for (int a = 0; a < 3; ++a) {
+                    e1[a] -= d1 * n[a];
+                    e2[a] -= d2 * n[a];
+                }
+                float l1 = std::sqrt(e1[0] * e1[0] + e1[1] * e1[1] + e1[2] * e1[2]);
+                float l2 = std::sqrt(e2[0] * e2[0] + e2[1] * e2[1] + e2[2] * e2[2]);
+                float cosang = (l1 > 1e-20f && l2 > 1e-20f) ? (e1[0] * e2[0] + e1[1] * e2[1] + e1[2] * e2[2]) / (l1 * l2) : 1.0f;
+                float w = std::acos(std::clamp(cosang, -1.0f, 1.0f));
+
+                for (int a = 0; a < 3; ++a) sum[a] += t[a] / tl * w;
+                orient += face_sign[f] * w;
+            }
+
+            float *out = &tangents[v * 4];
+            float l = std::sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+            if (l > 1e-6f) {
+                for (int a = 0; a < 3; ++a) out[a] = sum[a] / l;
+            } else {
+                // No usable UVs around this vertex: any unit vector in the
+                // normal's plane.
+                float ax = std::fabs(n[0]) < 0.9f ? 1.0f : 0.0f, ay = 1.0f - ax;
+                float d = ax * n[0] + ay * n[1];
+                out[0] = ax - d * n[0];
+                out[1] = ay - d * n[1];
+                out[2] = -d * n[2];
+                normalize3(out, 1.0f, 0.0f, 0.0f);
+            }
+            out[3] = orient < 0.0f ? -1.0f : 1.0f;
+        }
+    });
+}
+
+size_t weld_vertex_remap(std::vector<uint32_t> &indices, const std::vector<VertexStream> &streams, size_t vcount,
+                         std::vector<uint32_t> &remap) {
+    size_t slots = weld_slots(streams, vcount, remap);
+    for (uint32_t &i : indices) i = i < vcount ? remap[i] : UINT32_MAX;
+    return slots;
+}
+
+void optimize_triangle_order(std::vector<uint32_t> &indices, const std::vector<float> &positions, int cache_size) {
+    size_t vcount = positions.size() / 3;
+    size_t write = 0;
+    for (size_t f = 0; f < indices.size() / 3; ++f) {
+        uint32_t a = indices[f * 3], b = indices[f * 3 + 1], c = indices[f * 3 + 2];
+        if (a >= vcount || b >= vcount || c >= vcount || a == b || b == c || c == a) continue;
+        indices[write++] = a;
+        indices[write++] = b;
+        indices[write++] = c;
+    }
+    indices.resize(write);
+    size_t faces = write / 3;
+    if (faces == 0) return;
+
+    std::vector<uint32_t> cached;
+    cached.reserve(indices.size());
+    for (uint32_t f : tipsify(indices, vcount, cache_size))
+        cached.insert(cached.end(), indices.begin() + f * 3, indices.begin() + f * 3 + 3);
+
+    std::vector<size_t> starts = split_clusters(cached, vcount, cache_size, 1.05f);
+    starts.push_back(faces);
+    size_t clusters = starts.size() - 1;
+
+    // Each cluster's area-weighted centroid and normal; the sort key is how
+    // far the centroid lies out from the mesh centre along that normal.
+    float mesh_c[3] = {0.0f, 0.0f, 0.0f};
+    float mesh_area = 0.0f;
+    std::vector<float> centre(clusters * 3, 0.0f), normal(clusters * 3, 0.0f), area(clusters, 0.0f);
+    for (size_t c = 0; c < clusters; ++c) {
+        for (size_t f = starts[c]; f < starts[c + 1]; ++f) {
+            float n[4];
+            face_normal(positions, cached, f, vcount, n);
+            float a = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            const float *p0 = &positions[(size_t) cached[f * 3] * 3];
+            const float *p1 = &positions[(size_t) cached[f * 3 + 1] * 3];
+            const float *p2 = &positions[(size_t) cached[f * 3 + 2] * 3];
+            for (int k = 0; k < 3; ++k) {
+                float mid = (p0[k] + p1[k] + p2[k]) * (1.0f / 3.0f);
+                centre[c * 3 + k] += mid * a;
+                normal[c * 3 + k] += n[k];
+                mesh_c[k] += mid * a;
+            }
+            area[c] += a;
+            mesh_area += a;
+        }
+    }
+    if (mesh_area > 0.0f)
+        for (float &m : mesh_c) m /= mesh_area;
+
+    std::vector<float> key(clusters, 0.0f);
+    for (size_t c = 0; c < clusters; ++c) {
+        if (area[c] <= 0.0f) continue;
+        float *n = &normal[c * 3];
+        normalize3(n, 0.0f, 0.0f, 0.0f);
+        for (int k = 0; k < 3; ++k) key[c] += (centre[c * 3 + k] / area[c] - mesh_c[k]) * n[k];
+    }
+    std::vector<uint32_t> by_key(clusters);
+    for (size_t c = 0; c < clusters; ++c) by_key[c] = (uint32_t) c;
+    std::stable_sort(by_key.begin(), by_key.end(), [&](uint32_t a, uint32_t b) { return key[a] > key[b]; });
+
+    write = 0;
+    for (uint32_t c : by_key) {
+        size_t n = (starts[c + 1] - starts[c]) * 3;
+        std::copy_n(cached.begin() + starts[c] * 3, n, indices.begin() + write);
+        write += n;
+    }
+}
+
+size_t vertex_fetch_remap(std::vector<uint32_t> &indices, size_t vcount, std::vector<uint32_t> &remap) {
+    remap.assign(vcount, UINT32_MAX);
+    size_t next = 0;
+    for (uint32_t &i : indices) {
+        if (i >= vcount) {
+            i = UINT32_MAX;
+            continue;
+        }
+        if (remap[i] == UINT32_MAX) remap[i] = (uint32_t) next++;
+        i = remap[i];
+    }
+    return next;
+}
+
+size_t simplify_mesh(const std::vector<uint32_t> &indices, const std::vector<float> &positions,
+                     const std::vector<VertexStream> &attributes, const uint16_t *joints, const float *weights,
+                     size_t target_index_count, float target_error, std::vector<uint32_t> &out) {
+    out.clear();
+    size_t vcount = positions.size() / 3;
+    if (vcount == 0) return 0;
+
+    // Wedges are vertices with identical bytes everywhere; slots are
+    // positions. A slot with several wedges lies on a seam.
+    std::vector<VertexStream> all = attributes;
+    all.insert(all.begin(), VertexStream{positions.data(), 12});
+    std::vector<uint32_t> wedge_of, slot_of;
+    size_t wedges = weld_slots(all, vcount, wedge_of);
+    size_t slots = weld_slots({{positions.data(), 12}}, vcount, slot_of);
+    std::vector<uint32_t> wedge_vertex(wedges), wedge_slot(wedges), slot_vertex(slots);
+    for (size_t v = vcount; v-- > 0;) {
+        wedge_vertex[wedge_of[v]] = (uint32_t) v;
+        wedge_slot[wedge_of[v]] = slot_of[v];
+        slot_vertex[slot_of[v]] = (uint32_t) v;
+    }
+    auto pos = [&](uint32_t slot) { return &positions[(size_t) slot_vertex[slot] * 3]; };
+
+    std::vector<uint32_t> tris;
+    tris.reserve(indices.size());
+    for (size_t f = 0; f + 2 < indices.size(); f += 3) {
+        uint32_t a = indices[f], b = indices[f + 1], c = indices[f + 2];
+        if (a >= vcount || b >= vcount || c >= vcount) continue;
+        if (slot_of[a] == slot_of[b] || slot_of[b] == slot_of[c] || slot_of[c] == slot_of[a]) continue;
+        tris.insert(tris.end(), {wedge_of[a], wedge_of[b], wedge_of[c]});
+    }
+
+    // Seams, open borders and non-manifold edges keep their vertices, so
+    // UV islands and silhouettes hold their outline at every level.
+    std::vector<uint8_t> locked(slots, 0);
+    std::vector<uint32_t> slot_wedge(slots, UINT32_MAX);
+    for (uint32_t w : tris) {
+        uint32_t s = wedge_slot[w];
+        if (slot_wedge[s] == UINT32_MAX) slot_wedge[s] = w;
+        else if (slot_wedge[s] != w) locked[s] = 1;
+    }
+    std::vector<uint64_t> edges(tris.size());
+    for (size_t i = 0; i < tris.size(); ++i) {
+        uint32_t a = wedge_slot[tris[i]], b = wedge_slot[tris[i - i % 3 + (i + 1) % 3]];
+        edges[i] = (uint64_t) std::min(a, b) << 32 | std::max(a, b);
+    }
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0, j; i < edges.size(); i = j) {
+        j = i + 1;
+        while (j < edges.size() && edges[j] == edges[i]) ++j;
+        if (j - i == 2) continue;
+        locked[(size_t) (edges[i] >> 32)] = 1;
+        locked[(size_t) (edges[i] & 0xFFFFFFFFu)] = 1;
+    }
+
+    std::vector<Quadric> quadrics(slots);
+    float lo[3] = {0, 0, 0}, hi[3] = {0, 0, 0};
+    for (size_t v = 0; v < vcount; ++v) {
+        for (int k = 0; k < 3; ++k) {
+            float c = positions[v * 3 + k];
+            lo[k] = v == 0 ? c : std::min(lo[k], c);
+            hi[k] = v == 0 ? c : std::max(hi[k], c);
+        }
+    }
+    for (size_t f = 0; f < tris.size(); f += 3) {
+        const float *p0 = pos(wedge_slot[tris[f]]), *p1 = pos(wedge_slot[tris[f + 1]]), *p2 = pos(wedge_slot[tris[f + 2]]);
+        double u[3], v[3], n[3];
+        for (int k = 0; k < 3; ++k) {
+            u[k] = (double) p1[k] - p0[k];
+            v[k] = (double) p2[k] - p0[k];
+        }
+        n[0] = u[1] * v[2] - u[2] * v[1];
+        n[1] = u[2] * v[0] - u[0] * v[2];
+        n[2] = u[0] * v[1] - u[1] * v[0];
+        double len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (len < 1e-20) continue;
+        for (double &c : n) c /= len;
+        double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+        for (int k = 0; k < 3; ++k) quadrics[wedge_slot[tris[f + k]]].add_plane(n, d, len * 0.5);
+    }
+
+    double extent = std::sqrt((double) (hi[0] - lo[0]) * (hi[0] - lo[0]) + (double) (hi[1] - lo[1]) * (hi[1] - lo[1]) +
+                              (double) (hi[2] - lo[2]) * (hi[2] - lo[2]));
+    double max_error = (double) target_error * extent * target_error * extent;
+    size_t target_tris = target_index_count / 3;
+
+    // Passes of independent half-edge collapses, cheapest first; a vertex
+    // takes part in at most one collapse per pass, so every check below sees
+    // settled positions. Triangles are rewritten between passes.
+    struct Collapse {
+        uint32_t from, to;
+        double cost;
+    };
+    std::vector<Collapse> candidates;
+    std::vector<uint32_t> slot_tris(tris.size()), moved(slots), wedge_to(wedges);
+    std::vector<uint8_t> touched(slots);
+    while (tris.size() / 3 > target_tris) {
+        slot_tris.resize(tris.size());
+        for (size_t i = 0; i < tris.size(); ++i) slot_tris[i] = wedge_slot[tris[i]];
+        VertexCorners around = sort_corners(slot_tris, slots);
+
+        candidates.clear();
+        for (size_t i = 0; i < slot_tris.size(); ++i) {
+            uint32_t a = slot_tris[i], b = slot_tris[i - i % 3 + (i + 1) % 3];
+            for (int dir = 0; dir < 2; ++dir, std::swap(a, b)) {
+                if (locked[a]) continue;
+                if (joints && weights) {
+                    size_t va = slot_vertex[a], vb = slot_vertex[b];
+                    if (skin_distance(&joints[va * 4], &weights[va * 4], &joints[vb * 4], &weights[vb * 4]) > SKIN_TOLERANCE)
+                        continue;
+                }
+                double cost = quadrics[a].evaluate(pos(b));
+                if (cost <= max_error) candidates.push_back({a, b, cost});
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const Collapse &x, const Collapse &y) {
+            return x.cost != y.cost ? x.cost < y.cost : (x.from != y.from ? x.from < y.from : x.to < y.to);
+        });
+
+        for (size_t s = 0; s < slots; ++s) moved[s] = (uint32_t) s;
+        for (size_t w = 0; w < wedges; ++w) wedge_to[w] = (uint32_t) w;
+        std::fill(touched.begin(), touched.end(), 0);
+        size_t excess = tris.size() / 3 - target_tris, removed = 0, collapses = 0;
+        for (const Collapse &c : candidates) {
+            if (removed >= excess) break;
+            if (touched[c.from] || touched[c.to]) continue;
+
+            // The triangles on the edge name the wedge `from` joins; they
+            // must agree, and no other triangle around `from` may flip.
+            uint32_t to_wedge = UINT32_MAX;
+            size_t dropped = 0;
+            bool ok = true;
+            for (uint32_t k = around.begin[c.from]; ok && k < around.begin[c.from + 1]; ++k) {
+                size_t t = around.corners[k] / 3 * 3;
+                uint32_t s3[3] = {moved[slot_tris[t]], moved[slot_tris[t + 1]], moved[slot_tris[t + 2]]};
+                int at_to = s3[0] == c.to ? 0 : s3[1] == c.to ? 1 : s3[2] == c.to ? 2 : -1;
+                if (at_to >= 0) {
+                    uint32_t w = wedge_to[tris[t + at_to]];
+                    if (to_wedge == UINT32_MAX) to_wedge = w;
+                    ok = to_wedge == w;
+                    ++dropped;
+                    continue;
+                }
+                const float *p[3] = {pos(s3[0]), pos(s3[1]), pos(s3[2])};
+                float before[3], after[3];
+                cross3(p[0], p[1], p[2], before);
+                for (int j = 0; j < 3; ++j)
+                    if (s3[j] == c.from) p[j] = pos(c.to);
+                cross3(p[0], p[1], p[2], after);
+                float dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+                float lb = before[0] * before[0] + before[1] * before[1] + before[2] * before[2];
+                float la = after[0] * after[0] + after[1] * after[1] + after[2] * after[2];
+                ok = dot > 1e-2f * std::sqrt(lb * la);
+            }
+            if (!ok || to_wedge == UINT32_MAX) continue;
+
+            moved[c.from] = c.to;
+            wedge_to[slot_wedge[c.from]] = to_wedge;
+            touched[c.from] = touched[c.to] = 1;
+            quadrics[c.to].add(quadrics[c.from]);
+            removed += dropped;
+            ++collapses;
+        }
+        if (collapses == 0) break;
+
+        size_t write = 0;
+        for (size_t t = 0; t < tris.size(); t += 3) {
+            uint32_t a = wedge_to[tris[t]], b = wedge_to[tris[t + 1]], c = wedge_to[tris[t + 2]];
+            if (wedge_slot[a] == wedge_slot[b] || wedge_slot[b] == wedge_slot[c] || wedge_slot[c] == wedge_slot[a]) continue;
+            tris[write++] = a;
+            tris[write++] = b;
+            tris[write++] = c;
+        }
+        tris.resize(write);
+    }
+
+    out.resize(tris.size());
+    for (size_t i = 0; i < tris.size(); ++i) out[i] = wedge_vertex[tris[i]];
+    return out.size();
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Vertex normals and tangents for indexed triangle lists, used when the MDL
+// vertex stream has none that validate. Face normals are SSE cross products.
+// On several threads each vertex then sums the faces around it, found
+// through an index buffer counting-sorted by vertex, so large meshes split
+// across threads without shared writes. Either way a vertex adds its faces
+// in index order, so results do not depend on the thread count.
+// max_threads <= 0 means one per core.
+
+// Area-weighted smooth normals, xyz per vertex. Vertices on no valid face
+// get +Y.
+void generate_normals(const std::vector<float> &positions, const std::vector<uint32_t> &indices,
+                      std::vector<float> &normals, int max_threads = 0);
+
+// Tangents, xyzw per vertex (w is the bitangent sign), by MikkTSpace's
+// per-corner rules. Face tangents come from the UV derivatives. Each corner
+// projects its face's tangent onto the plane of the vertex normal and
+// weights it by the corner angle. Vertices are not split at mirrored UV
+// seams, so there a vertex takes the majority handedness where MikkTSpace
+// would duplicate it.
+void generate_tangents(const std::vector<float> &positions, const std::vector<float> &normals,
+                       const std::vector<float> &uvs, const std::vector<uint32_t> &indices,
+                       std::vector<float> &tangents, int max_threads = 0);
+
+// Export-time reordering, for consumers that draw the mesh as is. The usual
+// sequence is weld, optimize_triangle_order, then vertex_fetch_remap, with
+// remap_vertices applied to every stream after each remap step.
+
+// One per-vertex attribute stream: `stride` bytes for each vertex.
+struct VertexStream {
+    const void *data;
+    size_t stride;
+};
+
+// Vertices whose bytes match in every stream share one slot. remap[v] is
+// the new index of v, slots numbered in order of first occurrence, and the
+// indices are rewritten to match (out-of-range ones become UINT32_MAX);
+// returns the slot count.
+size_t weld_vertex_remap(std::vector<uint32_t> &indices, const std::vector<VertexStream> &streams, size_t vcount,
+                         std::vector<uint32_t> &remap);
+
+// Drops triangles with an out-of-range or repeated index, orders the rest
+// with Tipsify for a post-transform cache of `cache_size` entries, then
+// sorts clusters of that order so outward-facing ones on the mesh's hull
+// come first, the way Sander et al. reduce overdraw without losing the
+// cache order inside each cluster.
+void optimize_triangle_order(std::vector<uint32_t> &indices, const std::vector<float> &positions,
+                             int cache_size = 16);
+
+// Renumbers vertices in the order the index buffer first uses them and
+// rewrites the indices to match. Unreferenced vertices, and out-of-range
+// indices, map to UINT32_MAX; returns the referenced count.
+size_t vertex_fetch_remap(std::vector<uint32_t> &indices, size_t vcount, std::vector<uint32_t> &remap);
+
+// Quadric-error edge-collapse simplification (Garland and Heckbert) toward
+// `target_index_count`, stopping early where the next collapse would move
+// the surface further than `target_error` times the mesh's bounding-box
+// diagonal. Vertices are never moved or created: the result indexes the
+// input vertices. `attributes` (everything but positions) decide which
+// vertices share a position only as sides of a seam; seam, border and
+// non-manifold vertices stay put. With `joints` and `weights` (4 per
+// vertex), collapses between differently skinned vertices are refused.
+// Returns the new index count.
+size_t simplify_mesh(const std::vector<uint32_t> &indices, const std::vector<float> &positions,
+                     const std::vector<VertexStream> &attributes, const uint16_t *joints, const float *weights,
+                     size_t target_index_count, float target_error, std::vector<uint32_t> &out);
+
+// Moves `width` elements per vertex to their remapped slots, dropping the
+// unreferenced ones.
+template<class T>
+void remap_vertices(std::vector<T> &data, size_t width, const std::vector<uint32_t> &remap, size_t new_count) {
+    std::vector<T> out(new_count * width);
+    for (size_t v = 0; v < remap.size(); ++v) {
+        if (remap[v] == UINT32_MAX) continue;
+        std::copy_n(data.begin() + v * width, width, out.begin() + (size_t) remap[v] * width);
+    }
+    data.swap(out);
+}
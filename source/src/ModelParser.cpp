@@ -1,58 +1,144 @@
 #include "ModelParser.h"
 #include "Files.h"
 #include "Utils.h"
+#include "State.h"
+#include "VertexDecode.h"
+#include "MeshProcess.h"
 #include "BNKCore.cpp"
 #include <algorithm>
+#include <cctype>
 #include <unordered_map>
 #include <filesystem>
 #include <cstdint>
 #include <cstring>
 #include <cmath>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
 
 using std::uint8_t; using std::uint16_t; using std::uint32_t;
 
+namespace {
+    struct MdlArchive {
+        std::unique_ptr<BNKReader> reader;
+        std::mutex mutex;
+    };
+
+    // globals_model_headers.bnk / globals_models.bnk of one root, opened
+    // once. Entries are keyed by lowercase, forward-slashed name; nested
+    // model BNKs only carry bodies, so headers are also keyed by file name.
+    // Replaced as a whole when the catalog changes.
+    struct MdlResolver {
+        MdlArchive headers, bodies;
+        std::unordered_map<std::string, std::pair<int, int>> models;  // header, body index
+        std::unordered_map<std::string, int> headers_by_file;
+    };
+
+    std::string mdl_key(std::string s) {
+        std::transform(s.begin(), s.end(), s.begin(), ::tolower);
+        std::replace(s.begin(), s.end(), '\\', '/');
+        return s;
+    }
+
+    std::string mdl_file_key(const std::string &name) {
+        return mdl_key(std::filesystem::path(name).filename().string());
+    }
+
+    bool open_mdl_archive(MdlArchive &a, const std::optional<std::string> &path) {
+        if (!path) return false;
+        try {
+            a.reader = std::make_unique<BNKReader>(*path);
+        } catch (...) {
+            a.reader.reset();
+        }
+        return a.reader != nullptr;
+    }
+
+    std::shared_ptr<MdlResolver> build_mdl_resolver() {
+        auto r = std::make_shared<MdlResolver>();
+        bool have_headers = open_mdl_archive(r->headers, find_bnk_by_filename("globals_model_headers.bnk"));
+        bool have_bodies = open_mdl_archive(r->bodies, find_bnk_by_filename("globals_models.bnk"));
+        if (!have_headers) return r;
+
+        // First entry wins, as the old map emplaces did.
+        const auto &hf = r->headers.reader->list_files();
+        std::unordered_map<std::string, int> header_ids;
+        header_ids.reserve(hf.size());
+        r->headers_by_file.reserve(hf.size());
+        for (size_t i = 0; i < hf.size(); ++i) {
+            header_ids.emplace(mdl_key(hf[i].name), (int) i);
+            r->headers_by_file.emplace(mdl_file_key(hf[i].name), (int) i);
+        }
+        if (!have_bodies) return r;
+
+        const auto &bf = r->bodies.reader->list_files();
+        r->models.reserve(bf.size());
+        for (size_t i = 0; i < bf.size(); ++i) {
+            std::string key = mdl_key(bf[i].name);
+            auto h = header_ids.find(key);
+            if (h != header_ids.end()) r->models.emplace(key, std::make_pair(h->second, (int) i));
+        }
+        return r;
+    }
+
+    std::shared_ptr<MdlResolver> current_mdl_resolver() {
+        static std::mutex mutex;
+        static std::shared_ptr<MdlResolver> resolver;
+        static uint32_t built_gen = 0;
+
+        // Only the atomic generation is read here; workers call this too.
+        uint32_t gen = S.catalog_gen;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!resolver || built_gen != gen) {
+            resolver = build_mdl_resolver();
+            built_gen = gen;
+        }
+        return resolver;
+    }
+
+    bool append_mdl_part(MdlArchive &a, int index, std::vector<unsigned char> &out) {
+        return a.reader && read_and_inflate(*a.reader, a.mutex, (size_t) index, out);
+    }
+}
+
 bool build_mdl_buffer_for_name(const std::string &mdl_name, std::vector<unsigned char> &out){
-    auto p_headers = find_bnk_by_filename("globals_model_headers.bnk");
-    auto p_rest    = find_bnk_by_filename("globals_models.bnk");
-    if(!p_headers || !p_rest) return false;
-    BNKReader r_headers(*p_headers);
-    BNKReader r_rest(*p_rest);
-    std::unordered_map<std::string,int> mapH, mapR;
-    for(size_t i=0;i<r_headers.list_files().size();++i){
-        auto &e=r_headers.list_files()[i];
-        std::string f=e.name;
-        std::transform(f.begin(),f.end(),f.begin(),::tolower);
-        std::replace(f.begin(), f.end(), '\\', '/');
-        mapH.emplace(f,(int)i);
-    }
-    for(size_t i=0;i<r_rest.list_files().size();++i){
-        auto &e=r_rest.list_files()[i];
-        std::string f=e.name;
-        std::transform(f.begin(),f.end(),f.begin(),::tolower);
-        std::replace(f.begin(), f.end(), '\\', '/');
-        mapR.emplace(f,(int)i);
-    }
-    std::string key=mdl_name;
-    std::transform(key.begin(),key.end(),key.begin(),::tolower);
-    std::replace(key.begin(), key.end(), '\\', '/');
-    if(!mapH.count(key) || !mapR.count(key)) return false;
-
-    auto tmpdir = std::filesystem::temp_directory_path() / "f2_mdl_hex";
-    std::error_code ec; std::filesystem::create_directories(tmpdir, ec);
-    auto tmp_h = tmpdir / "h.bin";
-    auto tmp_r = tmpdir / "r.bin";
-    try{
-        extract_one(*p_headers, mapH.at(key), tmp_h.string());
-        extract_one(*p_rest,    mapR.at(key), tmp_r.string());
-        auto vh = read_all_bytes(tmp_h);
-        auto vr = read_all_bytes(tmp_r);
-        out.clear(); out.reserve(vh.size()+vr.size());
-        out.insert(out.end(), vh.begin(), vh.end());
-        out.insert(out.end(), vr.begin(), vr.end());
-        std::filesystem::remove(tmp_h, ec);
-        std::filesystem::remove(tmp_r, ec);
-    }catch(...){ return false; }
+    auto r = current_mdl_resolver();
+    auto it = r->models.find(mdl_key(mdl_name));
+    if (it == r->models.end()) return false;
+
+    out.clear();
+    if (!append_mdl_part(r->headers, it->second.first, out) || !append_mdl_part(r->bodies, it->second.second, out)) {
+        out.clear();
+        return false;
+    }
+    return true;
+}
+
+bool build_nested_mdl_buffer(const std::string &nested_bnk_path, int file_index, std::vector<unsigned char> &out){
+    std::vector<unsigned char> body;
+    std::string mdl_name;
+    try {
+        // Nested BNKs are per-preview temp copies, so they are not kept open.
+        BNKReader nested(nested_bnk_path);
+        const auto &files = nested.list_files();
+        if (file_index < 0 || file_index >= (int) files.size()) return false;
+        mdl_name = files[(size_t) file_index].name;
+        nested.read_entry((size_t) file_index, body);
+    } catch (...) {
+        return false;
+    }
+    if (body.empty()) return false;
+
+    // Without a matching global header the body is all there is.
+    out.clear();
+    auto r = current_mdl_resolver();
+    auto h = r->headers_by_file.find(mdl_file_key(mdl_name));
+    if (h != r->headers_by_file.end() && append_mdl_part(r->headers, h->second, out) && !out.empty()) {
+        out.insert(out.end(), body.begin(), body.end());
+    } else {
+        out.swap(body);
+    }
     return true;
 }
 
@@ -64,16 +150,76 @@ struct R {
     bool u16be(uint16_t& v){ if(!need(2)) return false; const uint8_t* q=p+i; i+=2; v=(uint16_t(q[0])<<8)|uint16_t(q[1]); return true; }
     bool u32be(uint32_t& v){ if(!need(4)) return false; const uint8_t* q=p+i; i+=4; v=(uint32_t(q[0])<<24)|(uint32_t(q[1])<<16)|(uint32_t(q[2])<<8)|uint32_t(q[3]); return true; }
     bool f32be(float& f){ uint32_t u; if(!u32be(u)) return false; std::memcpy(&f,&u,4); return true; }
-    bool strz(std::string& s, size_t maxlen=8192){ s.clear(); size_t lim=std::min(n,i+maxlen); while(i<lim){ char c=(char)p[i++]; if(c==0) return true; s.push_back(c);} return true; }
+    // A NUL-terminated string of at most maxlen bytes, viewed in place; one
+    // without a NUL in reach ends at the limit.
+    bool strv(std::string_view& s, size_t maxlen=8192){
+        size_t lim=std::min(n,i+maxlen);
+        const void* z=std::memchr(p+i, 0, lim-i);
+        size_t end=z ? (size_t)((const uint8_t*)z-p) : lim;
+        s=std::string_view((const char*)p+i, end-i);
+        i=z ? end+1 : lim;
+        return true;
+    }
     bool skip(size_t k){ if(!need(k)) return false; i+=k; return true; }
 };
-static inline float half_to_float(uint16_t h){
-    uint32_t s=(h>>15)&1u, e=(h>>10)&0x1Fu, f=h&0x3FFu, E, F;
-    if(e==0){ if(f==0){E=0;F=0;} else{ int t=0; while((f&0x400u)==0){ f<<=1; t++; } f&=0x3FFu; E=127-15-t; F=f<<13; } }
-    else if(e==31){ E=255; F=f?0x7FFFFF:0; }
-    else{ E=e+(127-15); F=f<<13; }
-    uint32_t u=(s<<31)|(E<<23)|F; float r; std::memcpy(&r,&u,4); return r;
+// Mesh buffer headers sit after gaps the parser does not understand, so they
+// are found by searching. The searches below return the same first match a
+// byte-by-byte scan would, but let memchr find the candidates.
+constexpr size_t NOT_FOUND = SIZE_MAX;
+
+// First offset in [from, end - 4] holding FF FF FF FF.
+static size_t find_ff_marker(const uint8_t* p, size_t from, size_t end){
+    while(from + 4 <= end){
+        const void* hit = std::memchr(p + from, 0xFF, end - from - 3);
+        if(!hit) return NOT_FOUND;
+        size_t sp = (size_t)((const uint8_t*)hit - p);
+        if(p[sp+1]==0xFF && p[sp+2]==0xFF && p[sp+3]==0xFF) return sp;
+        from = sp + 1;
+    }
+    return NOT_FOUND;
+}
+
+// First offset at or after `from` where a printable byte starts a string
+// (read as R::strv would, so at most 8192 bytes) followed by 0x01; returns
+// the offset just past the 0x01. Every start inside one run ends at the same
+// NUL, so a run that fails is skipped whole.
+static size_t find_tagged_string(const uint8_t* p, size_t n, size_t from){
+    const size_t maxlen = 8192;
+    size_t s = from;
+    while(s < n){
+        if(!(p[s] >= 32 && p[s] < 127)){ ++s; continue; }
+        const void* z = std::memchr(p + s, 0, n - s);
+        size_t nul = z ? (size_t)((const uint8_t*)z - p) : n;
+        if(nul - s < maxlen){
+            if(nul + 1 < n && p[nul+1] == 0x01) return nul + 2;
+            s = nul + 1;
+            continue;
+        }
+        // A run longer than strv reads: it stops at the limit instead.
+        size_t lim = s + maxlen;
+        if(lim < n && p[lim] == 0x01) return lim + 1;
+        ++s;
+    }
+    return NOT_FOUND;
+}
+
+static uint32_t be32_at(const uint8_t* q){
+    return (uint32_t(q[0])<<24) | (uint32_t(q[1])<<16) | (uint32_t(q[2])<<8) | uint32_t(q[3]);
+}
+
+// A "foliage" directory anywhere in the path, either slash, any case.
+static bool path_in_foliage_dir(std::string_view path){
+    static const char word[] = "foliage";
+    for(size_t i=0; i+9<=path.size(); ++i){
+        if(path[i]!='/' && path[i]!='\\') continue;
+        if(path[i+8]!='/' && path[i+8]!='\\') continue;
+        bool match=true;
+        for(size_t k=0;k<7 && match;k++) match = std::tolower((unsigned char)path[i+1+k])==word[k];
+        if(match) return true;
+    }
+    return false;
 }
+
 static void build_triangles_from_strip(const std::vector<uint16_t>& strip, std::vector<uint32_t>& out_idx){
     out_idx.clear(); if(strip.size()<3) return;
     const uint16_t RESTART=0xFFFF; bool wind=false; uint16_t a=strip[0], b=strip[1];
@@ -90,25 +236,62 @@ static void build_triangles_from_strip(const std::vector<uint16_t>& strip, std::
         a=b; b=c; wind=!wind;
     }
 }
-static void compute_smooth_normals(size_t vcount, const std::vector<uint32_t>& idx, const std::vector<float>& pos, std::vector<float>& out_n){
-    out_n.assign(vcount*3,0.0f);
-    for(size_t i=0;i+2<idx.size(); i+=3){
-        uint32_t ia=idx[i], ib=idx[i+1], ic=idx[i+2];
-        if((size_t)ia*3+2>=pos.size()||(size_t)ib*3+2>=pos.size()||(size_t)ic*3+2>=pos.size()) continue;
-        float ax=pos[ia*3+0], ay=pos[ia*3+1], az=pos[ia*3+2];
-        float bx=pos[ib*3+0], by=pos[ib*3+1], bz=pos[ib*3+2];
-        float cx=pos[ic*3+0], cy=pos[ic*3+1], cz=pos[ic*3+2];
-        float ux=bx-ax, uy=by-ay, uz=bz-az;
-        float vx=cx-ax, vy=cy-ay, vz=cz-az;
-        float nx=uy*vz-uz*vy, ny=uz*vx-ux*vz, nz=ux*vy-uy*vx;
-        out_n[ia*3+0]+=nx; out_n[ia*3+1]+=ny; out_n[ia*3+2]+=nz;
-        out_n[ib*3+0]+=nx; out_n[ib*3+1]+=ny; out_n[ib*3+2]+=nz;
-        out_n[ic*3+0]+=nx; out_n[ic*3+1]+=ny; out_n[ic*3+2]+=nz;
+}
+
+namespace {
+// Stored vectors are only trusted when nearly all of them decode to unit
+// length and the normals lie along the faces they belong to (either side,
+// the strips do not keep a consistent winding); anything else means the
+// bytes hold some other data or format.
+constexpr PackedVectorFormat kPackedFormats[] = {PackedVectorFormat::Dec3N, PackedVectorFormat::HEnd3N, PackedVectorFormat::UByte4N};
+
+float face_agreement(const std::vector<uint32_t>& idx, const std::vector<float>& pos, const std::vector<float>& n){
+    size_t tris = idx.size()/3;
+    if(tris==0) return 0.0f;
+    size_t step = std::max<size_t>(1, tris/512);
+    size_t checked=0, agree=0;
+    for(size_t t=0; t<tris; t+=step){
+        uint32_t i[3]={idx[t*3+0], idx[t*3+1], idx[t*3+2]};
+        if((size_t)i[0]*3+2>=pos.size()||(size_t)i[1]*3+2>=pos.size()||(size_t)i[2]*3+2>=pos.size()) continue;
+        const float* a=&pos[i[0]*3]; const float* b=&pos[i[1]*3]; const float* c=&pos[i[2]*3];
+        float ux=b[0]-a[0], uy=b[1]-a[1], uz=b[2]-a[2];
+        float vx=c[0]-a[0], vy=c[1]-a[1], vz=c[2]-a[2];
+        float fx=uy*vz-uz*vy, fy=uz*vx-ux*vz, fz=ux*vy-uy*vx;
+        float fl=std::sqrt(fx*fx+fy*fy+fz*fz);
+        if(fl<1e-12f) continue;
+        for(uint32_t k: i){
+            const float* nk=&n[(size_t)k*3];
+            ++checked;
+            if(std::fabs(nk[0]*fx+nk[1]*fy+nk[2]*fz) >= 0.25f*fl) ++agree;
+        }
+    }
+    return checked ? (float)agree/(float)checked : 0.0f;
+}
+
+template<class Layout>
+bool decode_stored_vectors(const uint8_t* vp, size_t vcount, MDLMeshGeom& g){
+    std::vector<float> normals(vcount*3);
+    PackedVectorFormat fmt{};
+    bool found=false;
+    for(PackedVectorFormat f: kPackedFormats){
+        size_t unit = decode_mdl_packed_vectors<Layout>(vp, vcount, Layout::normal_offset, f, normals.data(), 12);
+        if(unit < vcount - vcount/20) continue;
+        if(face_agreement(g.indices, g.positions, normals) < 0.8f) continue;
+        fmt=f; found=true; break;
     }
+    if(!found) return false;
+    g.normals.swap(normals);
+
+    std::vector<float> tangents(vcount*4);
+    size_t unit = decode_mdl_packed_vectors<Layout>(vp, vcount, Layout::tangent_offset, fmt, tangents.data(), 16, true);
+    if(unit < vcount - vcount/20) return true;
+    size_t orthogonal=0;
     for(size_t v=0; v<vcount; ++v){
-        float x=out_n[v*3+0], y=out_n[v*3+1], z=out_n[v*3+2];
-        float l=std::sqrt(x*x+y*y+z*z); if(l>1e-6f){ out_n[v*3+0]=x/l; out_n[v*3+1]=y/l; out_n[v*3+2]=z/l; } else { out_n[v*3+0]=0; out_n[v*3+1]=1; out_n[v*3+2]=0; }
+        const float* t=&tangents[v*4]; const float* n=&g.normals[v*3];
+        if(std::fabs(t[0]*n[0]+t[1]*n[1]+t[2]*n[2]) < 0.2f) ++orthogonal;
     }
+    if(orthogonal >= vcount - vcount/10) g.tangents.swap(tangents);
+    return true;
 }
 }
 
@@ -117,18 +300,83 @@ bool parse_mdl_info(const std::vector<unsigned char>& data, MDLInfo& out){
 }
 
 bool parse_mdl_info(const std::vector<unsigned char>& data, MDLInfo& out, const std::string& file_path){
+    // One view per thread, so its arrays keep their capacity across calls.
+    thread_local MDLView view;
+    bool ok = parse_mdl_view(data.data(), data.size(), view, file_path);
+    mdl_view_to_info(view, out);
+    clear_mdl_view(view);
+    return ok;
+}
+
+void clear_mdl_view(MDLView& v){
+    v.Data = nullptr;
+    v.Size = 0;
+    v.Magic = {};
+    v.HeaderSize = v.BoneCount = v.BoneTransformCount = v.Unk6Count = v.MeshCount = 0;
+    v.HasBoneTransforms = false;
+    v.BoneTransformOffset = 0;
+    v.Bones.clear();
+    v.Meshes.clear();
+    v.Materials.clear();
+    v.MeshBuffers.clear();
+}
+
+bool mdl_view_bone_transform(const MDLView& v, size_t bone, float out[11]){
+    if(!v.HasBoneTransforms || bone >= v.BoneTransformCount) return false;
+    const uint8_t* q = v.Data + v.BoneTransformOffset + bone*44;
+    for(int k=0;k<11;k++){ uint32_t u=be32_at(q+k*4); std::memcpy(&out[k], &u, 4); }
+    return true;
+}
+
+void mdl_view_to_info(const MDLView& v, MDLInfo& out){
     out = MDLInfo{};
-    if(data.size() < 8) return false;
-    R r{data.data(), data.size(), 0};
+    out.Magic.assign(v.Magic);
+    out.HeaderSize = v.HeaderSize;
+    out.BoneCount = v.BoneCount;
+    out.BoneTransformCount = v.BoneTransformCount;
+    out.Unk6Count = v.Unk6Count;
+    out.MeshCount = v.MeshCount;
+    out.HasBoneTransforms = v.HasBoneTransforms;
+    out.Bones.reserve(v.Bones.size());
+    for(const auto& b : v.Bones) out.Bones.push_back(MDLBoneInfo{std::string(b.Name), b.ParentID});
+    if(v.HasBoneTransforms){
+        out.BoneTransforms.resize(v.BoneTransformCount, std::vector<float>(11));
+        for(size_t i=0;i<out.BoneTransforms.size();i++) mdl_view_bone_transform(v, i, out.BoneTransforms[i].data());
+    }
+    out.Meshes.reserve(v.Meshes.size());
+    for(const auto& m : v.Meshes){
+        MDLMeshInfo mesh;
+        mesh.MeshName.assign(m.MeshName);
+        mesh.MaterialCount = m.MaterialCount;
+        mesh.Materials.reserve(m.EndMaterial - m.FirstMaterial);
+        for(uint32_t j=m.FirstMaterial;j<m.EndMaterial;j++){
+            const auto& mv = v.Materials[j];
+            MDLMaterialInfo mat;
+            mat.TextureName.assign(mv.TextureName);
+            mat.SpecularMapName.assign(mv.SpecularMapName);
+            mat.NormalMapName.assign(mv.NormalMapName);
+            mat.UnkName.assign(mv.UnkName);
+            mat.TintName.assign(mv.TintName);
+            mat.Unk1 = mv.Unk1;
+            mat.Unk2[0] = mv.Unk2[0];
+            mat.Unk2[1] = mv.Unk2[1];
+            mesh.Materials.push_back(std::move(mat));
+        }
+        out.Meshes.push_back(std::move(mesh));
+    }
+    out.MeshBuffers = v.MeshBuffers;
+}
+
+bool parse_mdl_view(const unsigned char* data, size_t size, MDLView& out, std::string_view file_path){
+    clear_mdl_view(out);
+    out.Data = data;
+    out.Size = size;
+    if(size < 8) return false;
+    R r{data, size, 0};
 
-    std::string path_lower = file_path;
-    std::transform(path_lower.begin(), path_lower.end(), path_lower.begin(), ::tolower);
-    bool is_foliage = (path_lower.find("/foliage/") != std::string::npos) ||
-                      (path_lower.find("\\foliage\\") != std::string::npos) ||
-                      (path_lower.find("/foliage\\") != std::string::npos) ||
-                      (path_lower.find("\\foliage/") != std::string::npos);
+    bool is_foliage = path_in_foliage_dir(file_path);
 
-    std::string magic((const char*)r.p, 8);
+    std::string_view magic((const char*)r.p, 8);
     bool has_magic = (magic == "MeshFile");
 
     if(has_magic){
@@ -140,29 +388,22 @@ bool parse_mdl_info(const std::vector<unsigned char>& data, MDLInfo& out, const
         if(!r.skip(88)) return false;
     } else {
         r.i = 0;
-        out.Magic.clear();
     }
 
     if(!r.skip(8*4)) return false;
 
     if(!r.u32be(out.BoneCount)) return false;
-    out.Bones.clear(); out.Bones.reserve(out.BoneCount);
     for(uint32_t i=0;i<out.BoneCount;i++){
-        std::string nm; if(!r.strz(nm)) return false;
+        MDLBoneView b; if(!r.strv(b.Name)) return false;
         uint32_t pid=0; if(!r.u32be(pid)) return false;
-        MDLBoneInfo b; b.Name=nm; b.ParentID=(pid==0xFFFFFFFFu)?-1:(int)pid;
-        out.Bones.push_back(std::move(b));
+        b.ParentID=(pid==0xFFFFFFFFu)?-1:(int)pid;
+        out.Bones.push_back(b);
     }
 
     if(!r.u32be(out.BoneTransformCount)) return false;
-    out.BoneTransforms.clear();
     if(out.BoneTransformCount==out.BoneCount && out.BoneCount>0){
-        out.BoneTransforms.reserve(out.BoneTransformCount);
-        for(uint32_t i=0;i<out.BoneTransformCount;i++){
-            std::vector<float> tf(11);
-            for(int k=0;k<11;k++) if(!r.f32be(tf[k])) return false;
-            out.BoneTransforms.push_back(std::move(tf));
-        }
+        out.BoneTransformOffset=r.i;
+        if(!r.skip((size_t)out.BoneTransformCount*44)) return false;
         out.HasBoneTransforms=true;
     }else{
         uint32_t m=out.BoneTransformCount; if(m>65535u) m=65535u;
@@ -186,40 +427,38 @@ bool parse_mdl_info(const std::vector<unsigned char>& data, MDLInfo& out, const
     if(!r.u32be(StringBlockCount)) return false;
     if(StringBlockCount>0 && StringBlockCount<1000000u){
         for(uint32_t i=0;i<StringBlockCount;i++){
-            std::string s; if(!r.strz(s)) return false;
+            std::string_view s; if(!r.strv(s)) return false;
         }
     }
 
-    out.Meshes.clear(); out.Meshes.reserve(out.MeshCount);
-    out.MeshBuffers.clear(); out.MeshBuffers.reserve(out.MeshCount);
-
     for(uint32_t mi=0; mi<out.MeshCount; ++mi){
         uint32_t u1=0; if(!r.u32be(u1)) return false;
-        std::string meshName; if(!r.strz(meshName)) return false;
+        std::string_view meshName; if(!r.strv(meshName)) return false;
         float f2; if(!r.f32be(f2)) return false; if(!r.f32be(f2)) return false;
         if(!r.skip(21)) return false;
         float f4; if(!r.f32be(f4)) return false;
         uint32_t u5[3]; for(int k=0;k<3;k++) if(!r.u32be(u5[k])) return false;
         uint32_t mcount=0; if(!r.u32be(mcount)) return false;
-        MDLMeshInfo mesh; mesh.MeshName=meshName; mesh.MaterialCount=mcount;
+        MDLMeshView mesh; mesh.MeshName=meshName; mesh.MaterialCount=mcount;
+        mesh.FirstMaterial=mesh.EndMaterial=(uint32_t)out.Materials.size();
         if(mcount>0 && mcount<65535u){
-            mesh.Materials.reserve(mcount);
             for(uint32_t j=0;j<mcount;j++){
-                MDLMaterialInfo m;
-                if(!r.strz(m.TextureName)) return false;
-                if(!r.strz(m.SpecularMapName)) return false;
-                if(!r.strz(m.NormalMapName)) return false;
-                if(!r.strz(m.UnkName)) return false;
-                if(!r.strz(m.TintName)) return false;
+                MDLMaterialView m;
+                if(!r.strv(m.TextureName)) return false;
+                if(!r.strv(m.SpecularMapName)) return false;
+                if(!r.strv(m.NormalMapName)) return false;
+                if(!r.strv(m.UnkName)) return false;
+                if(!r.strv(m.TintName)) return false;
                 if(!r.u32be(m.Unk1)) return false;
                 if(!r.u32be(m.Unk2[0])) return false;
                 if(!r.u32be(m.Unk2[1])) return false;
                 size_t keep=r.i; uint8_t peek=0;
                 if(r.u8(peek)){ if(peek!=0x01){ r.i=keep; } } else { r.i=keep; }
-                mesh.Materials.push_back(std::move(m));
+                out.Materials.push_back(m);
+                mesh.EndMaterial++;
             }
         }
-        out.Meshes.push_back(std::move(mesh));
+        out.Meshes.push_back(mesh);
     }
 
 if(is_foliage){
@@ -337,16 +576,13 @@ if(is_foliage){
 
         for(uint32_t mi=1; mi<out.MeshCount; ++mi){
             bool aligned=false;
-            for(size_t sp=scan_pos; sp+4<=r.n; ++sp){
-                uint32_t marker = (uint32_t(r.p[sp])<<24) | (uint32_t(r.p[sp+1])<<16) |
-                                  (uint32_t(r.p[sp+2])<<8) | r.p[sp+3];
-                if(marker==0xFFFFFFFF && sp>=24){
-                    uint8_t b0=r.p[sp-24], b1=r.p[sp-23], b2=r.p[sp-22], b3=r.p[sp-21];
-                    if(b0==0x00 && b1==0x00 && b2==0x00 && b3>=0x01){
-                        r.i=sp-24;
-                        aligned=true;
-                        break;
-                    }
+            for(size_t sp=find_ff_marker(r.p, std::max<size_t>(scan_pos, 24), r.n); sp!=NOT_FOUND;
+                sp=find_ff_marker(r.p, sp+1, r.n)){
+                uint8_t b0=r.p[sp-24], b1=r.p[sp-23], b2=r.p[sp-22], b3=r.p[sp-21];
+                if(b0==0x00 && b1==0x00 && b2==0x00 && b3>=0x01){
+                    r.i=sp-24;
+                    aligned=true;
+                    break;
                 }
             }
             if(!aligned){
@@ -402,8 +638,8 @@ if(is_foliage){
     if(r.i < r.n){
         uint8_t nextByte = r.p[r.i];
         if(nextByte >= 32 && nextByte < 127){
-            std::string optStr;
-            if(r.strz(optStr)){
+            std::string_view optStr;
+            if(r.strv(optStr)){
                 wasStringFound = true;
                 uint8_t followByte = 0;
                 if(r.u8(followByte)){
@@ -423,31 +659,13 @@ if(is_foliage){
 
     for(uint32_t mi=0; mi<out.MeshCount; ++mi){
         if(mi > 0 && wasStringFound){
-            bool found = false;
-            for(size_t searchPos = r.i; searchPos < r.n; ++searchPos){
-                uint8_t nextByte = r.p[searchPos];
-                if(nextByte >= 32 && nextByte < 127){
-                    r.i = searchPos;
-                    std::string optStr;
-                    if(r.strz(optStr)){
-                        uint8_t followByte = 0;
-                        if(r.u8(followByte)){
-                            if(followByte == 0x01) {
-                                uint32_t mesh_id = 0;
-                                if(!r.u32be(mesh_id)) return false;
-                                uint32_t mesh_id_copy = 0;
-                                if(!r.u32be(mesh_id_copy)) return false;
-                                found = true;
-                                break;
-                            } else {
-                                r.i = searchPos + 1;
-                                continue;
-                            }
-                        }
-                    }
-                }
-            }
-            if(!found) return false;
+            size_t after = find_tagged_string(r.p, r.n, r.i);
+            if(after == NOT_FOUND) return false;
+            r.i = after;
+            uint32_t mesh_id = 0;
+            if(!r.u32be(mesh_id)) return false;
+            uint32_t mesh_id_copy = 0;
+            if(!r.u32be(mesh_id_copy)) return false;
         }
 
         if(wasStringFound){
@@ -477,18 +695,9 @@ if(is_foliage){
                 final_submesh_count = submesh_count;
             }
 
-            bool markerFound = false;
-            for(size_t searchPos = r.i; searchPos + 4 <= r.n && searchPos < r.i + 1000; ++searchPos){
-                uint32_t marker = (uint32_t(r.p[searchPos])<<24) | (uint32_t(r.p[searchPos+1])<<16) |
-                                 (uint32_t(r.p[searchPos+2])<<8) | r.p[searchPos+3];
-                if(marker == 0xFFFFFFFF){
-                    r.i = searchPos;
-                    markerFound = true;
-                    break;
-                }
-            }
-
-            if(!markerFound) return false;
+            size_t marker = find_ff_marker(r.p, r.i, std::min(r.n, r.i + 1000 + 3));
+            if(marker == NOT_FOUND) return false;
+            r.i = marker;
 
             if(!r.skip(41)) return false;
 
@@ -528,28 +737,23 @@ if(is_foliage){
             size_t searchStart = r.i;
             size_t searchLimit = r.n;
 
-            for(size_t searchPos = searchStart; searchPos + 28 <= searchLimit; ++searchPos){
-                uint32_t bufferID = (uint32_t(r.p[searchPos])<<24) | (uint32_t(r.p[searchPos+1])<<16) |
-                                   (uint32_t(r.p[searchPos+2])<<8) | r.p[searchPos+3];
+            // Candidates are found by the ID's low byte, then checked whole.
+            for(size_t from = searchStart; from + 28 <= searchLimit;){
+                const void* hit = std::memchr(r.p + from + 3, (uint8_t)mi, searchLimit - 28 - from + 1);
+                if(!hit) break;
+                size_t searchPos = (size_t)((const uint8_t*)hit - r.p) - 3;
+                from = searchPos + 1;
 
-                if(bufferID != mi) continue;
+                if(be32_at(r.p + searchPos) != mi) continue;
 
-                uint32_t someCount = (uint32_t(r.p[searchPos+8])<<24) | (uint32_t(r.p[searchPos+9])<<16) |
-                                     (uint32_t(r.p[searchPos+10])<<8) | r.p[searchPos+11];
-                uint32_t tlen = (uint32_t(r.p[searchPos+12])<<24) | (uint32_t(r.p[searchPos+13])<<16) |
-                               (uint32_t(r.p[searchPos+14])<<8) | r.p[searchPos+15];
-                uint32_t vtx = (uint32_t(r.p[searchPos+16])<<24) | (uint32_t(r.p[searchPos+17])<<16) |
-                              (uint32_t(r.p[searchPos+18])<<8) | r.p[searchPos+19];
-                uint32_t sub = (uint32_t(r.p[searchPos+20])<<24) | (uint32_t(r.p[searchPos+21])<<16) |
-                              (uint32_t(r.p[searchPos+22])<<8) | r.p[searchPos+23];
+                uint32_t someCount = be32_at(r.p + searchPos + 8);
+                uint32_t tlen = be32_at(r.p + searchPos + 12);
+                uint32_t vtx = be32_at(r.p + searchPos + 16);
+                uint32_t sub = be32_at(r.p + searchPos + 20);
 
                 if(someCount >= 65535u || tlen >= 65535u || vtx >= 65535u || sub >= 256u) continue;
 
-                if(sub > 0){
-                    uint32_t marker = (uint32_t(r.p[searchPos+24])<<24) | (uint32_t(r.p[searchPos+25])<<16) |
-                                     (uint32_t(r.p[searchPos+26])<<8) | r.p[searchPos+27];
-                    if(marker != 0xFFFFFFFF) continue;
-                }
+                if(sub > 0 && be32_at(r.p + searchPos + 24) != 0xFFFFFFFF) continue;
 
                 r.i = searchPos;
                 found = true;
@@ -607,102 +811,71 @@ if(is_foliage){
     return true;
 }
 
-bool parse_mdl_geometry(const std::vector<unsigned char>& data, const MDLInfo& info, std::vector<MDLMeshGeom>& out){
-    out.clear();
-    if(info.MeshBuffers.size()!=info.Meshes.size()) return true;
-    R r{data.data(), data.size(), 0};
-    for(size_t mi=0; mi<info.MeshBuffers.size(); ++mi){
-        const auto& mb=info.MeshBuffers[mi];
-        MDLMeshGeom g;
-        if(mi<info.Meshes.size() && !info.Meshes[mi].Materials.empty())
-            g.diffuse_tex_name=info.Meshes[mi].Materials[0].TextureName;
-
-        size_t vertex_stride = mb.IsAltPath ? 20 : 28;
+namespace {
+// One mesh buffer's vertices and strip, decoded; empty when it runs past the data.
+MDLMeshGeom decode_mesh_buffer(const R& r, const MDLMeshBufferInfo& mb, std::string diffuse_tex_name){
+    MDLMeshGeom g;
+    g.diffuse_tex_name=std::move(diffuse_tex_name);
 
-        if(mb.VertexCount==0 || mb.FaceCount==0 || mb.VertexOffset+(size_t)mb.VertexCount*vertex_stride>r.n || mb.FaceOffset+(size_t)mb.FaceCount*2>r.n){
-            out.push_back(std::move(g)); continue;
-        }
+    size_t vertex_stride = mb.IsAltPath ? MdlVertexAlt::stride : MdlVertexMain::stride;
 
-        g.positions.resize((size_t)mb.VertexCount*3);
-        g.normals.resize((size_t)mb.VertexCount*3);
-        g.uvs.resize((size_t)mb.VertexCount*2);
-        g.bone_ids.resize((size_t)mb.VertexCount*4);
-        g.bone_weights.resize((size_t)mb.VertexCount*4);
-
-        const uint8_t* vp=r.p+mb.VertexOffset;
-        for(uint32_t v=0; v<mb.VertexCount; ++v){
-            const uint8_t* p=vp+v*vertex_stride;
-            uint16_t hx=(uint16_t(p[0])<<8)|p[1];
-            uint16_t hy=(uint16_t(p[2])<<8)|p[3];
-            uint16_t hz=(uint16_t(p[4])<<8)|p[5];
-            g.positions[v*3+0]=half_to_float(hx);
-            g.positions[v*3+1]=half_to_float(hy);
-            g.positions[v*3+2]=half_to_float(hz);
-
-            g.normals[v*3+0]=0.0f;
-            g.normals[v*3+1]=1.0f;
-            g.normals[v*3+2]=0.0f;
-
-            if(!mb.IsAltPath && vertex_stride >= 20){
-                uint8_t bone_idx = p[15];
-                uint8_t weight_val = p[19];
-
-                if(bone_idx < 255){
-                    g.bone_ids[v*4+0] = bone_idx;
-                    g.bone_ids[v*4+1] = 0;
-                    g.bone_ids[v*4+2] = 0;
-                    g.bone_ids[v*4+3] = 0;
-
-                    float w = (weight_val > 0) ? (weight_val / 255.0f) : 1.0f;
-                    g.bone_weights[v*4+0] = w;
-                    g.bone_weights[v*4+1] = 0.0f;
-                    g.bone_weights[v*4+2] = 0.0f;
-                    g.bone_weights[v*4+3] = 0.0f;
-                } else {
-                    g.bone_ids[v*4+0] = 0;
-                    g.bone_ids[v*4+1] = 0;
-                    g.bone_ids[v*4+2] = 0;
-                    g.bone_ids[v*4+3] = 0;
-
-                    g.bone_weights[v*4+0] = 1.0f;
-                    g.bone_weights[v*4+1] = 0.0f;
-                    g.bone_weights[v*4+2] = 0.0f;
-                    g.bone_weights[v*4+3] = 0.0f;
-                }
-            } else {
-                g.bone_ids[v*4+0] = 0;
-                g.bone_ids[v*4+1] = 0;
-                g.bone_ids[v*4+2] = 0;
-                g.bone_ids[v*4+3] = 0;
-
-                g.bone_weights[v*4+0] = 1.0f;
-                g.bone_weights[v*4+1] = 0.0f;
-                g.bone_weights[v*4+2] = 0.0f;
-                g.bone_weights[v*4+3] = 0.0f;
-            }
+    if(mb.VertexCount==0 || mb.FaceCount==0 || mb.VertexOffset+(size_t)mb.VertexCount*vertex_stride>r.n || mb.FaceOffset+(size_t)mb.FaceCount*2>r.n){
+        return g;
+    }
 
-            size_t uv_offset = mb.IsAltPath ? 12 : 20;
-            uint16_t uu=(uint16_t(p[uv_offset+0])<<8)|p[uv_offset+1];
-            uint16_t vv=(uint16_t(p[uv_offset+2])<<8)|p[uv_offset+3];
-            g.uvs[v*2+0]=half_to_float(uu);
-            g.uvs[v*2+1]=half_to_float(vv);
-        }
+    g.positions.resize((size_t)mb.VertexCount*3);
+    g.uvs.resize((size_t)mb.VertexCount*2);
+    g.bone_ids.resize((size_t)mb.VertexCount*4);
+    g.bone_weights.resize((size_t)mb.VertexCount*4);
+
+    VertexSink sink;
+    sink.position=g.positions.data();
+    sink.uv=g.uvs.data();
+    sink.bone_ids=g.bone_ids.data();
+    sink.bone_weights=g.bone_weights.data();
+    const uint8_t* vp=r.p+mb.VertexOffset;
+    if(mb.IsAltPath) decode_mdl_vertices<MdlVertexAlt>(vp, mb.VertexCount, sink);
+    else decode_mdl_vertices<MdlVertexMain>(vp, mb.VertexCount, sink);
+
+    std::vector<uint16_t> strip(mb.FaceCount);
+    const uint8_t* fp=r.p+mb.FaceOffset; bool hasFFFF=false;
+    for(uint32_t i=0;i<mb.FaceCount;i++){
+        uint16_t w=(uint16_t(fp[i*2+0])<<8)|fp[i*2+1];
+        strip[i]=w; if(w==0xFFFF) hasFFFF=true;
+    }
+    if(hasFFFF){ build_triangles_from_strip(strip, g.indices); }
+    else{
+        size_t triCount=strip.size()/3; g.indices.resize(triCount*3);
+        for(size_t t=0;t<triCount;t++){ g.indices[t*3+0]=strip[t*3+0]; g.indices[t*3+1]=strip[t*3+1]; g.indices[t*3+2]=strip[t*3+2]; }
+    }
 
-        std::vector<uint16_t> strip(mb.FaceCount);
-        const uint8_t* fp=r.p+mb.FaceOffset; bool hasFFFF=false;
-        for(uint32_t i=0;i<mb.FaceCount;i++){
-            uint16_t w=(uint16_t(fp[i*2+0])<<8)|fp[i*2+1];
-            strip[i]=w; if(w==0xFFFF) hasFFFF=true;
-        }
-        if(hasFFFF){ build_triangles_from_strip(strip, g.indices); }
-        else{
-            size_t triCount=strip.size()/3; g.indices.resize(triCount*3);
-            for(size_t t=0;t<triCount;t++){ g.indices[t*3+0]=strip[t*3+0]; g.indices[t*3+1]=strip[t*3+1]; g.indices[t*3+2]=strip[t*3+2]; }
-        }
+    bool stored = mb.IsAltPath ? decode_stored_vectors<MdlVertexAlt>(vp, mb.VertexCount, g)
+                               : decode_stored_vectors<MdlVertexMain>(vp, mb.VertexCount, g);
+    if(!stored) generate_normals(g.positions, g.indices, g.normals);
+    return g;
+}
+}
 
-        compute_smooth_normals(mb.VertexCount, g.indices, g.positions, g.normals);
+bool parse_mdl_geometry(const std::vector<unsigned char>& data, const MDLInfo& info, std::vector<MDLMeshGeom>& out){
+    out.clear();
+    if(info.MeshBuffers.size()!=info.Meshes.size()) return true;
+    R r{data.data(), data.size(), 0};
+    for(size_t mi=0; mi<info.MeshBuffers.size(); ++mi){
+        const auto& mats=info.Meshes[mi].Materials;
+        out.push_back(decode_mesh_buffer(r, info.MeshBuffers[mi], mats.empty() ? std::string() : mats[0].TextureName));
+    }
+    return true;
+}
 
-        out.push_back(std::move(g));
+bool parse_mdl_geometry(const MDLView& view, std::vector<MDLMeshGeom>& out){
+    out.clear();
+    if(view.MeshBuffers.size()!=view.Meshes.size()) return true;
+    R r{view.Data, view.Size, 0};
+    for(size_t mi=0; mi<view.MeshBuffers.size(); ++mi){
+        const auto& m=view.Meshes[mi];
+        std::string diffuse;
+        if(m.EndMaterial>m.FirstMaterial) diffuse.assign(view.Materials[m.FirstMaterial].TextureName);
+        out.push_back(decode_mesh_buffer(r, view.MeshBuffers[mi], std::move(diffuse)));
     }
     return true;
 }
\ No newline at end of file
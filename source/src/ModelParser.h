@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cstdint>
 
@@ -54,9 +55,54 @@ struct MDLInfo {
     std::vector<MDLMeshBufferInfo> MeshBuffers;
 };
 
+// Non-owning counterparts of the structs above, for callers that only need
+// names, counts or offsets. Names view the buffer parse_mdl_view read, so a
+// view lives no longer than that buffer. Reusing one MDLView across models
+// keeps its arrays' capacity, so a parse allocates nothing once they are big
+// enough.
+struct MDLBoneView {
+    std::string_view Name;
+    int ParentID = -1;
+};
+
+struct MDLMaterialView {
+    std::string_view TextureName;
+    std::string_view SpecularMapName;
+    std::string_view NormalMapName;
+    std::string_view UnkName;
+    std::string_view TintName;
+    uint32_t Unk1 = 0;
+    uint32_t Unk2[2] = {0, 0};
+};
+
+struct MDLMeshView {
+    std::string_view MeshName;
+    uint32_t MaterialCount = 0;   // as stored; only plausible counts are parsed
+    uint32_t FirstMaterial = 0;   // this mesh's materials are MDLView::Materials
+    uint32_t EndMaterial = 0;     // [FirstMaterial, EndMaterial)
+};
+
+struct MDLView {
+    const unsigned char* Data = nullptr;
+    size_t Size = 0;
+    std::string_view Magic;
+    uint32_t HeaderSize = 0;
+    uint32_t BoneCount = 0;
+    uint32_t BoneTransformCount = 0;
+    bool HasBoneTransforms = false;
+    size_t BoneTransformOffset = 0;  // 11 big-endian floats per bone
+    uint32_t Unk6Count = 0;
+    uint32_t MeshCount = 0;
+    std::vector<MDLBoneView> Bones;
+    std::vector<MDLMeshView> Meshes;
+    std::vector<MDLMaterialView> Materials;
+    std::vector<MDLMeshBufferInfo> MeshBuffers;  // SubMeshes stay empty
+};
+
 struct MDLMeshGeom {
     std::vector<float> positions;
     std::vector<float> normals;
+    std::vector<float> tangents;  // xyzw; empty unless stored in the vertex stream
     std::vector<float> uvs;
     std::vector<uint32_t> indices;
     std::vector<uint16_t> bone_ids;
@@ -64,7 +110,24 @@ struct MDLMeshGeom {
     std::string diffuse_tex_name;
 };
 
+// Header + body of a model in globals_model_headers/globals_models, by
+// entry name (case and slash direction ignored), read through readers shared
+// across calls and threads.
 bool build_mdl_buffer_for_name(const std::string &mdl_name, std::vector<unsigned char> &out);
+// A model in a nested BNK: its body by index, prefixed with the global header
+// of the same file name when there is one.
+bool build_nested_mdl_buffer(const std::string &nested_bnk_path, int file_index, std::vector<unsigned char> &out);
 bool parse_mdl_info(const std::vector<unsigned char>& data, MDLInfo& out);
 bool parse_mdl_info(const std::vector<unsigned char>& data, MDLInfo& out, const std::string& file_path);
-bool parse_mdl_geometry(const std::vector<unsigned char>& data, const MDLInfo& info, std::vector<MDLMeshGeom>& out);
\ No newline at end of file
+bool parse_mdl_geometry(const std::vector<unsigned char>& data, const MDLInfo& info, std::vector<MDLMeshGeom>& out);
+
+// The header walk behind parse_mdl_info, without copying anything out of
+// `data`. `file_path` only matters for foliage models, which use their own
+// buffer layout.
+bool parse_mdl_view(const unsigned char* data, size_t size, MDLView& out, std::string_view file_path = {});
+void clear_mdl_view(MDLView& v);
+// One bone's rotation, translation and scale, as MDLInfo::BoneTransforms holds them.
+bool mdl_view_bone_transform(const MDLView& v, size_t bone, float out[11]);
+// The owning form, for callers that keep the header past its buffer.
+void mdl_view_to_info(const MDLView& v, MDLInfo& out);
+bool parse_mdl_geometry(const MDLView& view, std::vector<MDLMeshGeom>& out);
\ No newline at end of file
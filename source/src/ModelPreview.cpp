@@ -15,6 +15,9 @@
 #include "Utils.h"
 #include "BNKCore.cpp"
 #include "TexParser.h"
+#include "TexCache.h"
+#include "BCDecode.h"
+#include "X360Tiling.h"
 
 using namespace DirectX;
 
@@ -306,91 +309,11 @@ static bool extract_tex_bytes_by_candidate(const std::vector<std::string>& candi
     return best_idx >= 0 && !out.empty();
 }
 
-static inline uint8_t ex5(uint16_t v){ return (uint8_t)((v<<3)|(v>>2)); }
-static inline uint8_t ex6(uint16_t v){ return (uint8_t)((v<<2)|(v>>4)); }
-
-static void decode_bc1_block(const uint8_t* b, uint32_t* outRGBA) {
-    uint16_t c0 = (uint16_t)(b[0] | (b[1]<<8));
-    uint16_t c1 = (uint16_t)(b[2] | (b[3]<<8));
-    uint8_t r0=ex5((c0>>11)&31), g0=ex6((c0>>5)&63),  b0=ex5(c0&31);
-    uint8_t r1=ex5((c1>>11)&31), g1=ex6((c1>>5)&63),  b1=ex5(c1&31);
-    uint32_t cols[4];
-    cols[0] = (0xFFu<<24) | (r0<<16) | (g0<<8) | b0;
-    cols[1] = (0xFFu<<24) | (r1<<16) | (g1<<8) | b1;
-    if(c0 > c1){
-        cols[2] = (0xFFu<<24) | (((2*r0+r1)/3)<<16) | (((2*g0+g1)/3)<<8) | ((2*b0+b1)/3);
-        cols[3] = (0xFFu<<24) | (((r0+2*r1)/3)<<16) | (((g0+2*g1)/3)<<8) | ((b0+2*b1)/3);
-    }else{
-        cols[2] = (0xFFu<<24) | (((r0+r1)>>1)<<16) | (((g0+g1)>>1)<<8) | ((b0+b1)>>1);
-        cols[3] = 0x00000000u;
-    }
-    const uint32_t idx = b[4] | (b[5]<<8) | (b[6]<<16) | (b[7]<<24);
-    for(int py=0; py<4; ++py){
-        for(int px=0; px<4; ++px){
-            int s = (idx >> (2*(py*4+px))) & 3;
-            outRGBA[py*4+px] = cols[s];
-        }
-    }
-}
-
-static void decode_bc3_block(const uint8_t* b, uint32_t* outRGBA){
-    uint8_t a0=b[0], a1=b[1];
-    uint64_t abits = 0;
-    for(int i=0;i<6;++i) abits |= (uint64_t)b[2+i] << (8*i);
-    uint8_t atab[8];
-    atab[0]=a0; atab[1]=a1;
-    if(a0>a1){ for(int i=1;i<=6;i++) atab[i+1]=(uint8_t)(((7-i)*a0 + i*a1)/7); }
-    else{ for(int i=1;i<=4;i++) atab[i+1]=(uint8_t)(((5-i)*a0 + i*a1)/5); atab[6]=0; atab[7]=255; }
-    uint32_t color[16];
-    decode_bc1_block(b+8, color);
-    for(int i=0;i<16;++i){
-        uint8_t ai = (uint8_t)((abits>>(3*i)) & 7);
-        color[i] = (color[i] & 0x00FFFFFFu) | ( ((uint32_t)atab[ai])<<24 );
-    }
-    for(int i=0;i<16;++i) outRGBA[i]=color[i];
-}
-
-static void swap_bc1_endian(uint8_t* data, size_t size) {
-    for(size_t i = 0; i + 8 <= size; i += 8) {
-        uint16_t c0 = (data[i+0] << 8) | data[i+1];
-        uint16_t c1 = (data[i+2] << 8) | data[i+3];
-        uint32_t idx = (data[i+4] << 24) | (data[i+5] << 16) | (data[i+6] << 8) | data[i+7];
-
-        data[i+0] = c0 & 0xFF;
-        data[i+1] = (c0 >> 8) & 0xFF;
-        data[i+2] = c1 & 0xFF;
-        data[i+3] = (c1 >> 8) & 0xFF;
-        data[i+4] = idx & 0xFF;
-        data[i+5] = (idx >> 8) & 0xFF;
-        data[i+6] = (idx >> 16) & 0xFF;
-        data[i+7] = (idx >> 24) & 0xFF;
-    }
-}
-
-static void swap_bc3_endian(uint8_t* data, size_t size) {
-    for(size_t i = 0; i + 16 <= size; i += 16) {
-        uint64_t alpha_bits = 0;
-        for(int j = 0; j < 6; j++) {
-            alpha_bits |= ((uint64_t)data[i+2+j]) << (j*8);
-        }
-
-        uint64_t alpha_swapped = 0;
-        for(int j = 0; j < 6; j++) {
-            alpha_swapped |= ((alpha_bits >> (j*8)) & 0xFF) << ((5-j)*8);
-        }
-
-        for(int j = 0; j < 6; j++) {
-            data[i+2+j] = (alpha_swapped >> (j*8)) & 0xFF;
-        }
-
-        swap_bc1_endian(data + i + 8, 8);
-    }
-}
-
 static bool srv_from_tex_blob_auto(ID3D11Device* dev,
                                    const std::vector<unsigned char>& blob,
                                    ID3D11ShaderResourceView** out_srv,
-                                   bool* out_has_alpha)
+                                   bool* out_has_alpha,
+                                   bool tiled)
 {
     *out_srv=nullptr;
     if(out_has_alpha) *out_has_alpha = false;
@@ -413,9 +336,6 @@ static bool srv_from_tex_blob_auto(ID3D11Device* dev,
     int h = m.HasWH ? (int)m.MipHeight : std::max(1, (int)ti.TextureHeight >> (int)best);
     if(m.MipDataOffset + m.MipDataSizeParsed > blob.size()) return false;
 
-    size_t bx = (size_t)((w+3)/4), by = (size_t)((h+3)/4);
-    size_t sz_bc1 = bx*by*8;
-    size_t sz_bc3 = bx*by*16;
     size_t sz_raw = (size_t)w*(size_t)h*4;
 
     std::vector<uint8_t> rgba((size_t)w*(size_t)h*4, 0xFF);
@@ -430,49 +350,15 @@ static bool srv_from_tex_blob_auto(ID3D11Device* dev,
         return false;
     };
 
-    if(ti.PixelFormat == 35){
-        if(m.MipDataSizeParsed < sz_bc1) return false;
-        std::vector<uint8_t> swapped(src, src + sz_bc1);
-        swap_bc1_endian(swapped.data(), swapped.size());
-
-        size_t off=0;
-        for(size_t byy=0; byy<by; ++byy){
-            for(size_t bxx=0; bxx<bx; ++bxx){
-                uint32_t block[16];
-                decode_bc1_block(swapped.data()+off, block); off += 8;
-                for(int py=0; py<4; ++py){
-                    int yy = (int)byy*4 + py; if(yy>=h) break;
-                    for(int px=0; px<4; ++px){
-                        int xx=(int)bxx*4 + px; if(xx>=w) break;
-                        ((uint32_t*)rgba.data())[yy*w+xx] = block[py*4+px];
-                    }
-                }
-            }
-        }
-        if(out_has_alpha) *out_has_alpha = any_alpha_lt_255(rgba);
-        *out_srv = create_srv_from_rgba(dev, w, h, rgba);
-        return (*out_srv != nullptr);
-    }
-
-    if(ti.PixelFormat == 39){
-        if(m.MipDataSizeParsed < sz_bc3) return false;
-        std::vector<uint8_t> swapped(src, src + sz_bc3);
-        swap_bc3_endian(swapped.data(), swapped.size());
-
-        size_t off=0;
-        for(size_t byy=0; byy<by; ++byy){
-            for(size_t bxx=0; bxx<bx; ++bxx){
-                uint32_t block[16];
-                decode_bc3_block(swapped.data()+off, block); off += 16;
-                for(int py=0; py<4; ++py){
-                    int yy = (int)byy*4 + py; if(yy>=h) break;
-                    for(int px=0; px<4; ++px){
-                        int xx=(int)bxx*4 + px; if(xx>=w) break;
-                        ((uint32_t*)rgba.data())[yy*w+xx] = block[py*4+px];
-                    }
-                }
-            }
+    BCFormat fmt = bc_format_from_pixel_format(ti.PixelFormat);
+    if(fmt == BCFormat::BC1 || fmt == BCFormat::BC3){
+        size_t src_size = m.MipDataSizeParsed;
+        std::vector<uint8_t> linear;
+        if(tiled){
+            if(!x360_untile_bc(fmt, src, src_size, w, h, linear)) return false;
+            src = linear.data(); src_size = linear.size();
         }
+        if(!bc_decode(fmt, src, src_size, w, h, rgba.data(), BCChannelOrder::BGRA)) return false;
         if(out_has_alpha) *out_has_alpha = any_alpha_lt_255(rgba);
         *out_srv = create_srv_from_rgba(dev, w, h, rgba);
         return (*out_srv != nullptr);
@@ -489,6 +375,31 @@ static bool srv_from_tex_blob_auto(ID3D11Device* dev,
     return (*out_srv != nullptr);
 }
 
+// Decoded images come from the shared cache; the preview has always shown
+// them in BGRA order, so the swizzle happens on upload. Blobs that are not
+// block compressed still go through srv_from_tex_blob_auto.
+static bool srv_from_cached_texture(ID3D11Device* dev,
+                                    const std::string& tex_name,
+                                    ID3D11ShaderResourceView** out_srv,
+                                    bool* out_has_alpha)
+{
+    *out_srv=nullptr;
+    if(out_has_alpha) *out_has_alpha = false;
+    bool tiled = texture_is_tiled(tex_name);
+
+    if(TexImagePtr img = tex_cache_image(tex_name, tiled)){
+        if(img->pixel_format == 40) return false;
+        std::vector<uint8_t> bgra(img->rgba);
+        for(size_t i=0;i+3<bgra.size();i+=4) std::swap(bgra[i], bgra[i+2]);
+        if(out_has_alpha) *out_has_alpha = img->has_alpha;
+        *out_srv = create_srv_from_rgba(dev, img->width, img->height, bgra);
+        return (*out_srv != nullptr);
+    }
+
+    TexBlobPtr blob = tex_cache_blob(tex_name);
+    return blob && srv_from_tex_blob_auto(dev, *blob, out_srv, out_has_alpha, tiled);
+}
+
 static bool build_mesh_textures(ID3D11Device* dev,
                                 const MDLInfo& info,
                                 size_t mesh_index,
@@ -529,20 +440,18 @@ static bool build_mesh_textures(ID3D11Device* dev,
             candidates.push_back(basename + ".tex");
         }
 
-        std::vector<unsigned char> blob;
         for (const auto& candidate : candidates) {
-            if (build_tex_buffer_for_name(candidate, blob)) {
-                bool hasA = false;
-                if (srv_from_tex_blob_auto(dev, blob, out_srv, &hasA)) {
-                    if(want_alpha && out_has_alpha && hasA) *out_has_alpha = true;
-                    if (*out_srv) return;
-                }
+            bool hasA = false;
+            if (srv_from_cached_texture(dev, candidate, out_srv, &hasA)) {
+                if(want_alpha && out_has_alpha && hasA) *out_has_alpha = true;
+                if (*out_srv) return;
             }
         }
 
+        std::vector<unsigned char> blob;
         if (extract_tex_bytes_by_candidate(candidates, blob)) {
             bool hasA = false;
-            if (srv_from_tex_blob_auto(dev, blob, out_srv, &hasA)) {
+            if (srv_from_tex_blob_auto(dev, blob, out_srv, &hasA, texture_is_tiled(tex_name))) {
                 if(want_alpha && out_has_alpha && hasA) *out_has_alpha = true;
             }
         }
@@ -622,10 +531,7 @@ bool MP_Build(ID3D11Device* dev, const std::vector<MDLMeshGeom>& geoms, const MD
 
         bool hasA = false;
         if(!g.diffuse_tex_name.empty()){
-            std::vector<unsigned char> tex_buf;
-            if(build_any_tex_buffer_for_name(g.diffuse_tex_name, tex_buf)){
-                if(srv_from_tex_blob_auto(dev, tex_buf, &m.srv_diffuse, &hasA)){}
-            }
+            srv_from_cached_texture(dev, g.diffuse_tex_name, &m.srv_diffuse, &hasA);
         }
 
         if (!m.srv_diffuse && mp.default_srv) { m.srv_diffuse = mp.default_srv; m.srv_diffuse->AddRef(); }
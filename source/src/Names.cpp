@@ -0,0 +1,65 @@
+#include "Names.h"
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+    struct NamePool {
+        std::mutex mutex;
+        std::deque<std::string> storage;
+        std::unordered_map<std::string_view, uint32_t> ids;
+    };
+
+    NamePool &pool() {
+        static NamePool p;
+        return p;
+    }
+
+    inline char fold(char c) {
+        return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+    }
+
+    bool ends_with_folded(std::string_view s, std::string_view ext) {
+        if (s.size() < ext.size()) return false;
+        size_t o = s.size() - ext.size();
+        for (size_t i = 0; i < ext.size(); ++i)
+            if (fold(s[o + i]) != ext[i]) return false;
+        return true;
+    }
+}
+
+AssetType classify_asset(std::string_view name) {
+    if (ends_with_folded(name, ".wav")) return AssetType::Wav;
+    if (ends_with_folded(name, ".tex")) return AssetType::Tex;
+    if (ends_with_folded(name, ".mdl")) return AssetType::Mdl;
+    if (ends_with_folded(name, ".bnk")) return AssetType::Bnk;
+    return AssetType::Other;
+}
+
+InternedName intern_name(std::string_view s) {
+    NamePool &p = pool();
+    std::lock_guard<std::mutex> lock(p.mutex);
+    auto it = p.ids.find(s);
+    if (it != p.ids.end()) return {it->second, it->first};
+    p.storage.emplace_back(s);
+    std::string_view stored(p.storage.back());
+    uint32_t id = (uint32_t)p.storage.size();
+    p.ids.emplace(stored, id);
+    return {id, stored};
+}
+
+InternedName intern_folded(std::string_view s) {
+    for (char c : s)
+        if (c >= 'A' && c <= 'Z') return intern_name(fold_case(s));
+    return intern_name(s);
+}
+
+std::string fold_case(std::string_view s) {
+    std::string out(s);
+    for (auto &c : out) c = fold(c);
+    return out;
+}
+
+bool folded_contains(std::string_view folded_haystack, std::string_view folded_needle) {
+    return folded_needle.empty() || folded_haystack.find(folded_needle) != std::string_view::npos;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+enum class AssetType : uint8_t {
+    Other = 0,
+    Wav,
+    Tex,
+    Mdl,
+    Bnk,
+};
+
+// Interned strings live for the whole process; text stays valid and two
+// names are equal exactly when their ids are.
+struct InternedName {
+    uint32_t id = 0;
+    std::string_view text;
+};
+
+AssetType classify_asset(std::string_view name);
+InternedName intern_name(std::string_view s);
+InternedName intern_folded(std::string_view s);
+std::string fold_case(std::string_view s);
+bool folded_contains(std::string_view folded_haystack, std::string_view folded_needle);
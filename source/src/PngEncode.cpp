@@ -0,0 +1,186 @@
+#include "PngEncode.h"
+#include "Utils.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <zlib.h>
+
+namespace {
+    constexpr int BPP = 4;
+    constexpr size_t SEGMENT_BYTES = 512 * 1024;
+    constexpr size_t WINDOW_BYTES = 32 * 1024;
+
+    // Predictor of filter TYPE for one byte, from the left (a), up (b) and
+    // upper-left (c) neighbours. Paeth computes pa, pb and pc from b - c and
+    // a - c, as the spec does, then picks with plain compares and selects.
+    template<int TYPE>
+    int predict(int a, int b, int c) {
+        if (TYPE == 1) return a;
+        if (TYPE == 2) return b;
+        if (TYPE == 3) return (a + b) >> 1;
+        if (TYPE == 4) {
+            int pa = std::abs(b - c), pb = std::abs(a - c), pc = std::abs(a + b - 2 * c);
+            return (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+        }
+        return 0;
+    }
+
+    // Applies filter TYPE to one row; returns the sum of the filtered bytes
+    // read as signed values, the usual estimate of how well the row deflates.
+    // One instantiation per filter, with the first pixel peeled off, keeps
+    // the main loop free of branches so the compiler can vectorize it. The
+    // first row passes a zero row as `prev`, as the PNG spec assumes.
+    template<int TYPE>
+    uint32_t filter_row(const uint8_t *row, const uint8_t *prev, size_t n, uint8_t *out) {
+        uint32_t cost = 0;
+        for (size_t i = 0; i < (size_t) BPP && i < n; ++i) {
+            uint8_t v = (uint8_t) (row[i] - predict<TYPE>(0, prev[i], 0));
+            out[i] = v;
+            cost += (uint32_t) std::abs((int) (int8_t) v);
+        }
+        for (size_t i = BPP; i < n; ++i) {
+            uint8_t v = (uint8_t) (row[i] - predict<TYPE>(row[i - BPP], prev[i], prev[i - BPP]));
+            out[i] = v;
+            cost += (uint32_t) std::abs((int) (int8_t) v);
+        }
+        return cost;
+    }
+
+    uint32_t filter_row(int type, const uint8_t *row, const uint8_t *prev, size_t n, uint8_t *out) {
+        switch (type) {
+            case 1: return filter_row<1>(row, prev, n, out);
+            case 2: return filter_row<2>(row, prev, n, out);
+            case 3: return filter_row<3>(row, prev, n, out);
+            case 4: return filter_row<4>(row, prev, n, out);
+            default: return filter_row<0>(row, prev, n, out);
+        }
+    }
+
+    void filter_rows(const uint8_t *rgba, int w, int y0, int y1, uint8_t *dst) {
+        const size_t n = (size_t) w * BPP;
+        std::vector<uint8_t> trial(n), zero(n, 0);
+        for (int y = y0; y < y1; ++y) {
+            const uint8_t *row = rgba + (size_t) y * n;
+            const uint8_t *prev = y > 0 ? row - n : zero.data();
+            uint8_t *out = dst + (size_t) y * (n + 1);
+
+            int best = 0;
+            uint32_t best_cost = filter_row(0, row, prev, n, out + 1);
+            for (int type = 1; type <= 4 && best_cost; ++type) {
+                uint32_t cost = filter_row(type, row, prev, n, trial.data());
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best = type;
+                    std::memcpy(out + 1, trial.data(), n);
+                }
+            }
+            out[0] = (uint8_t) best;
+        }
+    }
+
+    // Raw deflate of one segment. All but the last end on a sync flush, so
+    // the pieces concatenate into one valid stream.
+    bool deflate_segment(const uint8_t *data, size_t size, const uint8_t *dict, size_t dict_size, bool last,
+                         int level, std::vector<uint8_t> &out) {
+        z_stream zs{};
+        if (deflateInit2(&zs, level, Z_DEFLATED, -MAX_WBITS, 8, Z_FILTERED) != Z_OK) return false;
+        if (dict_size) deflateSetDictionary(&zs, dict, (uInt) dict_size);
+
+        out.resize(deflateBound(&zs, (uLong) size) + 16);
+        zs.next_in = const_cast<Bytef *>(data);
+        zs.avail_in = (uInt) size;
+        zs.next_out = out.data();
+        zs.avail_out = (uInt) out.size();
+        int rc = deflate(&zs, last ? Z_FINISH : Z_SYNC_FLUSH);
+        bool ok = last ? rc == Z_STREAM_END : (rc == Z_OK && zs.avail_in == 0);
+        out.resize(zs.total_out);
+        deflateEnd(&zs);
+        return ok;
+    }
+
+    void put_be32(std::vector<uint8_t> &out, uint32_t v) {
+        out.push_back((v >> 24) & 0xFF);
+        out.push_back((v >> 16) & 0xFF);
+        out.push_back((v >> 8) & 0xFF);
+        out.push_back(v & 0xFF);
+    }
+
+    void write_chunk(std::vector<uint8_t> &out, const char *type, const uint8_t *data, size_t size) {
+        put_be32(out, (uint32_t) size);
+        out.insert(out.end(), type, type + 4);
+        if (size) out.insert(out.end(), data, data + size);
+        uLong crc = crc32(0L, reinterpret_cast<const Bytef *>(type), 4);
+        if (size) crc = crc32(crc, data, (uInt) size);
+        put_be32(out, (uint32_t) crc);
+    }
+}
+
+bool png_encode_rgba(const uint8_t *rgba, int w, int h, std::vector<uint8_t> &out, int level, int max_threads) {
+    if (!rgba || w <= 0 || h <= 0) return false;
+    level = std::clamp(level, 0, 9);
+    if (max_threads <= 0) max_threads = (int) std::max(1u, std::thread::hardware_concurrency());
+
+    const size_t stride = (size_t) w * BPP + 1;
+    const size_t total = stride * (size_t) h;
+    const int rows_per_segment = (int) std::max<size_t>(1, SEGMENT_BYTES / stride);
+    const size_t segments = ((size_t) h + rows_per_segment - 1) / rows_per_segment;
+
+    try {
+        std::vector<uint8_t> filtered(total);
+        std::vector<std::vector<uint8_t>> packed(segments);
+        std::vector<uLong> adlers(segments);
+        std::vector<char> ok(segments, 0);
+
+        // Filtering only reads the unfiltered image, so every segment can be
+        // filtered independently; compression needs the preceding window,
+        // so it waits until all rows are done.
+        parallel_for(segments, [&](size_t s) {
+            int y0 = (int) s * rows_per_segment;
+            filter_rows(rgba, w, y0, std::min(h, y0 + rows_per_segment), filtered.data());
+        }, max_threads);
+
+        parallel_for(segments, [&](size_t s) {
+            size_t begin = s * rows_per_segment * stride;
+            size_t end = std::min(total, begin + rows_per_segment * stride);
+            size_t dict = std::min(begin, WINDOW_BYTES);
+            ok[s] = deflate_segment(filtered.data() + begin, end - begin, filtered.data() + begin - dict, dict,
+                                    s + 1 == segments, level, packed[s]);
+            adlers[s] = adler32(adler32(0L, Z_NULL, 0), filtered.data() + begin, (uInt) (end - begin));
+        }, max_threads);
+
+        if (std::find(ok.begin(), ok.end(), 0) != ok.end()) return false;
+
+        uLong adler = adlers[0];
+        for (size_t s = 1; s < segments; ++s) {
+            size_t begin = s * rows_per_segment * stride;
+            size_t len = std::min(total, begin + rows_per_segment * stride) - begin;
+            adler = adler32_combine(adler, adlers[s], (z_off_t) len);
+        }
+
+        out.clear();
+        static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+        out.insert(out.end(), signature, signature + 8);
+
+        uint8_t ihdr[13] = {};
+        ihdr[0] = (w >> 24) & 0xFF; ihdr[1] = (w >> 16) & 0xFF; ihdr[2] = (w >> 8) & 0xFF; ihdr[3] = w & 0xFF;
+        ihdr[4] = (h >> 24) & 0xFF; ihdr[5] = (h >> 16) & 0xFF; ihdr[6] = (h >> 8) & 0xFF; ihdr[7] = h & 0xFF;
+        ihdr[8] = 8;
+        ihdr[9] = 6;
+        write_chunk(out, "IHDR", ihdr, sizeof(ihdr));
+
+        // zlib header (FLEVEL mirrors what zlib itself would write) in front
+        // of the first segment, Adler-32 of all filtered bytes after the last.
+        uint8_t zhdr[2] = {0x78, (uint8_t) (level < 2 ? 0x01 : level < 6 ? 0x5E : level == 6 ? 0x9C : 0xDA)};
+        packed.front().insert(packed.front().begin(), zhdr, zhdr + 2);
+        put_be32(packed.back(), (uint32_t) adler);
+
+        // One IDAT per segment; decoders treat consecutive IDATs as one stream.
+        for (const auto &p: packed)
+            write_chunk(out, "IDAT", p.data(), p.size());
+        write_chunk(out, "IEND", nullptr, 0);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
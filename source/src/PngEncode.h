@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Encodes a tightly packed 8-bit RGBA image as a PNG. Each row gets the
+// filter whose output has the smallest sum of absolute values, and the
+// filtered data is deflated with zlib. Large images are split into
+// segments of rows that are compressed on separate threads. Each segment
+// is primed with the previous segment's last 32 KB, and the pieces are
+// joined into one zlib stream with a combined Adler-32. max_threads = 0
+// uses every core.
+bool png_encode_rgba(const uint8_t *rgba, int w, int h, std::vector<uint8_t> &out,
+                     int level = 6, int max_threads = 0);
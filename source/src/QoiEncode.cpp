@@ -0,0 +1,102 @@
+#include "QoiEncode.h"
+#include <cstring>
+
+namespace {
+    constexpr uint8_t QOI_OP_INDEX = 0x00;
+    constexpr uint8_t QOI_OP_DIFF = 0x40;
+    constexpr uint8_t QOI_OP_LUMA = 0x80;
+    constexpr uint8_t QOI_OP_RUN = 0xC0;
+    constexpr uint8_t QOI_OP_RGB = 0xFE;
+    constexpr uint8_t QOI_OP_RGBA = 0xFF;
+
+    inline uint32_t hash_px(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+        return (r * 3u + g * 5u + b * 7u + a * 11u) & 63;
+    }
+
+    inline uint8_t *put_be32(uint8_t *p, uint32_t v) {
+        p[0] = (uint8_t) (v >> 24);
+        p[1] = (uint8_t) (v >> 16);
+        p[2] = (uint8_t) (v >> 8);
+        p[3] = (uint8_t) v;
+        return p + 4;
+    }
+}
+
+bool qoi_encode_rgba(const uint8_t *rgba, int w, int h, std::vector<uint8_t> &out) {
+    if (!rgba || w <= 0 || h <= 0) return false;
+    const size_t px_count = (size_t) w * (size_t) h;
+
+    // Worst case is one QOI_OP_RGBA (5 bytes) per pixel; sizing for it up
+    // front keeps the loop free of capacity checks.
+    try {
+        out.resize(14 + px_count * 5 + 8);
+    } catch (...) {
+        return false;
+    }
+    uint8_t *p = out.data();
+    std::memcpy(p, "qoif", 4);
+    p = put_be32(p + 4, (uint32_t) w);
+    p = put_be32(p, (uint32_t) h);
+    *p++ = 4;  // channels
+    *p++ = 0;  // sRGB with linear alpha
+
+    uint32_t index[64] = {};
+    uint32_t prev = 0xFF000000u;  // r = g = b = 0, a = 255, packed little-endian
+    int run = 0;
+
+    for (size_t i = 0; i < px_count; ++i) {
+        uint32_t px;
+        std::memcpy(&px, rgba + i * 4, 4);
+
+        if (px == prev) {
+            if (++run == 62) {
+                *p++ = (uint8_t) (QOI_OP_RUN | (run - 1));
+                run = 0;
+            }
+            continue;
+        }
+        if (run) {
+            *p++ = (uint8_t) (QOI_OP_RUN | (run - 1));
+            run = 0;
+        }
+
+        uint8_t r = (uint8_t) px, g = (uint8_t) (px >> 8), b = (uint8_t) (px >> 16), a = (uint8_t) (px >> 24);
+        uint32_t slot = hash_px(r, g, b, a);
+        if (index[slot] == px) {
+            *p++ = (uint8_t) (QOI_OP_INDEX | slot);
+        } else {
+            index[slot] = px;
+            if (a == (uint8_t) (prev >> 24)) {
+                int8_t vr = (int8_t) (r - (uint8_t) prev);
+                int8_t vg = (int8_t) (g - (uint8_t) (prev >> 8));
+                int8_t vb = (int8_t) (b - (uint8_t) (prev >> 16));
+                int8_t vg_r = (int8_t) (vr - vg), vg_b = (int8_t) (vb - vg);
+                if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                    *p++ = (uint8_t) (QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+                } else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 && vg_b < 8) {
+                    *p++ = (uint8_t) (QOI_OP_LUMA | (vg + 32));
+                    *p++ = (uint8_t) ((vg_r + 8) << 4 | (vg_b + 8));
+                } else {
+                    *p++ = QOI_OP_RGB;
+                    *p++ = r;
+                    *p++ = g;
+                    *p++ = b;
+                }
+            } else {
+                *p++ = QOI_OP_RGBA;
+                *p++ = r;
+                *p++ = g;
+                *p++ = b;
+                *p++ = a;
+            }
+        }
+        prev = px;
+    }
+    if (run) *p++ = (uint8_t) (QOI_OP_RUN | (run - 1));
+
+    static const uint8_t padding[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+    std::memcpy(p, padding, 8);
+    p += 8;
+    out.resize((size_t) (p - out.data()));
+    return true;
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Encodes a tightly packed 8-bit RGBA image as QOI ("Quite OK Image",
+// qoiformat.org). One pass, no entropy coding: a few times larger than
+// our PNGs but far quicker to write, which suits bulk dumps that are
+// diffed or reviewed rather than shipped.
+bool qoi_encode_rgba(const uint8_t *rgba, int w, int h, std::vector<uint8_t> &out);
@@ -0,0 +1,239 @@
+#include "RebuildEngine.h"
+#include "Progress.h"
+#include "Utils.h"
+#include "BNKCore.cpp"
+#include "DdsExport.h"
+#include "X360Tiling.h"
+#include "mdl_converter.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+    using NameMap = std::unordered_map<std::string, int>;
+
+    std::string name_key(const std::string &name, RebuildMatch match) {
+        if (match == RebuildMatch::Filename) return to_lower(std::filesystem::path(name).filename().string());
+        std::string key = to_lower(name);
+        std::replace(key.begin(), key.end(), '\\', '/');
+        return key;
+    }
+
+    NameMap map_names(const BNKReader &r, RebuildMatch match) {
+        NameMap m;
+        const auto &files = r.list_files();
+        m.reserve(files.size() * 2 + 1);
+        for (size_t i = 0; i < files.size(); ++i) m.emplace(name_key(files[i].name, match), (int) i);
+        return m;
+    }
+
+    // Joins entries of the same name across `archives`, in archive order.
+    // Archives flagged in `required` must all have the name for a job to be
+    // planned; the others are appended when they do.
+    bool plan_joined(const std::vector<std::string> &archives, const std::vector<bool> &required,
+                     const std::vector<std::string> *names, const RebuildOutPath &out_path_for, bool texture,
+                     RebuildMatch match, RebuildPlan &plan, std::string &err) {
+        std::vector<std::vector<std::string>> listed(archives.size());
+        std::vector<NameMap> maps(archives.size());
+        try {
+            for (size_t a = 0; a < archives.size(); ++a) {
+                BNKReader r(archives[a]);
+                maps[a] = map_names(r, match);
+                if (!names && required[a])
+                    for (const auto &e: r.list_files()) listed[a].push_back(e.name);
+            }
+        } catch (...) {
+            err = "Failed to read the global BNKs.";
+            return false;
+        }
+
+        std::vector<std::string> all;
+        if (!names) {
+            std::unordered_map<std::string, bool> seen;
+            for (const auto &list: listed)
+                for (const auto &n: list)
+                    if (seen.emplace(name_key(n, match), true).second) all.push_back(n);
+            names = &all;
+        }
+
+        plan.archives = archives;
+        plan.jobs.reserve(names->size());
+        for (const auto &name: *names) {
+            std::string key = name_key(name, match);
+            RebuildJob job{name, out_path_for(name), {}, texture};
+            bool ok = true;
+            for (size_t a = 0; a < archives.size() && ok; ++a) {
+                auto it = maps[a].find(key);
+                if (it != maps[a].end()) job.parts.push_back({(int) a, it->second});
+                else if (required[a]) ok = false;
+            }
+            if (ok) plan.jobs.push_back(std::move(job));
+            else plan.missing.push_back(name);
+        }
+        return true;
+    }
+
+    struct Archive {
+        std::unique_ptr<BNKReader> reader;
+        std::mutex mutex;
+    };
+
+    bool append_part(Archive &a, int index, std::vector<uint8_t> &out) {
+        return a.reader && read_and_inflate(*a.reader, a.mutex, (size_t) index, out);
+    }
+
+    // Swaps a rebuilt .tex for the export format picked in the UI, keeping
+    // the .tex when the texture cannot be converted. Tiling is looked up by
+    // entry name; the output file name may carry a folder prefix.
+    void convert_texture(const std::string &tex_name, std::vector<uint8_t> &data, std::filesystem::path &out_path,
+                         TexExportFormat fmt, int encode_threads) {
+        if (fmt == TexExportFormat::Tex) return;
+        bool tiled = texture_is_tiled(tex_name);
+
+        std::vector<uint8_t> image;
+        const char *ext = nullptr;
+        bool ok = false;
+        switch (fmt) {
+            case TexExportFormat::DDS: ok = tex_to_dds(data, image, tiled); ext = ".dds"; break;
+            case TexExportFormat::PNG: ok = texture_to_png(data, image, tiled, encode_threads); ext = ".png"; break;
+            case TexExportFormat::QOI: ok = texture_to_qoi(data, image, tiled); ext = ".qoi"; break;
+            default: break;
+        }
+        if (!ok) return;
+        data.swap(image);
+        out_path.replace_extension(ext);
+    }
+
+    bool write_file(const std::filesystem::path &out_path, const std::vector<uint8_t> &data) {
+        std::error_code ec;
+        std::filesystem::create_directories(out_path.parent_path(), ec);
+        auto tmp = out_path;
+        tmp += ".part";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char *>(data.data()), (std::streamsize) data.size());
+            if (!out) {
+                out.close();
+                std::filesystem::remove(tmp, ec);
+                return false;
+            }
+        }
+        std::filesystem::rename(tmp, out_path, ec);
+        if (ec) {
+            std::filesystem::remove(tmp, ec);
+            return false;
+        }
+        return true;
+    }
+}
+
+bool plan_texture_rebuild(const std::vector<std::string> *names, const RebuildOutPath &out_path_for,
+                          RebuildPlan &plan, std::string &err, RebuildMatch match) {
+    auto p_headers = find_bnk_by_filename("globals_texture_headers.bnk");
+    auto p_mip0 = find_bnk_by_filename("1024mip0_textures.bnk");
+    auto p_rest = find_bnk_by_filename("globals_textures.bnk");
+    if (!p_headers || !p_rest) {
+        err = "Required BNKs not found.";
+        return false;
+    }
+    std::vector<std::string> archives{*p_headers};
+    std::vector<bool> required{true};
+    if (p_mip0) {
+        archives.push_back(*p_mip0);
+        required.push_back(false);
+    }
+    archives.push_back(*p_rest);
+    required.push_back(true);
+    return plan_joined(archives, required, names, out_path_for, true, match, plan, err);
+}
+
+bool plan_model_rebuild(const std::vector<std::string> *names, const RebuildOutPath &out_path_for,
+                        RebuildPlan &plan, std::string &err, RebuildMatch match) {
+    auto p_headers = find_bnk_by_filename("globals_model_headers.bnk");
+    auto p_rest = find_bnk_by_filename("globals_models.bnk");
+    if (!p_headers || !p_rest) {
+        err = "Required BNKs not found.";
+        return false;
+    }
+    return plan_joined({*p_headers, *p_rest}, {true, true}, names, out_path_for, false, match, plan, err);
+}
+
+bool plan_nested_model_rebuild(const std::vector<BNKItemUI> &items, const std::string &nested_bnk,
+                               const RebuildOutPath &out_path_for, RebuildPlan &plan, std::string &err,
+                               RebuildMatch match) {
+    auto p_headers = find_bnk_by_filename("globals_model_headers.bnk");
+    if (!p_headers) {
+        err = "globals_model_headers.bnk not found.";
+        return false;
+    }
+    NameMap headers;
+    try {
+        headers = map_names(BNKReader(*p_headers), match);
+    } catch (...) {
+        err = "Failed to read globals_model_headers.bnk.";
+        return false;
+    }
+
+    plan.archives = {*p_headers, nested_bnk};
+    plan.jobs.reserve(items.size());
+    for (const auto &it: items) {
+        auto h = headers.find(name_key(it.name, match));
+        if (h == headers.end()) {
+            plan.missing.push_back(it.name);
+            continue;
+        }
+        plan.jobs.push_back({it.name, out_path_for(it.name), {{0, h->second}, {1, it.index}}, false});
+    }
+    return true;
+}
+
+RebuildStats run_rebuild(const RebuildPlan &plan, TexExportFormat tex_fmt, int max_threads) {
+    RebuildStats stats;
+    const int total = (int) plan.jobs.size();
+
+    std::vector<std::unique_ptr<Archive>> archives;
+    for (const auto &path: plan.archives) {
+        auto a = std::make_unique<Archive>();
+        try {
+            a->reader = std::make_unique<BNKReader>(path);
+        } catch (...) {
+        }
+        archives.push_back(std::move(a));
+    }
+
+    if (max_threads <= 0) max_threads = (int) std::max(1u, std::thread::hardware_concurrency());
+    // Workers already cover the cores, so a converted texture encodes on
+    // the thread that rebuilt it.
+    const int encode_threads = std::min(max_threads, total) > 1 ? 1 : 0;
+
+    std::atomic<int> done{0}, written{0}, failed{0};
+    progress_update(0, total, "Starting...");
+    parallel_for((size_t) total, [&](size_t k) {
+        if (S.cancel_requested || S.exiting) return;
+        const RebuildJob &job = plan.jobs[k];
+
+        std::vector<uint8_t> data;
+        bool ok = !job.parts.empty();
+        for (const auto &part: job.parts) {
+            if (!ok) break;
+            ok = append_part(*archives[part.archive], part.index, data);
+        }
+        if (ok) {
+            auto out_path = job.out_path;
+            if (job.texture) convert_texture(job.name, data, out_path, tex_fmt, encode_threads);
+            ok = write_file(out_path, data);
+        }
+        if (ok) ++written;
+        else ++failed;
+        progress_update(++done, total, job.name);
+    }, max_threads);
+
+    stats.written = written;
+    stats.failed = failed;
+    stats.cancelled = S.cancel_requested || S.exiting;
+    return stats;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+#include "State.h"
+
+// Bulk texture/model rebuilds. Planning resolves every name to its
+// header/mip0/body entries up front; running assembles each file in memory
+// from readers shared by all workers and writes it out, so nothing goes
+// through temp files.
+
+struct RebuildPart {
+    int archive;
+    int index;
+};
+
+struct RebuildJob {
+    std::string name;
+    std::filesystem::path out_path;
+    std::vector<RebuildPart> parts;
+    bool texture = false;
+};
+
+struct RebuildPlan {
+    std::vector<std::string> archives;
+    std::vector<RebuildJob> jobs;
+    std::vector<std::string> missing;
+};
+
+struct RebuildStats {
+    int written = 0;
+    int failed = 0;
+    bool cancelled = false;
+};
+
+using RebuildOutPath = std::function<std::filesystem::path(const std::string &name)>;
+
+// How names are matched against archive entries: bulk rebuilds join on the
+// case-folded file name, single items on the full normalized path so that
+// same-named files in different folders stay apart.
+enum class RebuildMatch {
+    Filename,
+    Path
+};
+
+// A null `names` plans every file found in the header or body BNK. Names
+// without both a header and a body end up in plan.missing. Returns false
+// with `err` set when the global BNKs are not loaded.
+bool plan_texture_rebuild(const std::vector<std::string> *names, const RebuildOutPath &out_path_for,
+                          RebuildPlan &plan, std::string &err, RebuildMatch match = RebuildMatch::Filename);
+bool plan_model_rebuild(const std::vector<std::string> *names, const RebuildOutPath &out_path_for,
+                        RebuildPlan &plan, std::string &err, RebuildMatch match = RebuildMatch::Filename);
+// Bodies of models in a nested BNK come from that BNK, by item index.
+bool plan_nested_model_rebuild(const std::vector<BNKItemUI> &items, const std::string &nested_bnk,
+                               const RebuildOutPath &out_path_for, RebuildPlan &plan, std::string &err,
+                               RebuildMatch match = RebuildMatch::Filename);
+
+// Runs the plan on a worker pool, reporting through progress_update and
+// stopping early on S.cancel_requested / S.exiting. Textures are converted
+// to `tex_fmt` in memory; one that cannot be converted is written as .tex.
+// Files are written under a temporary name and renamed once complete.
+RebuildStats run_rebuild(const RebuildPlan &plan, TexExportFormat tex_fmt, int max_threads = 0);
@@ -0,0 +1,115 @@
+#include "SearchIndex.h"
+#include "Utils.h"
+#include "TexMetaIndex.h"
+#include "BNKCore.cpp"
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+    using Postings = std::vector<GlobalHit>;
+
+    std::mutex g_index_mutex;
+    std::unordered_map<std::string, std::shared_ptr<const Postings>> g_index;
+    // Bumped on every invalidation so a listing that raced with one is used
+    // for the query in flight but not stored.
+    uint64_t g_index_epoch = 0;
+
+    bool is_header_bnk(const std::string &bnk_path) {
+        return to_lower(std::filesystem::path(bnk_path).filename().string()).find("header") != std::string::npos;
+    }
+
+    void add_posting(Postings &out, const std::string &bnk_path, const std::string &name, int index, uint32_t size) {
+        GlobalHit hit{bnk_path, name, index, size};
+        hit.folded = intern_folded(name);
+        hit.type = classify_asset(name);
+        out.push_back(std::move(hit));
+    }
+
+    std::shared_ptr<const Postings> list_archive(const std::string &bnk_path) {
+        auto out = std::make_shared<Postings>();
+        try {
+            BNKReader reader(bnk_path);
+            const auto &files = reader.list_files();
+            out->reserve(files.size());
+
+            for (size_t i = 0; i < files.size(); ++i) {
+                const std::string &fname = files[i].name;
+                add_posting(*out, bnk_path, fname, (int)i, files[i].uncompressed_size);
+                if (classify_asset(fname) != AssetType::Bnk) continue;
+
+                try {
+                    auto tmpdir = std::filesystem::temp_directory_path() / "f2_global_search_nested";
+                    std::error_code ec;
+                    std::filesystem::create_directories(tmpdir, ec);
+
+                    std::string temp_name = "search_nested_" + std::to_string(std::hash<std::string>{}(bnk_path + fname)) + ".bnk";
+                    auto temp_bnk_path = (tmpdir / temp_name).string();
+                    extract_one(bnk_path, (int)i, temp_bnk_path);
+
+                    BNKReader nested_reader(temp_bnk_path);
+                    const auto &nested_files = nested_reader.list_files();
+
+                    std::filesystem::path nested_parent = std::filesystem::path(fname).parent_path();
+                    std::string prefix = nested_parent.empty() ? "" : nested_parent.string() + "/";
+                    for (size_t j = 0; j < nested_files.size(); ++j)
+                        add_posting(*out, temp_bnk_path, prefix + nested_files[j].name, (int)j, nested_files[j].uncompressed_size);
+                } catch (...) {}
+            }
+        } catch (...) {}
+        return out;
+    }
+}
+
+std::vector<GlobalHit> search_index_query(uint32_t gen, const std::vector<std::string> &bnk_paths, const std::string &term) {
+    std::vector<std::shared_ptr<const Postings>> per_archive(bnk_paths.size());
+    std::vector<size_t> missing;
+    uint64_t epoch;
+    {
+        std::lock_guard<std::mutex> lock(g_index_mutex);
+        epoch = g_index_epoch;
+        for (size_t k = 0; k < bnk_paths.size(); ++k) {
+            if (is_header_bnk(bnk_paths[k])) continue;
+            auto it = g_index.find(bnk_paths[k]);
+            if (it != g_index.end()) per_archive[k] = it->second;
+            else missing.push_back(k);
+        }
+    }
+
+    if (!missing.empty()) {
+        parallel_for(missing.size(), [&](size_t m) {
+            per_archive[missing[m]] = list_archive(bnk_paths[missing[m]]);
+        });
+        std::lock_guard<std::mutex> lock(g_index_mutex);
+        if (epoch == g_index_epoch)
+            for (size_t k : missing) g_index[bnk_paths[k]] = per_archive[k];
+    }
+
+    std::string name_part;
+    TexMetaFilter meta = tex_meta_parse_filter(term, name_part);
+    std::string needle = fold_case(name_part);
+    if (!meta.empty()) tex_meta_wait(gen, bnk_paths);
+    std::vector<GlobalHit> hits;
+    for (const auto &postings : per_archive) {
+        if (!postings) continue;
+        for (const auto &p : *postings) {
+            if (!folded_contains(p.folded.text, needle)) continue;
+            if (!meta.empty() && (p.type != AssetType::Tex || !tex_meta_matches(gen, meta, p.folded.text))) continue;
+            hits.push_back(p);
+        }
+    }
+    return hits;
+}
+
+void search_index_invalidate(const std::vector<std::string> &bnk_paths) {
+    std::lock_guard<std::mutex> lock(g_index_mutex);
+    ++g_index_epoch;
+    for (const auto &p : bnk_paths) g_index.erase(p);
+}
+
+void search_index_reset() {
+    std::lock_guard<std::mutex> lock(g_index_mutex);
+    ++g_index_epoch;
+    g_index.clear();
+}
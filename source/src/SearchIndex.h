@@ -0,0 +1,12 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Operations.h"
+
+// Folded entry names of every archive (nested BNKs included), listed once
+// and kept per archive so a changed archive can be dropped and relisted
+// without touching the rest. Queries list whatever is missing first; `gen`
+// is the catalog generation `bnk_paths` was copied at, for metadata terms.
+std::vector<GlobalHit> search_index_query(uint32_t gen, const std::vector<std::string> &bnk_paths, const std::string &term);
+void search_index_invalidate(const std::vector<std::string> &bnk_paths);
+void search_index_reset();
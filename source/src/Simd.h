@@ -0,0 +1,88 @@
+#pragma once
+
+// x86 SIMD helpers shared by the CPU decoders. SSE2 is the x64 baseline and
+// always available there; AVX2 and F16C kernels are compiled per function and
+// only called after cpu_has_avx2() / cpu_has_f16c() say the CPU and OS
+// support them.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define F2_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#else
+#define F2_SIMD_X86 0
+#endif
+
+#if F2_SIMD_X86 && (defined(__GNUC__) || defined(__clang__))
+#define F2_TARGET_AVX2 __attribute__((target("avx2")))
+#define F2_TARGET_F16C __attribute__((target("avx,f16c")))
+#else
+#define F2_TARGET_AVX2
+#define F2_TARGET_F16C
+#endif
+
+inline bool cpu_has_sse2() {
+#if F2_SIMD_X86
+    return true;
+#else
+    return false;
+#endif
+}
+
+inline bool cpu_has_avx2() {
+#if F2_SIMD_X86 && (defined(__GNUC__) || defined(__clang__))
+    static const bool has = __builtin_cpu_supports("avx2");
+    return has;
+#elif F2_SIMD_X86 && defined(_MSC_VER)
+    static const bool has = []() {
+        int r[4];
+        __cpuid(r, 0);
+        if (r[0] < 7) return false;
+        __cpuid(r, 1);
+        bool osxsave = (r[2] & (1 << 27)) != 0;
+        bool avx = (r[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx) return false;
+        if ((_xgetbv(0) & 0x6) != 0x6) return false;
+        __cpuidex(r, 7, 0);
+        return (r[1] & (1 << 5)) != 0;
+    }();
+    return has;
+#else
+    return false;
+#endif
+}
+
+// F16C is VEX encoded, so besides the CPUID bit the OS has to save YMM state.
+inline bool cpu_has_f16c() {
+#if F2_SIMD_X86
+    static const bool has = []() {
+        unsigned ecx = 0;
+#if defined(_MSC_VER) && !defined(__clang__)
+        int r[4];
+        __cpuid(r, 1);
+        ecx = (unsigned) r[2];
+#else
+        unsigned eax, ebx, edx;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+#endif
+        bool osxsave = (ecx & (1u << 27)) != 0;
+        bool avx = (ecx & (1u << 28)) != 0;
+        bool f16c = (ecx & (1u << 29)) != 0;
+        if (!osxsave || !avx || !f16c) return false;
+#if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long long xcr0 = _xgetbv(0);
+#else
+        unsigned xlo, xhi;
+        __asm__ volatile("xgetbv" : "=a"(xlo), "=d"(xhi) : "c"(0));
+        unsigned long long xcr0 = ((unsigned long long) xhi << 32) | xlo;
+#endif
+        return (xcr0 & 0x6) == 0x6;
+    }();
+    return has;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,236 @@
+#include "TexCache.h"
+#include "BCDecode.h"
+#include "State.h"
+#include "TexParser.h"
+#include "X360Tiling.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+    // Misses that did not resolve still cost their key and list node.
+    constexpr size_t ENTRY_OVERHEAD = 96;
+
+    template<class V>
+    class Lru {
+    public:
+        explicit Lru(size_t budget) : _budget(budget) {}
+
+        bool get(const std::string &key, std::shared_ptr<const V> &out) {
+            auto it = _map.find(key);
+            if (it == _map.end()) return false;
+            _order.splice(_order.begin(), _order, it->second);
+            out = it->second->value;
+            return true;
+        }
+
+        void put(const std::string &key, std::shared_ptr<const V> value, size_t bytes) {
+            erase(key);
+            bytes += key.size() + ENTRY_OVERHEAD;
+            _order.push_front(Node{key, std::move(value), bytes});
+            _map[key] = _order.begin();
+            _bytes += bytes;
+            // The newest entry stays even when it alone is over budget.
+            while (_bytes > _budget && _order.size() > 1) {
+                _bytes -= _order.back().bytes;
+                _map.erase(_order.back().key);
+                _order.pop_back();
+            }
+        }
+
+        void erase(const std::string &key) {
+            auto it = _map.find(key);
+            if (it == _map.end()) return;
+            _bytes -= it->second->bytes;
+            _order.erase(it->second);
+            _map.erase(it);
+        }
+
+        void clear() {
+            _order.clear();
+            _map.clear();
+            _bytes = 0;
+        }
+
+        size_t bytes() const { return _bytes; }
+        size_t count() const { return _order.size(); }
+
+    private:
+        struct Node {
+            std::string key;
+            std::shared_ptr<const V> value;
+            size_t bytes;
+        };
+        std::list<Node> _order;
+        std::unordered_map<std::string, typename std::list<Node>::iterator> _map;
+        size_t _bytes = 0;
+        size_t _budget;
+    };
+
+    using Blob = std::vector<unsigned char>;
+
+    std::mutex g_mutex;
+    Lru<Blob> g_blobs(TEX_CACHE_BLOB_BYTES);
+    Lru<TexImage> g_images(TEX_CACHE_IMAGE_BYTES);
+    TexCacheStats g_stats;
+    uint32_t g_gen = 0;
+
+    std::string cache_key(const std::string &tex_name) {
+        std::string s = std::filesystem::path(tex_name).filename().string();
+        std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return (char) std::tolower(c); });
+        return s;
+    }
+
+    // Caller holds g_mutex.
+    void sync_catalog() {
+        uint32_t gen = S.catalog_gen;
+        if (g_gen == gen) return;
+        g_blobs.clear();
+        g_images.clear();
+        g_gen = gen;
+    }
+
+    bool alpha_below_255(const std::vector<uint8_t> &rgba) {
+        for (size_t i = 3; i < rgba.size(); i += 4)
+            if (rgba[i] < 255) return true;
+        return false;
+    }
+}
+
+bool tex_decode_largest_mip(const std::vector<unsigned char> &tex_buf, bool tiled, std::vector<uint8_t> &rgba,
+                            int &out_w, int &out_h) {
+    TexInfo tex_info;
+    if (!parse_tex_info(tex_buf, tex_info) || tex_info.Mips.empty()) return false;
+
+    size_t best = 0;
+    size_t best_area = 0;
+    for (size_t i = 0; i < tex_info.Mips.size(); ++i) {
+        if (tex_info.Mips[i].CompFlag != 7) continue;
+        int w = tex_info.Mips[i].HasWH ? (int) tex_info.Mips[i].MipWidth : std::max(1, (int) tex_info.TextureWidth >> (int) i);
+        int h = tex_info.Mips[i].HasWH ? (int) tex_info.Mips[i].MipHeight : std::max(1, (int) tex_info.TextureHeight >> (int) i);
+        size_t area = (size_t) w * (size_t) h;
+        if (area > best_area) {
+            best_area = area;
+            best = i;
+        }
+    }
+
+    const auto &mip = tex_info.Mips[best];
+    int w = mip.HasWH ? (int) mip.MipWidth : std::max(1, (int) tex_info.TextureWidth >> (int) best);
+    int h = mip.HasWH ? (int) mip.MipHeight : std::max(1, (int) tex_info.TextureHeight >> (int) best);
+
+    if (mip.MipDataOffset + mip.MipDataSizeParsed > tex_buf.size()) return false;
+
+    BCFormat fmt = bc_format_from_pixel_format(tex_info.PixelFormat);
+    if (fmt == BCFormat::None) return false;
+
+    rgba.assign((size_t) w * (size_t) h * 4, 0xFF);
+    const uint8_t *src = tex_buf.data() + mip.MipDataOffset;
+    size_t src_size = mip.MipDataSizeParsed;
+    std::vector<uint8_t> linear;
+    if (tiled) {
+        if (!x360_untile_bc(fmt, src, src_size, w, h, linear)) return false;
+        src = linear.data();
+        src_size = linear.size();
+    }
+    if (!bc_decode(fmt, src, src_size, w, h, rgba.data())) return false;
+    out_w = w;
+    out_h = h;
+    return true;
+}
+
+TexBlobPtr tex_cache_blob(const std::string &tex_name) {
+    std::string key = cache_key(tex_name);
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        sync_catalog();
+        TexBlobPtr hit;
+        if (g_blobs.get(key, hit)) {
+            ++g_stats.blob_hits;
+            return hit;
+        }
+        ++g_stats.blob_misses;
+    }
+
+    // Assembled outside the lock; a racing miss on the same name just
+    // builds it twice and the later put wins.
+    auto blob = std::make_shared<Blob>();
+    bool ok = false;
+    try {
+        ok = build_any_tex_buffer_for_name(tex_name, *blob);
+    } catch (...) {}
+    TexBlobPtr result = ok ? TexBlobPtr(std::move(blob)) : TexBlobPtr();
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    sync_catalog();
+    g_blobs.put(key, result, result ? result->size() : 0);
+    return result;
+}
+
+TexBlobPtr tex_cache_peek_blob(const std::string &tex_name) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    sync_catalog();
+    TexBlobPtr hit;
+    g_blobs.get(cache_key(tex_name), hit);
+    return hit;
+}
+
+void tex_cache_put_blob(const std::string &tex_name, std::vector<unsigned char> blob) {
+    if (blob.empty()) return;
+    size_t bytes = blob.size();
+    auto value = std::make_shared<const Blob>(std::move(blob));
+    std::lock_guard<std::mutex> lock(g_mutex);
+    sync_catalog();
+    g_blobs.put(cache_key(tex_name), std::move(value), bytes);
+}
+
+TexImagePtr tex_cache_image(const std::string &tex_name, bool tiled) {
+    std::string key = cache_key(tex_name) + (tiled ? "|tiled" : "");
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        sync_catalog();
+        TexImagePtr hit;
+        if (g_images.get(key, hit)) {
+            ++g_stats.image_hits;
+            return hit;
+        }
+        ++g_stats.image_misses;
+    }
+
+    TexImagePtr result;
+    if (TexBlobPtr blob = tex_cache_blob(tex_name)) {
+        auto img = std::make_shared<TexImage>();
+        TexInfo ti;
+        try {
+            if (parse_tex_info(*blob, ti) && tex_decode_largest_mip(*blob, tiled, img->rgba, img->width, img->height)) {
+                img->pixel_format = ti.PixelFormat;
+                img->has_alpha = alpha_below_255(img->rgba);
+                result = std::move(img);
+            }
+        } catch (...) {}
+    }
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    sync_catalog();
+    g_images.put(key, result, result ? result->rgba.size() : 0);
+    return result;
+}
+
+TexCacheStats tex_cache_stats() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    TexCacheStats s = g_stats;
+    s.blob_bytes = g_blobs.bytes();
+    s.blob_count = g_blobs.count();
+    s.image_bytes = g_images.bytes();
+    s.image_count = g_images.count();
+    return s;
+}
+
+void tex_cache_clear() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_blobs.clear();
+    g_images.clear();
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Process-wide LRU of assembled texture blobs (header + mip0 + body, as
+// build_any_tex_buffer_for_name returns them) and of their decoded largest
+// mips, shared by the model preview, GLB export, texture preview and
+// thumbnails. Keyed by lowercase base name, the key the resolver joins on;
+// each pool is bounded in bytes and dropped when S.catalog_gen changes.
+// Names that do not resolve are remembered too, so fallbacks stay cheap.
+
+constexpr size_t TEX_CACHE_BLOB_BYTES = 192ull << 20;
+constexpr size_t TEX_CACHE_IMAGE_BYTES = 256ull << 20;
+
+using TexBlobPtr = std::shared_ptr<const std::vector<unsigned char>>;
+
+struct TexImage {
+    int width = 0;
+    int height = 0;
+    uint32_t pixel_format = 0;
+    bool has_alpha = false;  // any decoded alpha below 255
+    std::vector<uint8_t> rgba;
+};
+using TexImagePtr = std::shared_ptr<const TexImage>;
+
+struct TexCacheStats {
+    uint64_t blob_hits = 0, blob_misses = 0;
+    uint64_t image_hits = 0, image_misses = 0;
+    size_t blob_bytes = 0, image_bytes = 0;
+    size_t blob_count = 0, image_count = 0;
+};
+
+// Assembles on a miss; null when the name does not resolve.
+TexBlobPtr tex_cache_blob(const std::string &tex_name);
+// Cached blob only, never assembles (and counts neither hit nor miss).
+TexBlobPtr tex_cache_peek_blob(const std::string &tex_name);
+// Adds a blob assembled elsewhere, e.g. the final stage of a progressive load.
+void tex_cache_put_blob(const std::string &tex_name, std::vector<unsigned char> blob);
+// Largest raw mip decoded to RGBA (BC1/BC3/BC5; X360 tiling per `tiled`).
+// Null when the texture is missing or not block compressed.
+TexImagePtr tex_cache_image(const std::string &tex_name, bool tiled);
+
+TexCacheStats tex_cache_stats();
+void tex_cache_clear();
+
+// The decode behind tex_cache_image, for buffers that are not in the catalog.
+bool tex_decode_largest_mip(const std::vector<unsigned char> &tex_buf, bool tiled, std::vector<uint8_t> &rgba,
+                            int &w, int &h);
@@ -0,0 +1,315 @@
+#include "TexMetaIndex.h"
+#include "TexParser.h"
+#include "Utils.h"
+#include "Names.h"
+#include "BNKCore.cpp"
+#include <future>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+    // One row per texture. mip_begin has rows + 1 entries indexing mip_bytes.
+    struct Columns {
+        std::vector<uint16_t> width, height, pixel_format;
+        std::vector<uint32_t> mip_begin{0};
+        std::vector<uint32_t> mip_bytes;
+        // Keys view key_text, so lookups take a string_view and never allocate.
+        std::string key_text;
+        std::unordered_map<std::string_view, uint32_t> rows;
+    };
+
+    using ColumnsPtr = std::shared_ptr<const Columns>;
+    using SizeMap = std::unordered_map<std::string, uint64_t>;
+
+    std::string_view base_name(std::string_view name) {
+        size_t slash = name.find_last_of("/\\");
+        return slash == std::string_view::npos ? name : name.substr(slash + 1);
+    }
+
+    std::string base_key(const std::string &name) {
+        return fold_case(base_name(name));
+    }
+
+    void add_sizes(const std::string &bnk_path, SizeMap &sizes) {
+        try {
+            BNKReader r(bnk_path);
+            for (const auto &e: r.list_files()) sizes.emplace(base_key(e.name), e.uncompressed_size);
+        } catch (...) {}
+    }
+
+    struct HeaderSource {
+        std::unique_ptr<BNKReader> reader;
+        std::mutex mutex;
+    };
+
+    struct ParsedHeader {
+        bool ok = false;
+        std::string key;
+        uint32_t width = 0, height = 0, pixel_format = 0;
+        std::vector<uint32_t> mip_bytes;
+    };
+
+    // Mip definitions sit at the header's offsets into header + mip0 + body;
+    // each one runs up to the next, the last to the end of the file.
+    std::vector<uint32_t> mip_spans(const std::vector<uint32_t> &offsets, uint64_t total) {
+        std::vector<uint32_t> spans(offsets.size(), 0);
+        for (size_t i = 0; i < offsets.size(); ++i) {
+            uint64_t end = total;
+            for (uint32_t o: offsets)
+                if (o > offsets[i] && o < end) end = o;
+            if (end > offsets[i]) spans[i] = (uint32_t) std::min<uint64_t>(end - offsets[i], UINT32_MAX);
+        }
+        return spans;
+    }
+
+    ColumnsPtr build(const std::vector<std::string> &bnk_paths) {
+        std::vector<std::string> header_paths;
+        SizeMap mip0_sizes, body_sizes;
+        for (const auto &path: bnk_paths) {
+            std::string fname = base_key(path);
+            if (fname.find("texture") == std::string::npos) continue;
+            if (fname.find("header") != std::string::npos) header_paths.push_back(path);
+            else if (fname.find("1024mip0") != std::string::npos) add_sizes(path, mip0_sizes);
+            else add_sizes(path, body_sizes);
+        }
+
+        std::vector<std::unique_ptr<HeaderSource>> sources;
+        std::vector<std::pair<int, int>> work;
+        for (const auto &path: header_paths) {
+            auto src = std::make_unique<HeaderSource>();
+            try {
+                src->reader = std::make_unique<BNKReader>(path);
+            } catch (...) {
+                continue;
+            }
+            for (size_t i = 0; i < src->reader->list_files().size(); ++i) work.push_back({(int) sources.size(), (int) i});
+            sources.push_back(std::move(src));
+        }
+
+        // Reads share one handle per archive; inflating and parsing do not.
+        std::vector<ParsedHeader> parsed(work.size());
+        parallel_for(work.size(), [&](size_t k) {
+            HeaderSource &src = *sources[work[k].first];
+            size_t index = (size_t) work[k].second;
+            ParsedHeader &p = parsed[k];
+            try {
+                std::vector<uint8_t> buf;
+                if (!read_and_inflate(*src.reader, src.mutex, index, buf)) return;
+
+                TexInfo ti;
+                if (!parse_tex_info(buf, ti)) return;
+                p.key = base_key(src.reader->list_files()[index].name);
+                uint64_t total = buf.size();
+                auto m = mip0_sizes.find(p.key);
+                if (m != mip0_sizes.end()) total += m->second;
+                auto b = body_sizes.find(p.key);
+                if (b != body_sizes.end()) total += b->second;
+
+                p.width = ti.TextureWidth;
+                p.height = ti.TextureHeight;
+                p.pixel_format = ti.PixelFormat;
+                p.mip_bytes = mip_spans(ti.MipMapOffset, total);
+                p.ok = true;
+            } catch (...) {}
+        }, (int) std::max(1u, std::thread::hardware_concurrency()));
+
+        auto cols = std::make_shared<Columns>();
+        std::vector<const std::string *> keys;
+        std::unordered_map<std::string_view, uint32_t> seen;
+        seen.reserve(parsed.size() * 2 + 1);
+        size_t key_bytes = 0;
+        for (auto &p: parsed) {
+            if (!p.ok || !seen.emplace(p.key, (uint32_t) cols->width.size()).second) continue;
+            keys.push_back(&p.key);
+            key_bytes += p.key.size();
+            cols->width.push_back((uint16_t) std::min<uint32_t>(p.width, UINT16_MAX));
+            cols->height.push_back((uint16_t) std::min<uint32_t>(p.height, UINT16_MAX));
+            cols->pixel_format.push_back((uint16_t) std::min<uint32_t>(p.pixel_format, UINT16_MAX));
+            cols->mip_bytes.insert(cols->mip_bytes.end(), p.mip_bytes.begin(), p.mip_bytes.end());
+            cols->mip_begin.push_back((uint32_t) cols->mip_bytes.size());
+        }
+
+        // Reserved up front, so the views taken while appending stay valid.
+        cols->key_text.reserve(key_bytes);
+        cols->rows.reserve(keys.size() * 2 + 1);
+        for (size_t row = 0; row < keys.size(); ++row) {
+            size_t at = cols->key_text.size();
+            cols->key_text += *keys[row];
+            cols->rows.emplace(std::string_view(cols->key_text).substr(at, keys[row]->size()), (uint32_t) row);
+        }
+        return cols;
+    }
+
+    std::mutex g_mutex;
+    // Last finished index and the catalog generation it was built for.
+    ColumnsPtr g_index;
+    uint32_t g_index_gen = 0;
+    // Build in flight (or last started), if any.
+    std::shared_future<ColumnsPtr> g_pending;
+    uint32_t g_pending_gen = 0;
+
+    // Caller holds g_mutex. A job still holding an older generation than the
+    // newest requested one gets nothing rather than restarting its build.
+    std::shared_future<ColumnsPtr> request_locked(uint32_t gen, const std::vector<std::string> &bnk_paths) {
+        if (g_pending.valid() && (gen == g_pending_gen || (int32_t) (gen - g_pending_gen) < 0)) return g_pending;
+
+        auto promise = std::make_shared<std::promise<ColumnsPtr>>();
+        g_pending = promise->get_future().share();
+        g_pending_gen = gen;
+        std::thread([promise, paths = bnk_paths, gen]() {
+            ColumnsPtr cols;
+            try {
+                cols = build(paths);
+            } catch (...) {
+                cols = std::make_shared<Columns>();
+            }
+            {
+                std::lock_guard<std::mutex> lock(g_mutex);
+                if (g_pending_gen == gen) {
+                    g_index = cols;
+                    g_index_gen = gen;
+                }
+            }
+            promise->set_value(cols);
+        }).detach();
+        return g_pending;
+    }
+
+    ColumnsPtr index_for(uint32_t gen) {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        return g_index && g_index_gen == gen ? g_index : nullptr;
+    }
+
+    bool lookup_row(const Columns &cols, std::string_view folded_name, uint32_t &row) {
+        auto it = cols.rows.find(base_name(folded_name));
+        if (it == cols.rows.end()) return false;
+        row = it->second;
+        return true;
+    }
+
+    // Up to nine digits always fit in 32 bits; longer input is not a term.
+    bool parse_number(const std::string &v, uint32_t &out) {
+        if (v.empty() || v.size() > 9 || v.find_first_not_of("0123456789") != std::string::npos) return false;
+        out = 0;
+        for (char c: v) out = out * 10 + (uint32_t) (c - '0');
+        return true;
+    }
+
+    bool parse_format(const std::string &v, uint32_t &out) {
+        if (v == "bc1" || v == "dxt1") out = 35;
+        else if (v == "bc3" || v == "dxt5") out = 39;
+        else if (v == "bc5" || v == "ati2") out = 40;
+        else return parse_number(v, out);
+        return true;
+    }
+
+    bool parse_term(const std::string &token, TexMetaFilter::Term &term) {
+        std::string t = to_lower(token);
+        if (t.rfind("fmt:", 0) == 0) {
+            term.field = TexMetaFilter::Field::Format;
+            term.op = TexMetaFilter::Op::Eq;
+            return parse_format(t.substr(4), term.value);
+        }
+
+        size_t op_at = t.find_first_of("<>=");
+        if (op_at == std::string::npos || op_at == 0) return false;
+        std::string field = t.substr(0, op_at);
+        if (field == "w" || field == "width") term.field = TexMetaFilter::Field::Width;
+        else if (field == "h" || field == "height") term.field = TexMetaFilter::Field::Height;
+        else if (field == "size") term.field = TexMetaFilter::Field::Size;
+        else if (field == "mips") term.field = TexMetaFilter::Field::Mips;
+        else return false;
+
+        std::string rest = t.substr(op_at);
+        size_t skip = 1;
+        if (rest.rfind(">=", 0) == 0) { term.op = TexMetaFilter::Op::Ge; skip = 2; }
+        else if (rest.rfind("<=", 0) == 0) { term.op = TexMetaFilter::Op::Le; skip = 2; }
+        else if (rest[0] == '>') term.op = TexMetaFilter::Op::Gt;
+        else if (rest[0] == '<') term.op = TexMetaFilter::Op::Lt;
+        else term.op = TexMetaFilter::Op::Eq;
+
+        return parse_number(rest.substr(skip), term.value);
+    }
+
+    bool compare(uint32_t v, TexMetaFilter::Op op, uint32_t ref) {
+        switch (op) {
+            case TexMetaFilter::Op::Lt: return v < ref;
+            case TexMetaFilter::Op::Le: return v <= ref;
+            case TexMetaFilter::Op::Gt: return v > ref;
+            case TexMetaFilter::Op::Ge: return v >= ref;
+            default: return v == ref;
+        }
+    }
+}
+
+TexMetaFilter tex_meta_parse_filter(const std::string &filter, std::string &rest) {
+    TexMetaFilter out;
+    rest.clear();
+    std::istringstream words(filter);
+    std::string word;
+    while (words >> word) {
+        TexMetaFilter::Term term{};
+        if (parse_term(word, term)) {
+            out.terms.push_back(term);
+        } else {
+            if (!rest.empty()) rest += ' ';
+            rest += word;
+        }
+    }
+    // Without metadata terms the filter is matched as typed, spaces and all.
+    if (out.empty()) rest = filter;
+    return out;
+}
+
+void tex_meta_request(uint32_t gen, const std::vector<std::string> &bnk_paths) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (!(g_index && g_index_gen == gen)) request_locked(gen, bnk_paths);
+}
+
+void tex_meta_wait(uint32_t gen, const std::vector<std::string> &bnk_paths) {
+    std::shared_future<ColumnsPtr> pending;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        if (g_index && g_index_gen == gen) return;
+        pending = request_locked(gen, bnk_paths);
+    }
+    pending.wait();
+}
+
+bool tex_meta_lookup(uint32_t gen, std::string_view folded_name, TexMeta &out) {
+    ColumnsPtr cols = index_for(gen);
+    uint32_t row;
+    if (!cols || !lookup_row(*cols, folded_name, row)) return false;
+    out.width = cols->width[row];
+    out.height = cols->height[row];
+    out.pixel_format = cols->pixel_format[row];
+    out.mip_bytes.assign(cols->mip_bytes.begin() + cols->mip_begin[row],
+                         cols->mip_bytes.begin() + cols->mip_begin[row + 1]);
+    return true;
+}
+
+bool tex_meta_matches(uint32_t gen, const TexMetaFilter &filter, std::string_view folded_name) {
+    if (filter.empty()) return true;
+    ColumnsPtr cols = index_for(gen);
+    uint32_t row;
+    if (!cols || !lookup_row(*cols, folded_name, row)) return false;
+    for (const auto &t: filter.terms) {
+        uint32_t v = 0;
+        switch (t.field) {
+            case TexMetaFilter::Field::Format: v = cols->pixel_format[row]; break;
+            case TexMetaFilter::Field::Width: v = cols->width[row]; break;
+            case TexMetaFilter::Field::Height: v = cols->height[row]; break;
+            case TexMetaFilter::Field::Size: v = std::max(cols->width[row], cols->height[row]); break;
+            case TexMetaFilter::Field::Mips: v = cols->mip_begin[row + 1] - cols->mip_begin[row]; break;
+        }
+        if (!compare(v, t.op, t.value)) return false;
+    }
+    return true;
+}
+
+bool tex_meta_index_ready(uint32_t gen) {
+    return index_for(gen) != nullptr;
+}
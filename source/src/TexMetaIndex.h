@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Size, pixel format and mip layout of every texture, parsed in the
+// background from the *texture*header* BNKs alone and stored column by
+// column. Rows are keyed by folded base name, the key the rebuild joins
+// header, mip0 and body on. One index per catalog generation; callers pass
+// the generation and archive list they hold, so the index never reads S.
+
+struct TexMeta {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t pixel_format = 0;
+    // Bytes from each mip definition to the next (the last runs to the end
+    // of header + mip0 + body, sized from the archive directories).
+    std::vector<uint32_t> mip_bytes;
+};
+
+// Metadata terms of a file filter, e.g. "fmt:bc3 size>=1024 mips>1".
+// Fields: fmt (bc1/bc3/bc5 or the raw PixelFormat), w, h, size (the larger
+// side) and mips; operators = < <= > >=.
+struct TexMetaFilter {
+    enum class Field : uint8_t { Format, Width, Height, Size, Mips };
+    enum class Op : uint8_t { Eq, Lt, Le, Gt, Ge };
+    struct Term {
+        Field field;
+        Op op;
+        uint32_t value;
+    };
+    std::vector<Term> terms;
+
+    bool empty() const { return terms.empty(); }
+};
+
+// Splits the metadata terms out of `filter`; the remaining words, joined by
+// single spaces, go to `rest` for the usual name match.
+TexMetaFilter tex_meta_parse_filter(const std::string &filter, std::string &rest);
+
+// Starts building the index for catalog `gen` over `bnk_paths` unless it is
+// built or in flight. The UI passes S.catalog_gen and S.bnk_paths; background
+// jobs pass the snapshot they were started with.
+void tex_meta_request(uint32_t gen, const std::vector<std::string> &bnk_paths);
+// Blocks until the index for `gen` is built, starting it if needed.
+void tex_meta_wait(uint32_t gen, const std::vector<std::string> &bnk_paths);
+
+// Answer from the last finished index, and only if it was built for `gen`;
+// no match otherwise, so the UI never blocks. `folded_name` is a folded
+// entry name (e.g. BNKItemUI::folded.text); only its base name is used.
+bool tex_meta_lookup(uint32_t gen, std::string_view folded_name, TexMeta &out);
+bool tex_meta_matches(uint32_t gen, const TexMetaFilter &filter, std::string_view folded_name);
+bool tex_meta_index_ready(uint32_t gen);
@@ -7,6 +7,8 @@
 #include <optional>
 #include <unordered_map>
 #include <algorithm>
+#include <memory>
+#include <mutex>
 
 bool parse_tex_info(const std::vector<unsigned char> &d, TexInfo &out) {
     out = TexInfo{};
@@ -136,345 +138,240 @@ bool parse_tex_info(const std::vector<unsigned char> &d, TexInfo &out) {
     return true;
 }
 
-bool build_tex_buffer_for_name(const std::string &tex_name, std::vector<unsigned char> &out) {
-    auto p_headers = find_bnk_by_filename("globals_texture_headers.bnk");
-    auto p_rest = find_bnk_by_filename("globals_textures.bnk");
-    if (!p_headers || !p_rest) return false;
-
-    BNKReader r_headers(*p_headers);
-    BNKReader r_rest(*p_rest);
-
-    auto p_mip0 = find_bnk_by_filename("1024mip0_textures.bnk");
-    std::optional<BNKReader> r_mip0;
-    if (p_mip0) r_mip0.emplace(*p_mip0);
-
-    std::unordered_map<std::string, int> mapH, mapR, mapM;
-    for (size_t i = 0; i < r_headers.list_files().size(); ++i) {
-        auto &e = r_headers.list_files()[i];
-        std::string fname = std::filesystem::path(e.name).filename().string();
-        std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-        mapH.emplace(fname, (int) i);
-    }
-    for (size_t i = 0; i < r_rest.list_files().size(); ++i) {
-        auto &e = r_rest.list_files()[i];
-        std::string fname = std::filesystem::path(e.name).filename().string();
-        std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-        mapR.emplace(fname, (int) i);
+namespace {
+    struct TexArchive {
+        std::string path;
+        std::unique_ptr<BNKReader> reader;
+        std::mutex mutex;
+    };
+
+    struct TexPart {
+        int archive = -1;
+        int index = -1;
+    };
+
+    using TexMap = std::unordered_map<std::string, TexPart>;
+
+    // Every texture archive of one root, opened once, with name maps for the
+    // three lookups below. Replaced as a whole when the catalog changes;
+    // callers holding the old one finish with it first.
+    struct TexResolver {
+        std::vector<std::unique_ptr<TexArchive>> archives;
+        std::unordered_map<std::string, int> archive_ids;
+        // globals_texture_headers / 1024mip0_textures / globals_textures, by base name.
+        TexMap headers, mip0, bodies;
+        // gui_texture_headers / gui_textures, by full entry name.
+        TexMap gui_headers, gui_bodies;
+        // Any *texture*header* / *1024mip0*texture* / other *texture* archive, by base name.
+        TexMap any_headers, any_mip0, any_bodies;
+    };
+
+    std::string lower_base_name(const std::string &name) {
+        return to_lower(std::filesystem::path(name).filename().string());
     }
-    if (r_mip0) {
-        for (size_t i = 0; i < r_mip0->list_files().size(); ++i) {
-            auto &e = r_mip0->list_files()[i];
-            std::string fname = std::filesystem::path(e.name).filename().string();
-            std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-            mapM.emplace(fname, (int) i);
-        }
-    }
-
-    std::string key = std::filesystem::path(tex_name).filename().string();
-    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
-
-    if (!mapH.count(key)) return false;
-
-    auto tmpdir = std::filesystem::temp_directory_path() / "f2_tex_hex";
-    std::error_code ec;
-    std::filesystem::create_directories(tmpdir, ec);
-
-    auto tmp_h = tmpdir / ("h_" + std::to_string(std::hash<std::string>{}(tex_name)) + ".bin");
-    auto tmp_m = tmpdir / ("m_" + std::to_string(std::hash<std::string>{}(tex_name)) + ".bin");
-    auto tmp_r = tmpdir / ("r_" + std::to_string(std::hash<std::string>{}(tex_name)) + ".bin");
-
-    try {
-        extract_one(*p_headers, mapH.at(key), tmp_h.string());
 
-        bool has_mip0 = false;
-        if (mapM.count(key) && p_mip0) {
-            extract_one(*p_mip0, mapM.at(key), tmp_m.string());
-            has_mip0 = std::filesystem::exists(tmp_m);
-        }
+    int open_archive(TexResolver &r, const std::string &path) {
+        auto it = r.archive_ids.find(path);
+        if (it != r.archive_ids.end()) return it->second;
+        int id = -1;
+        try {
+            auto a = std::make_unique<TexArchive>();
+            a->path = path;
+            a->reader = std::make_unique<BNKReader>(path);
+            id = (int) r.archives.size();
+            r.archives.push_back(std::move(a));
+        } catch (...) {}
+        r.archive_ids.emplace(path, id);
+        return id;
+    }
 
-        bool has_rest = false;
-        if (mapR.count(key)) {
-            extract_one(*p_rest, mapR.at(key), tmp_r.string());
-            has_rest = std::filesystem::exists(tmp_r);
-        }
+    // First archive and first entry win, as the old linear searches did.
+    void map_archive(TexResolver &r, const std::string &path, TexMap &map, bool by_base_name) {
+        int id = open_archive(r, path);
+        if (id < 0) return;
+        const auto &files = r.archives[id]->reader->list_files();
+        map.reserve(map.size() + files.size());
+        for (size_t i = 0; i < files.size(); ++i)
+            map.emplace(by_base_name ? lower_base_name(files[i].name) : to_lower(files[i].name), TexPart{id, (int) i});
+    }
 
-        auto vh = read_all_bytes(tmp_h);
-        if (vh.empty()) {
-            std::filesystem::remove(tmp_h, ec);
-            return false;
-        }
+    std::shared_ptr<TexResolver> build_resolver() {
+        auto r = std::make_shared<TexResolver>();
 
-        std::vector<unsigned char> vm;
-        if (has_mip0) {
-            vm = read_all_bytes(tmp_m);
+        auto p_headers = find_bnk_by_filename("globals_texture_headers.bnk");
+        auto p_rest = find_bnk_by_filename("globals_textures.bnk");
+        auto p_mip0 = find_bnk_by_filename("1024mip0_textures.bnk");
+        if (p_headers && p_rest) {
+            map_archive(*r, *p_headers, r->headers, true);
+            map_archive(*r, *p_rest, r->bodies, true);
+            if (p_mip0) map_archive(*r, *p_mip0, r->mip0, true);
         }
 
-        std::vector<unsigned char> vr;
-        if (has_rest) {
-            vr = read_all_bytes(tmp_r);
+        for (const auto &path: S.bnk_paths) {
+            std::string fname = lower_base_name(path);
+            if (fname == "gui_texture_headers.bnk") map_archive(*r, path, r->gui_headers, false);
+            else if (fname == "gui_textures.bnk") map_archive(*r, path, r->gui_bodies, false);
+
+            if (fname.find("texture") == std::string::npos) continue;
+            bool is_header = fname.find("header") != std::string::npos;
+            bool is_mip0 = fname.find("1024mip0") != std::string::npos;
+            if (is_header) map_archive(*r, path, r->any_headers, true);
+            else if (is_mip0) map_archive(*r, path, r->any_mip0, true);
+            else map_archive(*r, path, r->any_bodies, true);
         }
-
-        out.clear();
-        out.reserve(vh.size() + vm.size() + vr.size());
-        out.insert(out.end(), vh.begin(), vh.end());
-        out.insert(out.end(), vm.begin(), vm.end());
-        out.insert(out.end(), vr.begin(), vr.end());
-
-        std::filesystem::remove(tmp_h, ec);
-        if (has_mip0) std::filesystem::remove(tmp_m, ec);
-        if (has_rest) std::filesystem::remove(tmp_r, ec);
-
-        return !out.empty();
-    } catch (...) {
-        std::filesystem::remove(tmp_h, ec);
-        std::filesystem::remove(tmp_m, ec);
-        std::filesystem::remove(tmp_r, ec);
-        return false;
+        return r;
     }
-}
 
-bool build_gui_tex_buffer_for_name(const std::string &tex_name, std::vector<unsigned char> &out) {
-    std::vector<std::string> all_headers, all_bodies;
-    for (const auto& path : S.bnk_paths) {
-        std::string fname = std::filesystem::path(path).filename().string();
-        std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-        if (fname == "gui_texture_headers.bnk") {
-            all_headers.push_back(path);
-        } else if (fname == "gui_textures.bnk") {
-            all_bodies.push_back(path);
+    std::shared_ptr<TexResolver> current_resolver() {
+        static std::mutex mutex;
+        static std::shared_ptr<TexResolver> resolver;
+        static uint32_t built_gen = 0;
+
+        // Only the atomic generation is read here; workers call this too.
+        uint32_t gen = S.catalog_gen;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!resolver || built_gen != gen) {
+            resolver = build_resolver();
+            built_gen = gen;
         }
+        return resolver;
     }
 
-    if (all_headers.empty() || all_bodies.empty()) {
-        return false;
+    const TexPart *lookup(const TexMap &map, const std::string &key) {
+        auto it = map.find(key);
+        return it == map.end() ? nullptr : &it->second;
     }
 
-    std::string key = tex_name;
-    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
-
-    int header_idx = -1;
-    std::string found_header_bnk;
-    for (const auto& header_path : all_headers) {
-        BNKReader r_headers(header_path);
-        for (size_t i = 0; i < r_headers.list_files().size(); ++i) {
-            auto &e = r_headers.list_files()[i];
-            std::string fname_lower = e.name;
-            std::transform(fname_lower.begin(), fname_lower.end(), fname_lower.begin(), ::tolower);
-            if (fname_lower == key) {
-                header_idx = (int)i;
-                found_header_bnk = header_path;
-                break;
-            }
-        }
-        if (header_idx != -1) break;
+    // Appends the part to out; false if it is missing or cannot be read.
+    bool append_part(TexResolver &r, const TexPart *part, std::vector<unsigned char> &out) {
+        if (!part) return false;
+        TexArchive &a = *r.archives[part->archive];
+        size_t before = out.size();
+        return a.reader && read_and_inflate(*a.reader, a.mutex, (size_t) part->index, out) && out.size() > before;
     }
 
-    int body_idx = -1;
-    std::string found_body_bnk;
-    for (const auto& body_path : all_bodies) {
-        BNKReader r_rest(body_path);
-        for (size_t i = 0; i < r_rest.list_files().size(); ++i) {
-            auto &e = r_rest.list_files()[i];
-            std::string fname_lower = e.name;
-            std::transform(fname_lower.begin(), fname_lower.end(), fname_lower.begin(), ::tolower);
-            if (fname_lower == key) {
-                body_idx = (int)i;
-                found_body_bnk = body_path;
-                break;
-            }
-        }
-        if (body_idx != -1) break;
-    }
-
-    if (header_idx == -1 || body_idx == -1) {
-        return false;
+    // A part missing from the maps is skipped; one that is listed but cannot
+    // be read fails the build, as the extract-based path did.
+    bool append_optional(TexResolver &r, const TexPart *part, std::vector<unsigned char> &out) {
+        if (!part) return true;
+        TexArchive &a = *r.archives[part->archive];
+        return a.reader && read_and_inflate(*a.reader, a.mutex, (size_t) part->index, out);
     }
+}
 
-    auto tmpdir = std::filesystem::temp_directory_path() / "f2_tex_hex";
-    std::error_code ec;
-    std::filesystem::create_directories(tmpdir, ec);
+bool build_tex_buffer_for_name(const std::string &tex_name, std::vector<unsigned char> &out) {
+    auto r = current_resolver();
+    std::string key = lower_base_name(tex_name);
 
-    auto tmp_h = tmpdir / ("gui_h_" + std::to_string(std::hash<std::string>{}(tex_name)) + ".bin");
-    auto tmp_r = tmpdir / ("gui_r_" + std::to_string(std::hash<std::string>{}(tex_name)) + ".bin");
+    const TexPart *h = lookup(r->headers, key);
+    if (!h) return false;
 
-    try {
-        extract_one(found_header_bnk, header_idx, tmp_h.string());
-        extract_one(found_body_bnk, body_idx, tmp_r.string());
+    out.clear();
+    if (!append_part(*r, h, out) || !append_optional(*r, lookup(r->mip0, key), out) ||
+        !append_optional(*r, lookup(r->bodies, key), out)) {
+        out.clear();
+        return false;
+    }
+    return true;
+}
 
-        auto vh = read_all_bytes(tmp_h);
-        auto vr = read_all_bytes(tmp_r);
+bool build_gui_tex_buffer_for_name(const std::string &tex_name, std::vector<unsigned char> &out) {
+    auto r = current_resolver();
+    std::string key = to_lower(tex_name);
 
-        if (vh.empty() || vr.empty()) {
-            std::filesystem::remove(tmp_h, ec);
-            std::filesystem::remove(tmp_r, ec);
-            return false;
-        }
+    const TexPart *h = lookup(r->gui_headers, key);
+    const TexPart *b = lookup(r->gui_bodies, key);
+    if (!h || !b) return false;
 
+    out.clear();
+    if (!append_part(*r, h, out) || !append_part(*r, b, out)) {
         out.clear();
-        out.reserve(vh.size() + vr.size());
-        out.insert(out.end(), vh.begin(), vh.end());
-        out.insert(out.end(), vr.begin(), vr.end());
-
-        std::filesystem::remove(tmp_h, ec);
-        std::filesystem::remove(tmp_r, ec);
-
-        return true;
-    } catch (...) {
-        std::filesystem::remove(tmp_h, ec);
-        std::filesystem::remove(tmp_r, ec);
         return false;
     }
+    return true;
 }
 
 bool build_any_tex_buffer_for_name(const std::string &tex_name, std::vector<unsigned char> &out) {
-    std::string key = std::filesystem::path(tex_name).filename().string();
-    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
-
-    std::string header_bnk_path;
-    int header_idx = -1;
-
-    for (const auto& bnk_path : S.bnk_paths) {
-        std::string fname = std::filesystem::path(bnk_path).filename().string();
-        std::string fname_lower = fname;
-        std::transform(fname_lower.begin(), fname_lower.end(), fname_lower.begin(), ::tolower);
-
-        if (fname_lower.find("header") != std::string::npos && fname_lower.find("texture") != std::string::npos) {
-            try {
-                BNKReader reader(bnk_path);
-                for (size_t i = 0; i < reader.list_files().size(); ++i) {
-                    std::string file_lower = reader.list_files()[i].name;
-                    std::transform(file_lower.begin(), file_lower.end(), file_lower.begin(), ::tolower);
-                    std::string file_base = std::filesystem::path(file_lower).filename().string();
-
-                    if (file_base == key) {
-                        header_bnk_path = bnk_path;
-                        header_idx = (int)i;
-                        break;
-                    }
-                }
-            } catch (...) {}
-
-            if (header_idx != -1) break;
-        }
-    }
+    auto r = current_resolver();
+    std::string key = lower_base_name(tex_name);
 
-    if (header_idx == -1) {
-        return false;
-    }
+    const TexPart *h = lookup(r->any_headers, key);
+    if (!h) return false;
 
-    std::string mip0_bnk_path;
-    int mip0_idx = -1;
-
-    for (const auto& bnk_path : S.bnk_paths) {
-        std::string fname = std::filesystem::path(bnk_path).filename().string();
-        std::string fname_lower = fname;
-        std::transform(fname_lower.begin(), fname_lower.end(), fname_lower.begin(), ::tolower);
-
-        if (fname_lower.find("1024mip0") != std::string::npos && fname_lower.find("texture") != std::string::npos) {
-            try {
-                BNKReader reader(bnk_path);
-                for (size_t i = 0; i < reader.list_files().size(); ++i) {
-                    std::string file_lower = reader.list_files()[i].name;
-                    std::transform(file_lower.begin(), file_lower.end(), file_lower.begin(), ::tolower);
-                    std::string file_base = std::filesystem::path(file_lower).filename().string();
-
-                    if (file_base == key) {
-                        mip0_bnk_path = bnk_path;
-                        mip0_idx = (int)i;
-                        break;
-                    }
-                }
-            } catch (...) {}
-
-            if (mip0_idx != -1) break;
-        }
+    out.clear();
+    if (!append_part(*r, h, out) || !append_optional(*r, lookup(r->any_mip0, key), out) ||
+        !append_optional(*r, lookup(r->any_bodies, key), out)) {
+        out.clear();
+        return false;
     }
+    return true;
+}
 
-    std::string body_bnk_path;
-    int body_idx = -1;
-
-    for (const auto& bnk_path : S.bnk_paths) {
-        std::string fname = std::filesystem::path(bnk_path).filename().string();
-        std::string fname_lower = fname;
-        std::transform(fname_lower.begin(), fname_lower.end(), fname_lower.begin(), ::tolower);
-
-        if (fname_lower.find("texture") != std::string::npos &&
-            fname_lower.find("header") == std::string::npos &&
-            fname_lower.find("1024mip0") == std::string::npos) {
-            try {
-                BNKReader reader(bnk_path);
-                for (size_t i = 0; i < reader.list_files().size(); ++i) {
-                    std::string file_lower = reader.list_files()[i].name;
-                    std::transform(file_lower.begin(), file_lower.end(), file_lower.begin(), ::tolower);
-                    std::string file_base = std::filesystem::path(file_lower).filename().string();
-
-                    if (file_base == key) {
-                        body_bnk_path = bnk_path;
-                        body_idx = (int)i;
-                        break;
-                    }
-                }
-            } catch (...) {}
-
-            if (body_idx != -1) break;
-        }
+bool build_any_tex_buffer_progressive(const std::string &tex_name, const TexStageFn &stage) {
+    auto r = current_resolver();
+    std::string key = lower_base_name(tex_name);
+
+    const TexPart *h = lookup(r->any_headers, key);
+    if (!h) return false;
+    const TexPart *m = lookup(r->any_mip0, key);
+
+    std::vector<unsigned char> buf;
+    if (!append_part(*r, h, buf)) return false;
+    size_t hole_begin = buf.size(), hole_size = 0;
+    if (m) {
+        const auto &files = r->archives[m->archive]->reader->list_files();
+        hole_size = files[(size_t) m->index].uncompressed_size;
+        buf.resize(hole_begin + hole_size, 0);
     }
-
-    auto tmpdir = std::filesystem::temp_directory_path() / "f2_tex_rebuild";
-    std::error_code ec;
-    std::filesystem::create_directories(tmpdir, ec);
-
-    auto tmp_h = tmpdir / ("h_" + std::to_string(std::hash<std::string>{}(tex_name)) + ".bin");
-    auto tmp_m = tmpdir / ("m_" + std::to_string(std::hash<std::string>{}(tex_name)) + ".bin");
-    auto tmp_b = tmpdir / ("b_" + std::to_string(std::hash<std::string>{}(tex_name)) + ".bin");
-
-    try {
-        extract_one(header_bnk_path, header_idx, tmp_h.string());
-        auto vh = read_all_bytes(tmp_h);
-
-        if (vh.empty()) {
-            std::filesystem::remove(tmp_h, ec);
-            return false;
+    if (!append_optional(*r, lookup(r->any_bodies, key), buf)) return false;
+
+    TexInfo ti;
+    if (m) {
+        // Mip defs or data overlapping the hole would be read as zeros.
+        parse_tex_info(buf, ti);
+        size_t hole_end = hole_begin + hole_size;
+        ti.Mips.erase(std::remove_if(ti.Mips.begin(), ti.Mips.end(), [&](const TexInfo::MipDef &d) {
+            return d.DefOffset < hole_end && d.MipDataOffset + d.MipDataSizeParsed > hole_begin;
+        }), ti.Mips.end());
+        if (!ti.Mips.empty()) {
+            std::vector<unsigned char> partial = buf;
+            if (!stage(partial, ti, false)) return true;
         }
 
-        std::vector<unsigned char> vm;
-        bool has_mip0 = false;
-        if (mip0_idx != -1) {
-            extract_one(mip0_bnk_path, mip0_idx, tmp_m.string());
-            vm = read_all_bytes(tmp_m);
-            has_mip0 = !vm.empty();
-        }
-
-        std::vector<unsigned char> vb;
-        bool has_body = false;
-        if (body_idx != -1) {
-            extract_one(body_bnk_path, body_idx, tmp_b.string());
-            vb = read_all_bytes(tmp_b);
-            has_body = !vb.empty();
-        }
-
-        out.clear();
-        out.reserve(vh.size() + vm.size() + vb.size());
-        out.insert(out.end(), vh.begin(), vh.end());
-
-        if (has_mip0) {
-            out.insert(out.end(), vm.begin(), vm.end());
-        }
-
-        if (has_body) {
-            out.insert(out.end(), vb.begin(), vb.end());
+        std::vector<unsigned char> top;
+        if (!append_optional(*r, m, top)) return false;
+        if (top.size() == hole_size) {
+            std::copy(top.begin(), top.end(), buf.begin() + (std::ptrdiff_t) hole_begin);
+        } else {
+            buf.erase(buf.begin() + (std::ptrdiff_t) hole_begin, buf.begin() + (std::ptrdiff_t) hole_end);
+            buf.insert(buf.begin() + (std::ptrdiff_t) hole_begin, top.begin(), top.end());
         }
+    }
+    if (buf.empty()) return false;
+    parse_tex_info(buf, ti);
+    stage(buf, ti, true);
+    return true;
+}
 
-        std::filesystem::remove(tmp_h, ec);
-        if (has_mip0) std::filesystem::remove(tmp_m, ec);
-        if (has_body) std::filesystem::remove(tmp_b, ec);
-
-        return !out.empty();
-
-    } catch (...) {
-        std::filesystem::remove(tmp_h, ec);
-        std::filesystem::remove(tmp_m, ec);
-        std::filesystem::remove(tmp_b, ec);
-        return false;
+bool tex_content_key(const std::string &tex_name, uint64_t &key) {
+    auto r = current_resolver();
+    std::string name = lower_base_name(tex_name);
+
+    const TexPart *h = lookup(r->any_headers, name);
+    std::vector<unsigned char> header;
+    if (!append_part(*r, h, header)) return false;
+
+    uint64_t hash = 1469598103934665603ull;  // FNV-1a
+    auto mix = [&](const void *data, size_t size) {
+        const uint8_t *p = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < size; ++i) hash = (hash ^ p[i]) * 1099511628211ull;
+    };
+    mix(name.data(), name.size());
+    mix(header.data(), header.size());
+    for (const TexPart *part: {lookup(r->any_mip0, name), lookup(r->any_bodies, name)}) {
+        uint64_t size = part ? r->archives[part->archive]->reader->list_files()[(size_t) part->index].uncompressed_size : 0;
+        mix(&size, sizeof(size));
     }
-}
\ No newline at end of file
+    key = hash;
+    return true;
+}
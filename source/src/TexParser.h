@@ -1,4 +1,5 @@
 #pragma once
+#include <functional>
 #include <string>
 #include <vector>
 #include "State.h"
@@ -6,4 +7,18 @@
 bool parse_tex_info(const std::vector<unsigned char> &d, TexInfo &out);
 bool build_tex_buffer_for_name(const std::string &tex_name, std::vector<unsigned char> &out);
 bool build_gui_tex_buffer_for_name(const std::string &tex_name, std::vector<unsigned char> &out);
-bool build_any_tex_buffer_for_name(const std::string &tex_name, std::vector<unsigned char> &out);
\ No newline at end of file
+bool build_any_tex_buffer_for_name(const std::string &tex_name, std::vector<unsigned char> &out);
+
+// Progressive form of build_any_tex_buffer_for_name for previews. The first
+// stage is the header and body with the mip0 span zero-filled (its size comes
+// from the archive index) and `ti` listing only the mips fully present; the
+// final stage splices mip0 in. `stage` may take the buffer and returns false
+// to stop, e.g. when a newer preview was requested. Textures without a mip0
+// entry only get the final stage. Returns false when a listed part cannot be
+// read, even if the first stage already ran.
+using TexStageFn = std::function<bool(std::vector<unsigned char> &buf, const TexInfo &ti, bool final)>;
+bool build_any_tex_buffer_progressive(const std::string &tex_name, const TexStageFn &stage);
+
+// Identifies a texture's content without reading its mips: a 64-bit hash of
+// the lowercase name, the header entry's bytes and the mip0/body sizes.
+bool tex_content_key(const std::string &tex_name, uint64_t &key);
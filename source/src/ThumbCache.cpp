@@ -0,0 +1,493 @@
+#include "ThumbCache.h"
+#include "BCDecode.h"
+#include "Simd.h"
+#include "State.h"
+#include "TexCache.h"
+#include "TexParser.h"
+#include "Utils.h"
+#include "X360Tiling.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    constexpr uint32_t ATLAS_MAGIC = 0x41543246;  // "F2TA"
+    constexpr uint32_t ATLAS_VERSION = 2;
+    constexpr uint32_t ATLAS_MIN_SLOTS = 256;
+    // 512 MiB of thumbnails. A full atlas reuses its least recently used slot.
+    constexpr uint32_t ATLAS_MAX_SLOTS = 8192;
+    constexpr size_t THUMB_BYTES = (size_t) THUMB_SIZE * THUMB_SIZE * 4;
+    const char *ATLAS_PATH = "thumbs.atlas";
+
+    struct AtlasHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t thumb_size;
+        uint32_t capacity;
+        uint32_t count;
+        uint32_t clock;  // last use stamp handed out
+        uint32_t reserved[2];
+    };
+
+    struct SlotHeader {
+        uint64_t key;
+        uint16_t w, h;
+        uint32_t last_use;
+    };
+
+    // Slots are appended, each a SlotHeader followed by THUMB_BYTES of RGBA,
+    // so growing the file never moves a thumbnail. Past ATLAS_MAX_SLOTS the
+    // least recently used slot is overwritten in place.
+    constexpr size_t SLOT_STRIDE = sizeof(SlotHeader) + THUMB_BYTES;
+
+    size_t atlas_bytes(uint32_t capacity) {
+        return sizeof(AtlasHeader) + (size_t) capacity * SLOT_STRIDE;
+    }
+
+    // Read-write shared mapping of a whole file, grown on open.
+    class MappedFile {
+    public:
+        ~MappedFile() { close(); }
+
+        // Maps the file at `path`, extending it to at least `min_size` bytes.
+        bool open(const std::string &path, size_t min_size) {
+            close();
+#if defined(_WIN32)
+            _file = CreateFileW(std::filesystem::path(path).wstring().c_str(), GENERIC_READ | GENERIC_WRITE,
+                                FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (_file == INVALID_HANDLE_VALUE) {
+                _file = nullptr;
+                return false;
+            }
+            LARGE_INTEGER size{};
+            if (!GetFileSizeEx(_file, &size)) return close_failed();
+            _size = std::max((size_t) size.QuadPart, min_size);
+            if (_size == 0) return close_failed();
+            _mapping = CreateFileMappingW(_file, nullptr, PAGE_READWRITE, (DWORD) ((uint64_t) _size >> 32),
+                                          (DWORD) (_size & 0xFFFFFFFFu), nullptr);
+            if (!_mapping) return close_failed();
+            _data = static_cast<uint8_t *>(MapViewOfFile(_mapping, FILE_MAP_ALL_ACCESS, 0, 0, _size));
+            if (!_data) return close_failed();
+#else
+            _fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+            if (_fd < 0) return false;
+            struct stat st{};
+            if (fstat(_fd, &st) != 0) return close_failed();
+            _size = std::max((size_t) st.st_size, min_size);
+            if (_size == 0) return close_failed();
+            if ((size_t) st.st_size < _size && ftruncate(_fd, (off_t) _size) != 0) return close_failed();
+            void *p = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+            if (p == MAP_FAILED) return close_failed();
+            _data = static_cast<uint8_t *>(p);
+#endif
+            return true;
+        }
+
+        void close() {
+#if defined(_WIN32)
+            if (_data) UnmapViewOfFile(_data);
+            if (_mapping) CloseHandle(_mapping);
+            if (_file) CloseHandle(_file);
+            _mapping = nullptr;
+            _file = nullptr;
+#else
+            if (_data) munmap(_data, _size);
+            if (_fd >= 0) ::close(_fd);
+            _fd = -1;
+#endif
+            _data = nullptr;
+            _size = 0;
+        }
+
+        uint8_t *data() const { return _data; }
+        size_t size() const { return _size; }
+
+    private:
+        bool close_failed() {
+            close();
+            return false;
+        }
+
+        uint8_t *_data = nullptr;
+        size_t _size = 0;
+#if defined(_WIN32)
+        HANDLE _file = nullptr;
+        HANDLE _mapping = nullptr;
+#else
+        int _fd = -1;
+#endif
+    };
+
+    // The on-disk thumbnail store. Callers hold g_mutex.
+    class Atlas {
+    public:
+        bool find(uint64_t key, uint32_t &slot) {
+            if (!ensure_open()) return false;
+            auto it = _slots.find(key);
+            if (it == _slots.end()) return false;
+            slot = it->second;
+            return true;
+        }
+
+        bool put(uint64_t key, const uint8_t *rgba, int w, int h, uint32_t &slot) {
+            if (!ensure_open()) return false;
+            if (find(key, slot)) return true;
+            uint32_t count = header()->count;
+            if (count == header()->capacity && count < ATLAS_MAX_SLOTS &&
+                !grow(std::min(count * 2, ATLAS_MAX_SLOTS)))
+                return false;
+
+            bool append = count < header()->capacity;
+            slot = append ? count : least_recent();
+            uint8_t *p = slot_ptr(slot);
+            if (!append) {
+                SlotHeader old;
+                std::memcpy(&old, p, sizeof(old));
+                _slots.erase(old.key);
+                // Cleared first, so a torn overwrite never carries the old key.
+                std::memset(p, 0, sizeof(SlotHeader));
+            }
+            SlotHeader sh{key, (uint16_t) w, (uint16_t) h, ++header()->clock};
+            std::memcpy(p + sizeof(SlotHeader), rgba, (size_t) w * h * 4);
+            std::memcpy(p, &sh, sizeof(sh));
+            // Published last, so a slot is never counted before it is filled.
+            if (append) header()->count = count + 1;
+            _slots[key] = slot;
+            return true;
+        }
+
+        // False when the atlas is unavailable or the slot now holds another
+        // thumbnail.
+        bool read(uint32_t slot, uint64_t key, std::vector<uint8_t> &rgba, int &w, int &h) {
+            if (!ensure_open() || slot >= header()->count) return false;
+            uint8_t *p = slot_ptr(slot);
+            SlotHeader sh;
+            std::memcpy(&sh, p, sizeof(sh));
+            if (sh.key != key) return false;
+            sh.last_use = ++header()->clock;
+            std::memcpy(p, &sh, sizeof(sh));
+            w = sh.w;
+            h = sh.h;
+            rgba.assign(p + sizeof(SlotHeader), p + sizeof(SlotHeader) + (size_t) w * h * 4);
+            return true;
+        }
+
+    private:
+        AtlasHeader *header() { return reinterpret_cast<AtlasHeader *>(_file.data()); }
+        uint8_t *slot_ptr(uint32_t slot) { return _file.data() + atlas_bytes(slot); }
+
+        uint32_t least_recent() {
+            uint32_t best = 0, best_use = UINT32_MAX;
+            for (uint32_t i = 0; i < header()->count; ++i) {
+                SlotHeader sh;
+                std::memcpy(&sh, slot_ptr(i), sizeof(sh));
+                if (sh.last_use < best_use) {
+                    best = i;
+                    best_use = sh.last_use;
+                }
+            }
+            return best;
+        }
+
+        bool valid() {
+            if (_file.size() < sizeof(AtlasHeader)) return false;
+            const AtlasHeader *hd = header();
+            return hd->magic == ATLAS_MAGIC && hd->version == ATLAS_VERSION && hd->thumb_size == THUMB_SIZE &&
+                   hd->count <= hd->capacity && hd->capacity <= ATLAS_MAX_SLOTS &&
+                   _file.size() >= atlas_bytes(hd->capacity);
+        }
+
+        bool create() {
+            _file.close();
+            std::error_code ec;
+            std::filesystem::remove(ATLAS_PATH, ec);
+            if (!_file.open(ATLAS_PATH, atlas_bytes(ATLAS_MIN_SLOTS))) return false;
+            AtlasHeader hd{ATLAS_MAGIC, ATLAS_VERSION, THUMB_SIZE, ATLAS_MIN_SLOTS, 0, 0, {}};
+            std::memcpy(_file.data(), &hd, sizeof(hd));
+            return true;
+        }
+
+        bool ensure_open() {
+            if (_tried) return _file.data() != nullptr;
+            _tried = true;
+            if (!_file.open(ATLAS_PATH, 0) || !valid()) {
+                if (!create()) return false;
+            }
+            for (uint32_t i = 0; i < header()->count; ++i) {
+                SlotHeader sh;
+                std::memcpy(&sh, slot_ptr(i), sizeof(sh));
+                _slots.emplace(sh.key, i);
+            }
+            return true;
+        }
+
+        // A failed remap leaves the atlas closed; ensure_open then reports it.
+        bool grow(uint32_t capacity) {
+            if (!_file.open(ATLAS_PATH, atlas_bytes(capacity))) {
+                _slots.clear();
+                return false;
+            }
+            header()->capacity = capacity;
+            return true;
+        }
+
+        MappedFile _file;
+        std::unordered_map<uint64_t, uint32_t> _slots;
+        bool _tried = false;
+    };
+
+    struct NameEntry {
+        ThumbState state = ThumbState::Missing;
+        uint32_t slot = 0;
+        uint64_t content = 0;
+    };
+
+    std::mutex g_mutex;
+    Atlas g_atlas;
+    std::unordered_map<std::string, NameEntry> g_names;
+
+    // One worker pool for the session, started by the first queue and
+    // joined by thumb_shutdown. Workers take names off the current batch in
+    // order; a new batch replaces the rest of the old one, which is how a
+    // scrolled-away grid is cancelled.
+    std::mutex g_work_mutex;
+    std::condition_variable g_work_cv;
+    std::vector<std::string> g_work;
+    size_t g_work_next = 0;
+    bool g_work_stop = false;
+    std::vector<std::thread> g_workers;
+
+    std::string name_key(const std::string &tex_name) {
+        std::string k = std::filesystem::path(tex_name).filename().string();
+        std::transform(k.begin(), k.end(), k.begin(), [](unsigned char c) { return (char) std::tolower(c); });
+        return k;
+    }
+
+    void mip_size(const TexInfo &ti, int i, int &w, int &h) {
+        const auto &m = ti.Mips[(size_t) i];
+        w = m.HasWH ? (int) m.MipWidth : std::max(1, (int) ti.TextureWidth >> i);
+        h = m.HasWH ? (int) m.MipHeight : std::max(1, (int) ti.TextureHeight >> i);
+    }
+
+    // Smallest raw mip whose longer side reaches THUMB_SIZE; failing that,
+    // with `fallback`, the largest one.
+    int pick_mip(const TexInfo &ti, bool fallback) {
+        int big = -1, any = -1;
+        size_t big_area = SIZE_MAX, any_area = 0;
+        for (int i = 0; i < (int) ti.Mips.size(); ++i) {
+            if (ti.Mips[(size_t) i].CompFlag != 7) continue;
+            int w, h;
+            mip_size(ti, i, w, h);
+            size_t area = (size_t) w * h;
+            if (std::max(w, h) >= THUMB_SIZE && area < big_area) {
+                big = i;
+                big_area = area;
+            }
+            if (area > any_area) {
+                any = i;
+                any_area = area;
+            }
+        }
+        return big >= 0 ? big : (fallback ? any : -1);
+    }
+
+    // Halves each side longer than one pixel with a rounded 2x2 box. Even
+    // sizes take the SSE2 path, two output pixels per step.
+    void halve(const uint8_t *src, int w, int h, std::vector<uint8_t> &dst, int &nw, int &nh) {
+        nw = std::max(1, w / 2);
+        nh = std::max(1, h / 2);
+        dst.resize((size_t) nw * nh * 4);
+        for (int y = 0; y < nh; ++y) {
+            const uint8_t *r0 = src + (size_t) std::min(2 * y, h - 1) * w * 4;
+            const uint8_t *r1 = src + (size_t) std::min(2 * y + 1, h - 1) * w * 4;
+            uint8_t *out = dst.data() + (size_t) y * nw * 4;
+            int x = 0;
+#if F2_SIMD_X86
+            if (w % 2 == 0) {
+                const __m128i zero = _mm_setzero_si128(), two = _mm_set1_epi16(2);
+                for (; x + 2 <= nw; x += 2) {
+                    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(r0 + x * 8));
+                    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(r1 + x * 8));
+                    __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+                    __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+                    lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+                    hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+                    __m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), two), 2);
+                    _mm_storel_epi64(reinterpret_cast<__m128i *>(out + x * 4), _mm_packus_epi16(sum, zero));
+                }
+            }
+#endif
+            for (; x < nw; ++x) {
+                int x0 = std::min(2 * x, w - 1) * 4, x1 = std::min(2 * x + 1, w - 1) * 4;
+                for (int c = 0; c < 4; ++c)
+                    out[x * 4 + c] = (uint8_t) ((r0[x0 + c] + r0[x1 + c] + r1[x0 + c] + r1[x1 + c] + 2) >> 2);
+            }
+        }
+    }
+
+    bool render_thumb(const std::string &tex_name, std::vector<uint8_t> &rgba, int &w, int &h) {
+        bool tiled = texture_is_tiled(tex_name);
+        bool done = false;
+        auto stage = [&](const std::vector<unsigned char> &buf, const TexInfo &ti, bool final) {
+            int mip = pick_mip(ti, final);
+            if (mip < 0) return true;
+            BCFormat fmt = bc_format_from_pixel_format(ti.PixelFormat);
+            if (fmt == BCFormat::None) return false;
+
+            const auto &m = ti.Mips[(size_t) mip];
+            mip_size(ti, mip, w, h);
+            const uint8_t *src = buf.data() + m.MipDataOffset;
+            size_t src_size = m.MipDataSizeParsed;
+            std::vector<uint8_t> linear;
+            if (tiled) {
+                if (!x360_untile_bc(fmt, src, src_size, w, h, linear)) return false;
+                src = linear.data();
+                src_size = linear.size();
+            }
+            rgba.assign((size_t) w * h * 4, 0xFF);
+            if (!bc_decode(fmt, src, src_size, w, h, rgba.data(), BCChannelOrder::RGBA, BCKernel::Auto, 1))
+                return false;
+
+            std::vector<uint8_t> half;
+            while (std::max(w, h) > THUMB_SIZE) {
+                int nw, nh;
+                halve(rgba.data(), w, h, half, nw, nh);
+                rgba.swap(half);
+                w = nw;
+                h = nh;
+            }
+            done = true;
+            return false;
+        };
+
+        // A blob the previews already assembled is used as is. Otherwise the
+        // first stage often holds a big enough mip and mip0 is never read;
+        // those partial loads stay out of the shared cache.
+        if (TexBlobPtr cached = tex_cache_peek_blob(tex_name)) {
+            TexInfo ti;
+            if (parse_tex_info(*cached, ti)) stage(*cached, ti, true);
+            return done;
+        }
+        build_any_tex_buffer_progressive(tex_name, stage);
+        return done;
+    }
+
+    void set_state(const std::string &key, ThumbState state, uint32_t slot = 0, uint64_t content = 0) {
+        NameEntry &e = g_names[key];
+        e.state = state;
+        e.slot = slot;
+        e.content = content;
+    }
+
+    void make_thumb(const std::string &tex_name) {
+        std::string key = name_key(tex_name);
+        uint64_t content;
+        if (!tex_content_key(tex_name, content)) {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            set_state(key, ThumbState::Failed);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            uint32_t slot;
+            if (g_atlas.find(content, slot)) {
+                set_state(key, ThumbState::Ready, slot, content);
+                return;
+            }
+        }
+
+        std::vector<uint8_t> rgba;
+        int w = 0, h = 0;
+        bool ok = false;
+        try {
+            ok = render_thumb(tex_name, rgba, w, h);
+        } catch (...) {}
+
+        std::lock_guard<std::mutex> lock(g_mutex);
+        uint32_t slot;
+        if (ok && g_atlas.put(content, rgba.data(), w, h, slot)) set_state(key, ThumbState::Ready, slot, content);
+        else set_state(key, ThumbState::Failed);
+    }
+
+    void thumb_worker() {
+        for (;;) {
+            std::string name;
+            {
+                std::unique_lock<std::mutex> lock(g_work_mutex);
+                g_work_cv.wait(lock, []() { return g_work_stop || g_work_next < g_work.size(); });
+                if (g_work_stop) return;
+                name = std::move(g_work[g_work_next++]);
+            }
+            make_thumb(name);
+        }
+    }
+}
+
+void thumb_queue(const std::vector<std::string> &tex_names) {
+    std::vector<std::string> todo;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        for (const auto &n: tex_names) {
+            NameEntry &e = g_names[name_key(n)];
+            // Pending names may belong to a queue that was just superseded.
+            if (e.state == ThumbState::Missing || e.state == ThumbState::Pending) {
+                e.state = ThumbState::Pending;
+                todo.push_back(n);
+            }
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_work_mutex);
+        if (g_work_stop) return;
+        g_work = std::move(todo);
+        g_work_next = 0;
+        if (g_workers.empty())
+            for (unsigned i = 0; i < std::max(1u, std::thread::hardware_concurrency()); ++i)
+                g_workers.emplace_back(thumb_worker);
+    }
+    g_work_cv.notify_all();
+}
+
+ThumbState thumb_fetch(const std::string &tex_name, std::vector<uint8_t> &rgba, int &w, int &h) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto it = g_names.find(name_key(tex_name));
+    if (it == g_names.end()) return ThumbState::Missing;
+    NameEntry &e = it->second;
+    // An evicted thumbnail goes back to Missing so the next queue redoes it.
+    if (e.state == ThumbState::Ready && !g_atlas.read(e.slot, e.content, rgba, w, h)) e.state = ThumbState::Missing;
+    return e.state;
+}
+
+void thumb_reset() {
+    {
+        std::lock_guard<std::mutex> lock(g_work_mutex);
+        g_work.clear();
+        g_work_next = 0;
+    }
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_names.clear();
+}
+
+void thumb_shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(g_work_mutex);
+        g_work_stop = true;
+    }
+    g_work_cv.notify_all();
+    for (auto &t: g_workers) t.join();
+    g_workers.clear();
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Texture thumbnails for the grid browser. Each one is the smallest raw mip
+// whose longer side is at least THUMB_SIZE, box-filtered down to fit
+// THUMB_SIZE x THUMB_SIZE. They live in one memory-mapped atlas file
+// (thumbs.atlas in the working directory, next to last_dir.txt), keyed by
+// tex_content_key, so they survive restarts and follow edited archives.
+// The atlas is capped; past the cap the least recently used thumbnail is
+// overwritten and its name reads as Missing until queued again.
+constexpr int THUMB_SIZE = 128;
+
+enum class ThumbState : uint8_t {
+    Missing = 0,  // not queued
+    Pending,
+    Ready,
+    Failed,
+};
+
+// Replaces the work queue with `tex_names`, generated in that order on a
+// worker pool that lives until thumb_shutdown. Names already done keep
+// their thumbnails.
+void thumb_queue(const std::vector<std::string> &tex_names);
+// Copies a ready thumbnail (tightly packed RGBA, w and h <= THUMB_SIZE).
+ThumbState thumb_fetch(const std::string &tex_name, std::vector<uint8_t> &rgba, int &w, int &h);
+// Forgets per-name results, e.g. after the catalog changed. The atlas stays.
+void thumb_reset();
+// Stops the worker pool once the thumbnails in progress finish. Call on exit.
+void thumb_shutdown();
@@ -5,6 +5,8 @@
 #include "files.h"
 #include "Progress.h"
 #include "UI_Panels.h"
+#include "SearchIndex.h"
+#include "ArchiveWatcher.h"
 #include "BNKCore.cpp"
 #include "imgui.h"
 #include "imgui_stdlib.h"
@@ -136,6 +138,30 @@ static bool LoadTextureFromFile(const char* filename, ID3D11Device* device, ID3D
 
 void refresh_file_table() { S.selected_file_index = -1; }
 
+// Case-insensitive by file name; full path breaks ties so the order is
+// stable across rescans.
+static void sort_by_filename(std::vector<std::string> &paths) {
+    std::sort(paths.begin(), paths.end(), [](const std::string &a, const std::string &b) {
+        std::string A = std::filesystem::path(a).filename().string(), B = std::filesystem::path(b).filename().string();
+        std::transform(A.begin(), A.end(), A.begin(), ::tolower);
+        std::transform(B.begin(), B.end(), B.begin(), ::tolower);
+        if (A != B) return A < B;
+        return a < b;
+    });
+}
+
+// Sorts by lowercased base name using the interned folded names.
+void sort_files_by_basename(std::vector<BNKItemUI> &files) {
+    auto base = [](const BNKItemUI &f) {
+        std::string_view v = f.folded.text;
+        size_t cut = v.find_last_of("/\\");
+        return cut == std::string_view::npos ? v : v.substr(cut + 1);
+    };
+    std::sort(files.begin(), files.end(), [&](const BNKItemUI &a, const BNKItemUI &b) {
+        return base(a) < base(b);
+    });
+}
+
 void pick_bnk(const std::string &path) {
     S.selected_bnk = path;
     S.selected_nested_temp_path.clear();
@@ -144,15 +170,9 @@ void pick_bnk(const std::string &path) {
     BNKReader reader(path);
     const auto &fe = reader.list_files();
     S.files.reserve(fe.size());
-    for (size_t i = 0; i < fe.size(); ++i) S.files.push_back({(int) i, fe[i].name, fe[i].uncompressed_size});
-
-    std::sort(S.files.begin(), S.files.end(), [](const BNKItemUI &a, const BNKItemUI &b) {
-        std::string x = std::filesystem::path(a.name).filename().string();
-        std::string y = std::filesystem::path(b.name).filename().string();
-        std::transform(x.begin(), x.end(), x.begin(), ::tolower);
-        std::transform(y.begin(), y.end(), y.begin(), ::tolower);
-        return x < y;
-    });
+    for (size_t i = 0; i < fe.size(); ++i) S.files.push_back(make_bnk_item((int) i, fe[i].name, fe[i].uncompressed_size));
+
+    sort_files_by_basename(S.files);
 
     refresh_file_table();
 }
@@ -170,15 +190,38 @@ void open_folder_logic(const std::string &sel) {
         show_error_box(std::string("Selected path is not a directory: ") + sel);
         return;
     }
+    bool same_root = (S.root_dir == sel);
     S.root_dir = sel;
     S.last_dir = sel;
     save_last_dir(sel);
     try {
-        S.bnk_paths = scan_bnks_recursive(sel);
+        ScanResult scan = scan_game_dir(sel);
+        // Reselecting the same root only invalidates the catalog when an
+        // archive was added, removed or rewritten since the last scan.
+        bool reset = !same_root || !diff_scans(S.last_scan, scan).empty();
+
+        S.bnk_paths.clear();
+        S.adb_paths.clear();
+        for (auto &f: scan.bnks) S.bnk_paths.push_back(f.path);
+        for (auto &f: scan.adbs) S.adb_paths.push_back(f.path);
         if (S.bnk_paths.empty()) S.bnk_paths = find_bnks(sel);
-
-        S.adb_paths = scan_adbs_recursive(sel);
+        S.last_scan = std::move(scan);
+        // Bumped once the new paths are in, so a worker that sees the new
+        // generation never rebuilds from the old list.
+        if (reset) {
+            ++S.catalog_gen;
+            S.catalog_reset_gen = S.catalog_gen;
+            S.catalog_changes.clear();
+            search_index_reset();
+        }
     } catch (...) {
+        // Workers key their caches on the generation alone, so a new root
+        // bumps it even when its scan failed.
+        if (!same_root) {
+            ++S.catalog_gen;
+            S.catalog_reset_gen = S.catalog_gen;
+            S.catalog_changes.clear();
+        }
         show_error_box("Error searching for BNK files");
         return;
     }
@@ -188,26 +231,64 @@ void open_folder_logic(const std::string &sel) {
                 "\n\nPlease select a folder containing Fable 2 BNK files."));
         return;
     }
-    std::sort(S.bnk_paths.begin(), S.bnk_paths.end(), [](const std::string &a, const std::string &b) {
-        std::string A = std::filesystem::path(a).filename().string(), B = std::filesystem::path(b).filename().string();
-        std::transform(A.begin(), A.end(), A.begin(), ::tolower);
-        std::transform(B.begin(), B.end(), B.begin(), ::tolower);
-        return A < B;
-    });
-
-    std::sort(S.adb_paths.begin(), S.adb_paths.end(), [](const std::string &a, const std::string &b) {
-        std::string A = std::filesystem::path(a).filename().string(), B = std::filesystem::path(b).filename().string();
-        std::transform(A.begin(), A.end(), A.begin(), ::tolower);
-        std::transform(B.begin(), B.end(), B.begin(), ::tolower);
-        return A < B;
-    });
+    sort_by_filename(S.bnk_paths);
+    index_bnk_paths();
+    sort_by_filename(S.adb_paths);
 
     S.selected_bnk.clear();
     S.files.clear();
     refresh_file_table();
+
+    if (S.watch_root) watcher_start(sel);
+}
+
+// Called with paths the watcher reported as settled. Only those archives are
+// dropped from the search index and relisted by the file tree; the rest of
+// the session (selection, open folders, cached listings) is left alone.
+void refresh_changed_archives(const std::vector<std::string> &paths) {
+    ScanDiff diff = rescan_paths(S.last_scan, paths);
+    if (diff.empty()) return;
+
+    S.bnk_paths.clear();
+    S.adb_paths.clear();
+    for (auto &f: S.last_scan.bnks) S.bnk_paths.push_back(f.path);
+    for (auto &f: S.last_scan.adbs) S.adb_paths.push_back(f.path);
+    sort_by_filename(S.bnk_paths);
+    index_bnk_paths();
+    sort_by_filename(S.adb_paths);
+
+    std::vector<std::string> touched;
+    for (auto *list: {&diff.added, &diff.removed, &diff.changed})
+        touched.insert(touched.end(), list->begin(), list->end());
+
+    ++S.catalog_gen;
+    for (auto &p: touched) S.catalog_changes.push_back({S.catalog_gen, p});
+    search_index_invalidate(touched);
+
+    if (S.selected_bnk.empty() || S.viewing_adb) return;
+    if (std::find(touched.begin(), touched.end(), S.selected_bnk) == touched.end()) return;
+
+    if (std::find(diff.removed.begin(), diff.removed.end(), S.selected_bnk) != diff.removed.end()) {
+        S.selected_bnk.clear();
+        S.selected_nested_temp_path.clear();
+        S.files.clear();
+        refresh_file_table();
+        return;
+    }
+    try {
+        pick_bnk(S.selected_bnk);
+    } catch (...) {
+        S.files.clear();
+        refresh_file_table();
+    }
 }
 
 void draw_main(HWND hwnd, ID3D11Device* device) {
+    if (S.watch_root && !S.root_dir.empty()) {
+        auto changed = watcher_poll();
+        if (!changed.empty()) refresh_changed_archives(changed);
+    }
+
     ImGuiViewport *vp = ImGui::GetMainViewport();
     const float inset = 8.0f;
     ImGui::SetNextWindowPos(vp->WorkPos + ImVec2(inset, inset));
@@ -1,10 +1,14 @@
 #pragma once
 #include <string>
+#include <vector>
 #include <windows.h>
 
 struct ID3D11Device;
+struct BNKItemUI;
 
+void sort_files_by_basename(std::vector<BNKItemUI> &files);
 void pick_bnk(const std::string &path);
 void refresh_file_table();
 void open_folder_logic(const std::string &sel);
+void refresh_changed_archives(const std::vector<std::string> &paths);
 void draw_main(HWND hwnd, ID3D11Device* device);
\ No newline at end of file
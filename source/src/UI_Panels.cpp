@@ -8,6 +8,14 @@
 #include "ModelParser.h"
 #include "ModelPreview.h"
 #include "mdl_converter.h"
+#include "FileTree.h"
+#include "SearchIndex.h"
+#include "ArchiveWatcher.h"
+#include "X360Tiling.h"
+#include "BCDecode.h"
+#include "TexMetaIndex.h"
+#include "TexCache.h"
+#include "ThumbCache.h"
 #include "BNKCore.cpp"
 #include "imgui.h"
 #include "imgui_internal.h"
@@ -17,86 +25,27 @@
 #include <algorithm>
 #include <thread>
 #include <atomic>
+#include <unordered_map>
 #include "Progress.h"
 #include "files.h"
 
 
 
-static bool reconstruct_nested_mdl(const std::string& nested_bnk_path, int file_index, std::vector<unsigned char>& out) {
-    try {
-        BNKReader nested_reader(nested_bnk_path);
-        const auto& files = nested_reader.list_files();
-        if (file_index < 0 || file_index >= (int)files.size()) return false;
-
-        std::string mdl_name = files[file_index].name;
-
-        auto tmpdir = std::filesystem::temp_directory_path() / "f2_nested_mdl_reconstruct";
-        std::error_code ec;
-        std::filesystem::create_directories(tmpdir, ec);
-
-        auto tmp_body = tmpdir / "body.bin";
-        extract_one(nested_bnk_path, file_index, tmp_body.string());
-        auto body_data = read_all_bytes(tmp_body);
-        std::filesystem::remove(tmp_body, ec);
-
-        if (body_data.empty()) return false;
-
-        auto p_headers = find_bnk_by_filename("globals_model_headers.bnk");
-        if (!p_headers) {
-            out = body_data;
-            return true;
-        }
-
-        BNKReader r_headers(*p_headers);
-        const auto& header_files = r_headers.list_files();
-
-        std::string mdl_filename = std::filesystem::path(mdl_name).filename().string();
-        std::string mdl_lower = mdl_filename;
-        std::transform(mdl_lower.begin(), mdl_lower.end(), mdl_lower.begin(), ::tolower);
-
-        int header_idx = -1;
-        for (size_t i = 0; i < header_files.size(); ++i) {
-            std::string hname = std::filesystem::path(header_files[i].name).filename().string();
-            std::string hname_lower = hname;
-            std::transform(hname_lower.begin(), hname_lower.end(), hname_lower.begin(), ::tolower);
-            if (hname_lower == mdl_lower) {
-                header_idx = (int)i;
-                break;
-            }
-        }
-
-        if (header_idx == -1) {
-            out = body_data;
-            return true;
+// Index of the largest raw (CompFlag 7) mip, or -1 if there is none.
+static int largest_raw_mip(const TexInfo& ti) {
+    int best_mip = -1;
+    size_t best_area = 0;
+    for (int i = 0; i < (int)ti.Mips.size(); ++i) {
+        if (ti.Mips[i].CompFlag != 7) continue;
+        int w = ti.Mips[i].HasWH ? (int)ti.Mips[i].MipWidth : std::max(1, (int)ti.TextureWidth >> i);
+        int h = ti.Mips[i].HasWH ? (int)ti.Mips[i].MipHeight : std::max(1, (int)ti.TextureHeight >> i);
+        size_t area = (size_t)w * (size_t)h;
+        if (area > best_area) {
+            best_area = area;
+            best_mip = i;
         }
-
-        auto tmp_header = tmpdir / "header.bin";
-        extract_one(*p_headers, header_idx, tmp_header.string());
-        auto header_data = read_all_bytes(tmp_header);
-        std::filesystem::remove(tmp_header, ec);
-
-        if (header_data.empty()) {
-            out = body_data;
-            return true;
-        }
-
-        out.clear();
-        out.reserve(header_data.size() + body_data.size());
-        out.insert(out.end(), header_data.begin(), header_data.end());
-        out.insert(out.end(), body_data.begin(), body_data.end());
-
-        return true;
-
-    } catch (...) {
-        return false;
     }
-}
-
-static bool is_in_audio_folder(const std::string& path) {
-    std::string lower_path = path;
-    std::transform(lower_path.begin(), lower_path.end(), lower_path.begin(), ::tolower);
-    return lower_path.find("/audio/") != std::string::npos ||
-           lower_path.find("\\audio\\") != std::string::npos;
+    return best_mip;
 }
 
 bool can_tex = false, can_mdl = false;
@@ -105,176 +54,42 @@ static std::vector<GlobalHit> g_global_hits;
 static std::atomic<bool> g_global_busy(false);
 static std::atomic<bool> g_cancel_search(false);
 static std::string g_last_global_search;
+static uint32_t g_global_search_gen = 0;
 static int g_selected_global = -1;
 
-struct TreeNode {
-    std::string name;
-    bool is_file;
-    std::string full_path;
-    std::string bnk_source;
-    int bnk_index;
-    uint32_t file_size;
-    std::map<std::string, TreeNode> children;
-};
-
-static TreeNode g_tree_root;
+static FileTree g_file_tree;
 
-static bool find_mdl_files_in_folder(TreeNode& root, const std::string& folder_name, std::vector<std::pair<std::string, std::string>>& out_mdl_paths) {
-    out_mdl_paths.clear();
+static void draw_tree_node(FileTree& tree, uint32_t id, ID3D11Device* device);
 
-    std::function<TreeNode*(TreeNode&, const std::string&)> find_folder = [&](TreeNode& node, const std::string& name) -> TreeNode* {
-        if (!node.is_file && node.name == name) {
-            return &node;
-        }
-        for (auto& pair : node.children) {
-            if (!pair.second.is_file) {
-                TreeNode* result = find_folder(pair.second, name);
-                if (result) return result;
-            }
-        }
-        return nullptr;
-    };
-
-    TreeNode* folder = find_folder(root, folder_name);
-    if (!folder) return false;
-
-    for (auto& pair : folder->children) {
-        if (pair.second.is_file) {
-            std::string fname = pair.first;
-            std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-            if (fname == "interior.mdl" || fname == "exterior.mdl") {
-                out_mdl_paths.push_back({pair.second.full_path, pair.second.bnk_source});
-            }
-        }
+static void draw_tree_children(FileTree& tree, uint32_t id, ID3D11Device* device) {
+    if (tree.nodes[id].list_state == FT_UNLISTED) {
+        file_tree_expand(tree, id);
     }
-
-    return !out_mdl_paths.empty();
-}
-
-static void build_unified_file_tree(TreeNode& root) {
-    root.children.clear();
-
-    auto is_header_bnk = [](const std::string& bnk_path) -> bool {
-        std::string lower_path = bnk_path;
-        std::transform(lower_path.begin(), lower_path.end(), lower_path.begin(), ::tolower);
-        std::string filename = std::filesystem::path(lower_path).filename().string();
-        return filename.find("header") != std::string::npos;
-    };
-
-    auto is_nested_bnk = [](const std::string& filename) -> bool {
-        std::string lower = filename;
-        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
-        return lower.size() >= 4 && lower.substr(lower.size() - 4) == ".bnk";
-    };
-
-    auto add_to_tree = [&root](const std::string& path, const std::string& bnk_source,
-                               int bnk_index, uint32_t file_size, bool is_nested = false) {
-        std::string normalized_path = path;
-        std::replace(normalized_path.begin(), normalized_path.end(), '\\', '/');
-
-        std::vector<std::string> parts;
-        size_t start = 0;
-        size_t end = normalized_path.find('/');
-
-        while (end != std::string::npos) {
-            parts.push_back(normalized_path.substr(start, end - start));
-            start = end + 1;
-            end = normalized_path.find('/', start);
-        }
-        parts.push_back(normalized_path.substr(start));
-
-        TreeNode* current = &root;
-        for (size_t j = 0; j < parts.size(); ++j) {
-            const std::string& part = parts[j];
-            if (part.empty()) continue;
-
-            bool is_last = (j == parts.size() - 1);
-
-            TreeNode& child = current->children[part];
-            child.name = part;
-            child.is_file = is_last;
-
-            if (is_last) {
-                child.full_path = path;
-                child.bnk_source = bnk_source;
-                child.bnk_index = bnk_index;
-                child.file_size = file_size;
-            }
-
-            current = &child;
-        }
-    };
-
-    std::vector<std::pair<std::string, int>> nested_bnks;
-
-    for (const auto& bnk_path : S.bnk_paths) {
-        if (is_header_bnk(bnk_path)) {
-            continue;
-        }
-
-        try {
-            BNKReader reader(bnk_path);
-            const auto& files = reader.list_files();
-
-            for (size_t i = 0; i < files.size(); ++i) {
-                const auto& file = files[i];
-
-                add_to_tree(file.name, bnk_path, (int)i, file.uncompressed_size);
-
-                if (is_nested_bnk(file.name)) {
-                    nested_bnks.push_back({bnk_path, (int)i});
-                }
-            }
-        } catch (...) {
-            continue;
-        }
+    if (tree.nodes[id].list_state != FT_LISTED) {
+        ImGui::TextDisabled("Loading...");
+        return;
     }
 
-    for (const auto& [parent_bnk_path, nested_index] : nested_bnks) {
-        try {
-            BNKReader parent_reader(parent_bnk_path);
-            const auto& parent_files = parent_reader.list_files();
-
-            if (nested_index < 0 || nested_index >= (int)parent_files.size()) {
-                continue;
-            }
-
-            const auto& nested_file = parent_files[nested_index];
-            std::string nested_path = nested_file.name;
-
-            auto tmpdir = std::filesystem::temp_directory_path() / "f2_nested_bnk_tree";
-            std::error_code ec;
-            std::filesystem::create_directories(tmpdir, ec);
-
-            std::string temp_name = "nested_" + std::to_string(std::hash<std::string>{}(parent_bnk_path + nested_path)) + ".bnk";
-            auto temp_bnk_path = tmpdir / temp_name;
-
-            extract_one(parent_bnk_path, nested_index, temp_bnk_path.string());
-
-            BNKReader nested_reader(temp_bnk_path.string());
-            const auto& nested_files = nested_reader.list_files();
-
-            std::filesystem::path nested_parent = std::filesystem::path(nested_path).parent_path();
-            std::string prefix = nested_parent.empty() ? "" : nested_parent.string() + "/";
-
-            for (size_t i = 0; i < nested_files.size(); ++i) {
-                const auto& file = nested_files[i];
-                std::string full_nested_path = prefix + file.name;
-                add_to_tree(full_nested_path, temp_bnk_path.string(), (int)i, file.uncompressed_size, true);
-            }
-
-        } catch (...) {
-            continue;
-        }
+    uint32_t first = tree.nodes[id].first_child;
+    uint32_t count = tree.nodes[id].child_count;
+    for (uint32_t c = first; c < first + count; ++c) {
+        draw_tree_node(tree, c, device);
     }
 }
 
-static void draw_tree_node(TreeNode& node, ID3D11Device* device) {
-    if (node.is_file) {
-        ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen;
+static void draw_tree_node(FileTree& tree, uint32_t id, ID3D11Device* device) {
+    // Copy: expanding a child may grow tree.nodes.
+    const FileTreeNode node = tree.nodes[id];
+    std::string label(tree.name(id));
+
+    if (node.is_file()) {
+        ImGuiTreeNodeFlags flags = node.is_archive
+            ? (ImGuiTreeNodeFlags_OpenOnArrow | ImGuiTreeNodeFlags_SpanAvailWidth)
+            : (ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen);
+        const std::string bnk_source = tree.sources[node.source];
 
         bool selected = false;
-        if (!S.viewing_adb && S.selected_bnk == node.bnk_source) {
+        if (!S.viewing_adb && S.selected_bnk == bnk_source) {
             for (size_t i = 0; i < S.files.size(); ++i) {
                 if (S.files[i].index == node.bnk_index) {
                     selected = (S.selected_file_index == (int)i);
@@ -287,18 +102,17 @@ static void draw_tree_node(TreeNode& node, ID3D11Device* device) {
             flags |= ImGuiTreeNodeFlags_Selected;
         }
 
-        std::string label = node.name;
-        ImGui::TreeNodeEx(label.c_str(), flags);
+        bool node_open = ImGui::TreeNodeEx(label.c_str(), flags);
 
-        if (ImGui::IsItemClicked()) {
+        if (ImGui::IsItemClicked() && !ImGui::IsItemToggledOpen()) {
             S.selected_folder_path.clear();
 
-            if (S.selected_bnk != node.bnk_source) {
+            if (S.selected_bnk != bnk_source) {
                 S.viewing_adb = false;
                 S.global_search.clear();
                 S.selected_nested_bnk.clear();
                 S.selected_nested_index = -1;
-                pick_bnk(node.bnk_source);
+                pick_bnk(bnk_source);
             }
 
             for (size_t i = 0; i < S.files.size(); ++i) {
@@ -311,43 +125,32 @@ static void draw_tree_node(TreeNode& node, ID3D11Device* device) {
 
         if (!S.hide_tooltips && ImGui::IsItemHovered()) {
             ImGui::BeginTooltip();
-            ImGui::Text("%s", node.full_path.c_str());
+            ImGui::Text("%s", tree.full_path(id).c_str());
             ImGui::Text("Size: %u bytes", node.file_size);
-            ImGui::Text("BNK: %s", std::filesystem::path(node.bnk_source).filename().string().c_str());
+            ImGui::Text("BNK: %s", std::filesystem::path(bnk_source).filename().string().c_str());
             ImGui::EndTooltip();
         }
+
+        if (node.is_archive && node_open) {
+            draw_tree_children(tree, id, device);
+            ImGui::TreePop();
+        }
     } else {
         ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_OpenOnArrow | ImGuiTreeNodeFlags_OpenOnDoubleClick | ImGuiTreeNodeFlags_SpanAvailWidth;
 
-        if (node.children.empty()) {
+        if (node.list_state == FT_LISTED && node.child_count == 0) {
             flags |= ImGuiTreeNodeFlags_Leaf;
         }
 
-        bool node_open = ImGui::TreeNodeEx(node.name.c_str(), flags);
+        bool node_open = ImGui::TreeNodeEx(label.c_str(), flags);
 
         if (ImGui::IsItemClicked() && !ImGui::IsItemToggledOpen()) {
             S.selected_file_index = -1;
-            S.selected_folder_path = node.name;
+            S.selected_folder_path = label;
         }
 
         if (node_open) {
-            std::vector<std::pair<std::string, TreeNode*>> sorted_children;
-            for (auto& pair : node.children) {
-                sorted_children.push_back({pair.first, &pair.second});
-            }
-
-            std::sort(sorted_children.begin(), sorted_children.end(),
-                [](const auto& a, const auto& b) {
-                    if (a.second->is_file != b.second->is_file) {
-                        return !a.second->is_file;
-                    }
-                    return a.first < b.first;
-                });
-
-            for (auto& pair : sorted_children) {
-                draw_tree_node(*pair.second, device);
-            }
-
+            draw_tree_children(tree, id, device);
             ImGui::TreePop();
         }
     }
@@ -364,18 +167,7 @@ void draw_left_panel(ID3D11Device* device) {
             }
             ImGui::BeginChild("bnk_list", ImVec2(0, 0), false);
 
-            auto paths = filtered_bnk_paths();
-
-            std::vector<std::string> audio_bnks;
-            std::vector<std::string> other_bnks;
-
-            for (const auto& p : paths) {
-                if (is_in_audio_folder(p)) {
-                    audio_bnks.push_back(p);
-                } else {
-                    other_bnks.push_back(p);
-                }
-            }
+            const auto& rows = filtered_bnk_rows();
 
             if (!S.adb_paths.empty()) {
                 ImGui::PushID("adb_entry");
@@ -393,7 +185,7 @@ void draw_left_panel(ID3D11Device* device) {
                         std::error_code ec;
                         auto fsize = std::filesystem::file_size(fname, ec);
                         uint32_t size = ec ? 0 : (uint32_t)fsize;
-                        S.files.push_back({(int)i, fname, size});
+                        S.files.push_back(make_bnk_item((int)i, fname, size));
                     }
                 }
                 ImGui::PopStyleColor();
@@ -405,13 +197,12 @@ void draw_left_panel(ID3D11Device* device) {
                 ImGui::PopID();
             }
 
-            for (size_t idx = 0; idx < paths.size(); ++idx) {
-                auto &p = paths[idx];
+            for (size_t idx = 0; idx < rows.size(); ++idx) {
+                const std::string p = S.bnk_paths[rows[idx]];
+                std::string_view label_lower = S.bnk_names[rows[idx]].text;
                 ImGui::PushID((int)idx);
 
                 std::string label = std::filesystem::path(p).filename().string();
-                std::string label_lower = label;
-                std::transform(label_lower.begin(), label_lower.end(), label_lower.begin(), ::tolower);
 
                 bool is_nested_bnk = (label_lower == "levels.bnk" || label_lower == "streaming.bnk");
                 bool is_expanded = S.expanded_bnks.count(p) > 0;
@@ -447,9 +238,7 @@ void draw_left_panel(ID3D11Device* device) {
                         const auto& files = reader.list_files();
                         for (size_t i = 0; i < files.size(); ++i) {
                             const auto& file = files[i];
-                            std::string fname_lower = file.name;
-                            std::transform(fname_lower.begin(), fname_lower.end(), fname_lower.begin(), ::tolower);
-                            if (fname_lower.size() >= 4 && fname_lower.substr(fname_lower.size() - 4) == ".bnk") {
+                            if (classify_asset(file.name) == AssetType::Bnk) {
                                 ImGui::PushID((int)i + 100000);
                                 std::string nested_label = "    " + std::filesystem::path(file.name).filename().string();
                                 bool nested_selected = (S.selected_nested_bnk == p && S.selected_nested_index == (int)i);
@@ -475,16 +264,10 @@ void draw_left_panel(ID3D11Device* device) {
                                     const auto& nested_files = nested_reader.list_files();
                                     S.files.reserve(nested_files.size());
                                     for (size_t j = 0; j < nested_files.size(); ++j) {
-                                        S.files.push_back({(int)j, nested_files[j].name, nested_files[j].uncompressed_size});
+                                        S.files.push_back(make_bnk_item((int)j, nested_files[j].name, nested_files[j].uncompressed_size));
                                     }
 
-                                    std::sort(S.files.begin(), S.files.end(), [](const BNKItemUI &a, const BNKItemUI &b) {
-                                        std::string x = std::filesystem::path(a.name).filename().string();
-                                        std::string y = std::filesystem::path(b.name).filename().string();
-                                        std::transform(x.begin(), x.end(), x.begin(), ::tolower);
-                                        std::transform(y.begin(), y.end(), y.begin(), ::tolower);
-                                        return x < y;
-                                    });
+                                    sort_files_by_basename(S.files);
                                 }
                                 if (!S.hide_tooltips && ImGui::IsItemHovered()) {
                                     ImGui::BeginTooltip();
@@ -506,58 +289,89 @@ void draw_left_panel(ID3D11Device* device) {
         if (ImGui::BeginTabItem("File Tree")) {
             ImGui::BeginChild("file_tree", ImVec2(0, 0), false);
 
-            static TreeNode root;
+            static FileTree building;
+            static uint32_t built_gen = 0;
+            static uint32_t built_reset_gen = 0;
             static bool tree_built = false;
             static bool tree_building = false;
             static std::atomic<bool> build_complete(false);
             static float build_start_time = 0.0f;
 
+            if (!tree_building && tree_built && built_gen != S.catalog_gen) {
+                if (built_reset_gen != S.catalog_reset_gen || g_file_tree.nodes.empty()) {
+                    tree_built = false;
+                } else {
+                    // Only some archives changed: relist those in the background
+                    // and keep showing the current tree until it is ready.
+                    std::vector<std::string> changed;
+                    for (const auto& c : S.catalog_changes)
+                        if (c.first > built_gen) changed.push_back(c.second);
+                    tree_building = true;
+                    build_complete = false;
+                    built_gen = S.catalog_gen;
+
+                    FileTree* tree_ptr = &building;
+                    std::atomic<bool>* complete_ptr = &build_complete;
+                    std::vector<std::string> paths = S.bnk_paths;
+                    FileTreeSnapshot prev = file_tree_snapshot(g_file_tree);
+
+                    std::thread([tree_ptr, complete_ptr, paths, prev, changed]() {
+                        refresh_unified_file_tree(*tree_ptr, prev, paths, changed);
+                        complete_ptr->store(true);
+                    }).detach();
+                }
+            }
+
             if (!tree_built && !tree_building && !S.bnk_paths.empty()) {
                 tree_building = true;
                 build_complete = false;
                 build_start_time = ImGui::GetTime();
+                built_gen = S.catalog_gen;
+                built_reset_gen = S.catalog_reset_gen;
 
-                TreeNode* root_ptr = &root;
+                FileTree* tree_ptr = &building;
                 std::atomic<bool>* complete_ptr = &build_complete;
+                std::vector<std::string> paths = S.bnk_paths;
 
-                std::thread([root_ptr, complete_ptr]() {
-                    build_unified_file_tree(*root_ptr);
+                std::thread([tree_ptr, complete_ptr, paths]() {
+                    build_unified_file_tree(*tree_ptr, paths);
                     complete_ptr->store(true);
                 }).detach();
             }
 
-            if (tree_building) {
-                if (build_complete) {
-                    tree_building = false;
-                    tree_built = true;
-                } else {
-                    ImVec2 avail = ImGui::GetContentRegionAvail();
-                    float elapsed = ImGui::GetTime() - build_start_time;
-
-                    float dot_cycle = fmodf(elapsed * 2.0f, 4.0f);
-                    int dot_count = (int)dot_cycle;
-                    std::string dots(dot_count, '.');
-                    std::string loading_text = "Loading file tree" + dots;
-
-                    ImVec2 text_size = ImGui::CalcTextSize(loading_text.c_str());
-                    ImVec2 pos((avail.x - text_size.x) * 0.5f, (avail.y - text_size.y) * 0.5f);
-                    if (pos.x < 0) pos.x = 0;
-                    if (pos.y < 0) pos.y = 0;
-                    ImGui::SetCursorPos(pos);
-                    ImGui::TextUnformatted(loading_text.c_str());
-
-                    if (elapsed > 10.0f) {
-                        ImVec2 warning_size = ImGui::CalcTextSize("(this may take some time)");
-                        ImVec2 warning_pos((avail.x - warning_size.x) * 0.5f, pos.y + text_size.y + 10.0f);
-                        if (warning_pos.x < 0) warning_pos.x = 0;
-                        ImGui::SetCursorPos(warning_pos);
-                        ImGui::TextUnformatted("(this may take some time)");
-                    }
-                }
-            } else if (tree_built) {
-                for (auto& pair : root.children) {
-                    draw_tree_node(pair.second, device);
+            if (tree_building && build_complete) {
+                g_file_tree = std::move(building);
+                building.clear();
+                tree_building = false;
+                tree_built = true;
+            }
+
+            if (tree_building && !tree_built) {
+                ImVec2 avail = ImGui::GetContentRegionAvail();
+                float elapsed = ImGui::GetTime() - build_start_time;
+
+                float dot_cycle = fmodf(elapsed * 2.0f, 4.0f);
+                int dot_count = (int)dot_cycle;
+                std::string dots(dot_count, '.');
+                std::string loading_text = "Loading file tree" + dots;
+
+                ImVec2 text_size = ImGui::CalcTextSize(loading_text.c_str());
+                ImVec2 pos((avail.x - text_size.x) * 0.5f, (avail.y - text_size.y) * 0.5f);
+                if (pos.x < 0) pos.x = 0;
+                if (pos.y < 0) pos.y = 0;
+                ImGui::SetCursorPos(pos);
+                ImGui::TextUnformatted(loading_text.c_str());
+
+                if (elapsed > 10.0f) {
+                    ImVec2 warning_size = ImGui::CalcTextSize("(this may take some time)");
+                    ImVec2 warning_pos((avail.x - warning_size.x) * 0.5f, pos.y + text_size.y + 10.0f);
+                    if (warning_pos.x < 0) warning_pos.x = 0;
+                    ImGui::SetCursorPos(warning_pos);
+                    ImGui::TextUnformatted("(this may take some time)");
                 }
+            } else if (tree_built && !g_file_tree.nodes.empty()) {
+                file_tree_poll(g_file_tree);
+                draw_tree_children(g_file_tree, 0, device);
             }
 
             ImGui::EndChild();
@@ -570,11 +384,51 @@ void draw_left_panel(ID3D11Device* device) {
     ImGui::EndChild();
 }
 
+// The file filter as typed, split and folded once per frame by each list
+// that draws: the name text plus any texture metadata terms ("fmt:bc3
+// size>=1024"), which only textures in the metadata index pass.
+struct FileFilter {
+    std::string folded_name;
+    TexMetaFilter meta;
+    bool empty = true;
+};
+
+static FileFilter prepare_file_filter(const std::string &filter) {
+    FileFilter f;
+    if (filter.empty()) return f;
+    std::string name_part;
+    f.meta = tex_meta_parse_filter(filter, name_part);
+    f.folded_name = fold_case(name_part);
+    f.empty = false;
+    return f;
+}
+
+static bool file_matches(const FileFilter &f, std::string_view folded) {
+    if (f.empty) return true;
+    return folded_contains(folded, f.folded_name) && tex_meta_matches(S.catalog_gen, f.meta, folded);
+}
+
+static int count_visible_files(const FileFilter &f) {
+    if (f.empty) return (int) S.files.size();
+    int c = 0;
+    for (auto &file: S.files) if (file_matches(f, file.folded.text)) ++c;
+    return c;
+}
+
+// Metadata terms match nothing until the texture header index is built.
+static void draw_tex_meta_hint(const FileFilter &f) {
+    if (f.meta.empty() || tex_meta_index_ready(S.catalog_gen)) return;
+    tex_meta_request(S.catalog_gen, S.bnk_paths);
+    ImGui::TextDisabled("Indexing texture headers...");
+}
+
 void draw_file_table() {
+    FileFilter filter = prepare_file_filter(S.file_filter);
     std::vector<int> vis;
     vis.reserve(S.files.size());
     for (size_t i = 0; i < S.files.size(); ++i)
-        if (name_matches_filter(S.files[i].name, S.file_filter)) vis.push_back((int) i);
+        if (file_matches(filter, S.files[i].folded.text)) vis.push_back((int) i);
+    draw_tex_meta_hint(filter);
 
     ImGuiTable *tbl_ptr = nullptr;
     if (ImGui::BeginTable("files_table", 2,
@@ -617,19 +471,151 @@ void draw_file_table() {
     }
 }
 
+// GPU copies of atlas thumbnails for the grid, made on first sight and
+// dropped together when the BNK or catalog changes.
+struct ThumbSrv {
+    ID3D11ShaderResourceView* srv = nullptr;
+    int w = 0, h = 0;
+};
+static std::unordered_map<std::string, ThumbSrv> g_thumb_srvs;
+static std::string g_thumb_bnk;
+static uint32_t g_thumb_gen = 0;
+static uint64_t g_thumb_list_hash = 0;
+
+static void release_thumb_srvs() {
+    for (auto& kv : g_thumb_srvs)
+        if (kv.second.srv) kv.second.srv->Release();
+    g_thumb_srvs.clear();
+}
+
+// Uploads at most `budget` thumbnails per frame so a full atlas does not
+// stall the first frame of the grid.
+static const ThumbSrv* thumb_srv(ID3D11Device* device, const std::string& name, int& budget) {
+    auto it = g_thumb_srvs.find(name);
+    if (it != g_thumb_srvs.end()) return &it->second;
+    if (budget <= 0) return nullptr;
+
+    std::vector<uint8_t> rgba;
+    int w = 0, h = 0;
+    ThumbState st = thumb_fetch(name, rgba, w, h);
+    if (st == ThumbState::Failed) return &(g_thumb_srvs[name] = ThumbSrv{});
+    // Evicted from the atlas before it was shown: queue the list again.
+    if (st == ThumbState::Missing) g_thumb_list_hash = 0;
+    if (st != ThumbState::Ready) return nullptr;
+    --budget;
+
+    ThumbSrv t{nullptr, w, h};
+    D3D11_TEXTURE2D_DESC td{};
+    td.Width = (UINT)w; td.Height = (UINT)h; td.MipLevels = 1; td.ArraySize = 1; td.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    td.SampleDesc.Count = 1; td.Usage = D3D11_USAGE_IMMUTABLE; td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    D3D11_SUBRESOURCE_DATA sd{}; sd.pSysMem = rgba.data(); sd.SysMemPitch = (UINT)(w * 4);
+    ID3D11Texture2D* tex = nullptr;
+    if (device->CreateTexture2D(&td, &sd, &tex) == S_OK) {
+        device->CreateShaderResourceView(tex, nullptr, &t.srv);
+        tex->Release();
+    }
+    return &(g_thumb_srvs[name] = t);
+}
+
+static void draw_thumb_grid(ID3D11Device* device) {
+    FileFilter filter = prepare_file_filter(S.file_filter);
+    std::vector<int> vis;
+    vis.reserve(S.files.size());
+    for (size_t i = 0; i < S.files.size(); ++i)
+        if (S.files[i].type == AssetType::Tex && file_matches(filter, S.files[i].folded.text))
+            vis.push_back((int) i);
+    draw_tex_meta_hint(filter);
+
+    if (g_thumb_bnk != S.selected_bnk || g_thumb_gen != S.catalog_gen) {
+        if (g_thumb_gen != S.catalog_gen) thumb_reset();
+        release_thumb_srvs();
+        g_thumb_bnk = S.selected_bnk;
+        g_thumb_gen = S.catalog_gen;
+        g_thumb_list_hash = 0;
+    }
+    if (g_thumb_srvs.size() > 4096) release_thumb_srvs();
+    // Generate in list order whenever the visible list changes. The names
+    // are hashed, not counted: a new filter can show as many files as the old.
+    uint64_t list_hash = 1469598103934665603ull;  // FNV-1a
+    for (int i : vis) {
+        for (unsigned char ch : S.files[(size_t) i].name) list_hash = (list_hash ^ ch) * 1099511628211ull;
+        list_hash = (list_hash ^ 0xFFu) * 1099511628211ull;
+    }
+    if (g_thumb_list_hash != list_hash) {
+        g_thumb_list_hash = list_hash;
+        std::vector<std::string> names;
+        names.reserve(vis.size());
+        for (int i : vis) names.push_back(S.files[(size_t) i].name);
+        thumb_queue(names);
+    }
+
+    const ImGuiStyle& style = ImGui::GetStyle();
+    const float cell = (float) THUMB_SIZE + 8.0f;
+    const float label_h = ImGui::GetTextLineHeightWithSpacing();
+    const int cols = std::max(1, (int) ((ImGui::GetContentRegionAvail().x + style.ItemSpacing.x) / (cell + style.ItemSpacing.x)));
+    const int rows = ((int) vis.size() + cols - 1) / cols;
+    int budget = 32;
+
+    ImDrawList* dl = ImGui::GetWindowDrawList();
+    ImGuiListClipper clipper;
+    clipper.Begin(rows, cell + label_h + style.ItemSpacing.y);
+    while (clipper.Step()) {
+        for (int r = clipper.DisplayStart; r < clipper.DisplayEnd; ++r) {
+            for (int c = 0; c < cols; ++c) {
+                size_t k = (size_t) r * cols + c;
+                if (k >= vis.size()) break;
+                int i = vis[k];
+                const std::string& name = S.files[(size_t) i].name;
+
+                ImGui::PushID(i);
+                if (c) ImGui::SameLine();
+                ImVec2 pos = ImGui::GetCursorScreenPos();
+                if (ImGui::Selectable("##thumb", i == S.selected_file_index, 0, ImVec2(cell, cell + label_h)))
+                    S.selected_file_index = i;
+                if (!S.hide_tooltips && ImGui::IsItemHovered()) {
+                    ImGui::BeginTooltip();
+                    ImGui::TextUnformatted(name.c_str());
+                    ImGui::EndTooltip();
+                }
+
+                const ThumbSrv* t = thumb_srv(device, name, budget);
+                ImVec2 box(pos.x + 4.0f, pos.y + 4.0f);
+                if (t && t->srv) {
+                    float scale = (float) THUMB_SIZE / (float) std::max(t->w, t->h);
+                    float w = t->w * scale, h = t->h * scale;
+                    ImVec2 p0(box.x + ((float) THUMB_SIZE - w) * 0.5f, box.y + ((float) THUMB_SIZE - h) * 0.5f);
+                    dl->AddImage((ImTextureID) t->srv, p0, ImVec2(p0.x + w, p0.y + h));
+                } else {
+                    dl->AddRect(box, ImVec2(box.x + THUMB_SIZE, box.y + THUMB_SIZE), ImGui::GetColorU32(ImGuiCol_Border));
+                    dl->AddText(ImVec2(box.x + 6.0f, box.y + 6.0f), ImGui::GetColorU32(ImGuiCol_TextDisabled), t ? "n/a" : "...");
+                }
+
+                std::string base = std::filesystem::path(name).filename().string();
+                ImVec4 clip(pos.x, pos.y, pos.x + cell, pos.y + cell + label_h);
+                dl->AddText(nullptr, 0.0f, ImVec2(pos.x + 4.0f, pos.y + cell), ImGui::GetColorU32(ImGuiCol_Text),
+                            base.c_str(), nullptr, 0.0f, &clip);
+                ImGui::PopID();
+            }
+        }
+    }
+    clipper.End();
+}
+
 void draw_global_results_table() {
     if (g_global_busy) {
         ImGui::TextUnformatted("Searching all BNKs...");
         return;
     }
 
+    FileFilter filter = prepare_file_filter(S.file_filter);
     std::vector<int> vis;
     vis.reserve(g_global_hits.size());
     for (size_t i = 0; i < g_global_hits.size(); ++i) {
-        if (name_matches_filter(g_global_hits[i].file_name, S.file_filter)) {
+        if (file_matches(filter, g_global_hits[i].folded.text)) {
             vis.push_back((int)i);
         }
     }
+    draw_tex_meta_hint(filter);
 
     ImGuiTable *tbl_ptr = nullptr;
     if (ImGui::BeginTable("global_results_table", 3,
@@ -763,7 +749,7 @@ void draw_right_panel(ID3D11Device* device) {
         bool has_wav_files = false;
         if (!S.global_search.empty()) {
             for (const auto& h : g_global_hits) {
-                if (is_audio_file(h.file_name)) {
+                if (h.type == AssetType::Wav) {
                     has_wav_files = true;
                     break;
                 }
@@ -792,7 +778,7 @@ void draw_right_panel(ID3D11Device* device) {
         bool has_tex_files = false;
         if (!S.global_search.empty()) {
             for (const auto& h : g_global_hits) {
-                if (is_tex_file(h.file_name)) {
+                if (h.type == AssetType::Tex) {
                     has_tex_files = true;
                     break;
                 }
@@ -816,12 +802,24 @@ void draw_right_panel(ID3D11Device* device) {
                 ImGui::TextUnformatted("Rebuilds every .tex file bitstream");
                 ImGui::EndTooltip();
             }
+            ImGui::SameLine();
+            static const char *tex_formats[] = {".tex", ".dds", ".png", ".qoi"};
+            int tex_fmt = (int) S.tex_export_format;
+            ImGui::SetNextItemWidth(70);
+            if (ImGui::Combo("##tex_export_format", &tex_fmt, tex_formats, IM_ARRAYSIZE(tex_formats))) {
+                S.tex_export_format = (TexExportFormat) tex_fmt;
+            }
+            if (!S.hide_tooltips && ImGui::IsItemHovered()) {
+                ImGui::BeginTooltip();
+                ImGui::TextUnformatted("Texture output: the game's .tex, a DDS holding every mip,\nor the largest mip as PNG (small) or QOI (fast)");
+                ImGui::EndTooltip();
+            }
         }
 
         bool has_mdl_files = false;
         if (!S.global_search.empty()) {
             for (const auto& h : g_global_hits) {
-                if (is_mdl_file(h.file_name)) {
+                if (h.type == AssetType::Mdl) {
                     has_mdl_files = true;
                     break;
                 }
@@ -850,10 +848,7 @@ void draw_right_panel(ID3D11Device* device) {
         if (S.selected_file_index >= 0) {
             bool can_wav = false;
             if (S.selected_file_index >= 0 && S.selected_file_index < (int) S.files.size()) {
-                std::string n = S.files[(size_t) S.selected_file_index].name;
-                std::string l = n;
-                std::transform(l.begin(), l.end(), l.begin(), ::tolower);
-                can_wav = l.size() >= 4 && l.rfind(".wav") == l.size() - 4;
+                can_wav = S.files[(size_t) S.selected_file_index].type == AssetType::Wav;
             }
             if (can_wav) {
                 ImGui::SameLine();
@@ -864,11 +859,9 @@ void draw_right_panel(ID3D11Device* device) {
             }
             bool can_tex = false, can_mdl = false;
             if (S.selected_file_index >= 0 && S.selected_file_index < (int) S.files.size()) {
-                std::string n = S.files[(size_t) S.selected_file_index].name;
-                std::string l = n;
-                std::transform(l.begin(), l.end(), l.begin(), ::tolower);
-                can_tex = l.size() >= 4 && l.rfind(".tex") == l.size() - 4;
-                can_mdl = l.size() >= 4 && l.rfind(".mdl") == l.size() - 4;
+                AssetType t = S.files[(size_t) S.selected_file_index].type;
+                can_tex = t == AssetType::Tex;
+                can_mdl = t == AssetType::Mdl;
             }
 
             if (can_tex && is_texture_bnk_selected()) {
@@ -975,15 +968,13 @@ void draw_right_panel(ID3D11Device* device) {
     bool can_folder_preview = false;
 
     if (has_selection && !S.viewing_adb) {
-        std::string n = S.files[(size_t)S.selected_file_index].name;
-        std::string l = n;
-        std::transform(l.begin(), l.end(), l.begin(), ::tolower);
-        can_tex = l.size() >= 4 && l.rfind(".tex") == l.size() - 4;
-        can_mdl = l.size() >= 4 && l.rfind(".mdl") == l.size() - 4;
+        AssetType t = S.files[(size_t)S.selected_file_index].type;
+        can_tex = t == AssetType::Tex;
+        can_mdl = t == AssetType::Mdl;
         can_preview = can_tex || can_mdl;
     } else if (!S.selected_folder_path.empty()) {
         std::vector<std::pair<std::string, std::string>> mdl_paths;
-        can_folder_preview = find_mdl_files_in_folder(g_tree_root, S.selected_folder_path, mdl_paths);
+        can_folder_preview = find_mdl_files_in_folder(g_file_tree, S.selected_folder_path, mdl_paths);
         can_preview = can_folder_preview;
     }
 
@@ -993,7 +984,7 @@ if (!can_preview) {
     if (ImGui::Button("Preview")) {
         if (can_folder_preview && !S.selected_folder_path.empty()) {
             std::vector<std::pair<std::string, std::string>> mdl_paths;
-            if (find_mdl_files_in_folder(g_tree_root, S.selected_folder_path, mdl_paths)) {
+            if (find_mdl_files_in_folder(g_file_tree, S.selected_folder_path, mdl_paths)) {
                 progress_open(0, "Loading preview...");
 
                 ID3D11Device* device_ptr = device;
@@ -1002,6 +993,7 @@ if (!can_preview) {
                     std::vector<MDLMeshGeom> all_meshes;
                     MDLInfo combined_info;
                     bool any_success = false;
+                    MDLView view;
 
                     for (const auto& [mdl_path, bnk_source] : mdl_paths) {
                         std::vector<unsigned char> buf;
@@ -1011,16 +1003,16 @@ if (!can_preview) {
                             ok = build_mdl_buffer_for_name(mdl_path, buf);
                         } catch (...) {}
 
-                        if (ok && !buf.empty()) {
-                            MDLInfo mdl_info;
-                            if (parse_mdl_info(buf, mdl_info, mdl_path)) {
-                                std::vector<MDLMeshGeom> meshes;
-                                if (parse_mdl_geometry(buf, mdl_info, meshes)) {
-                                    all_meshes.insert(all_meshes.end(), meshes.begin(), meshes.end());
-                                    if (!any_success) {
-                                        combined_info = mdl_info;
-                                        any_success = true;
-                                    }
+                        // Only the first model's header is kept, so the rest are read
+                        // through a view that copies nothing.
+                        if (ok && !buf.empty() && parse_mdl_view(buf.data(), buf.size(), view, mdl_path)) {
+                            std::vector<MDLMeshGeom> meshes;
+                            if (parse_mdl_geometry(view, meshes)) {
+                                all_meshes.insert(all_meshes.end(), std::make_move_iterator(meshes.begin()),
+                                                  std::make_move_iterator(meshes.end()));
+                                if (!any_success) {
+                                    mdl_view_to_info(view, combined_info);
+                                    any_success = true;
                                 }
                             }
                         }
@@ -1092,6 +1084,7 @@ if (!can_preview) {
                         std::vector<MDLMeshGeom> all_meshes;
                         MDLInfo combined_info;
                         bool any_success = false;
+                        MDLView view;
 
                         for (const auto& [mdl_name, mdl_index] : mdl_files) {
                             std::vector<unsigned char> buf;
@@ -1101,16 +1094,16 @@ if (!can_preview) {
                                 ok = build_mdl_buffer_for_name(mdl_name, buf);
                             } catch (...) {}
 
-                            if (ok && !buf.empty()) {
-                                MDLInfo mdl_info;
-                                if (parse_mdl_info(buf, mdl_info, mdl_name)) {
-                                    std::vector<MDLMeshGeom> meshes;
-                                    if (parse_mdl_geometry(buf, mdl_info, meshes)) {
-                                        all_meshes.insert(all_meshes.end(), meshes.begin(), meshes.end());
-                                        if (!any_success) {
-                                            combined_info = mdl_info;
-                                            any_success = true;
-                                        }
+                            // Only the first model's header is kept, so the rest are read
+                            // through a view that copies nothing.
+                            if (ok && !buf.empty() && parse_mdl_view(buf.data(), buf.size(), view, mdl_name)) {
+                                std::vector<MDLMeshGeom> meshes;
+                                if (parse_mdl_geometry(view, meshes)) {
+                                    all_meshes.insert(all_meshes.end(), std::make_move_iterator(meshes.begin()),
+                                                      std::make_move_iterator(meshes.end()));
+                                    if (!any_success) {
+                                        mdl_view_to_info(view, combined_info);
+                                        any_success = true;
                                     }
                                 }
                             }
@@ -1182,16 +1175,42 @@ if (!can_preview) {
         }
 
         progress_open(0, "Loading preview...");
+        uint64_t ticket = ++S.preview_ticket;
 
-        std::thread([device, item, name, can_tex, can_mdl, bnk_to_use, nested_temp_copy, is_nested]() {
+        std::thread([device, item, name, can_tex, can_mdl, bnk_to_use, nested_temp_copy, is_nested, ticket]() {
             std::vector<unsigned char> buf;
             bool ok = false;
+            bool staged = false;
             try {
                 if (can_tex) {
-                    ok = build_any_tex_buffer_for_name(name, buf);
+                    // Small mips go up as soon as header and body are in; the
+                    // popup sharpens when mip0 follows. The full texture goes
+                    // to the shared cache for model previews and exports.
+                    auto publish = [&](std::vector<unsigned char> &stage_buf, const TexInfo &ti, bool final) {
+                        if (S.preview_ticket != ticket || S.exiting) return false;
+                        if (final) tex_cache_put_blob(name, stage_buf);
+                        {
+                            std::lock_guard<std::mutex> lk(S.preview_stage_mutex);
+                            S.preview_stage_data.swap(stage_buf);
+                            S.preview_stage_info = ti;
+                            if (!ok) S.preview_stage_first = true;
+                            S.preview_stage_ready = true;
+                        }
+                        if (!ok) progress_done();
+                        ok = true;
+                        return true;
+                    };
+                    if (TexBlobPtr cached = tex_cache_peek_blob(name)) {
+                        std::vector<unsigned char> whole(*cached);
+                        TexInfo ti;
+                        staged = parse_tex_info(whole, ti) && publish(whole, ti, true);
+                    } else {
+                        staged = build_any_tex_buffer_progressive(name, publish);
+                    }
+                    ok = staged;
                 } else if (can_mdl) {
                     if (is_nested) {
-                        ok = reconstruct_nested_mdl(bnk_to_use, item.index, buf);
+                        ok = build_nested_mdl_buffer(bnk_to_use, item.index, buf);
                     } else {
                         ok = build_mdl_buffer_for_name(name, buf);
                     }
@@ -1222,29 +1241,15 @@ if (!can_preview) {
                 std::filesystem::remove(nested_temp_copy, ec);
             }
 
-            if (ok) {
+            if (ok && !staged) {
                 S.hex_data = buf;
 
                 if (can_tex) {
                     S.tex_info_ok = parse_tex_info(S.hex_data, S.tex_info);
-                    if (S.tex_info_ok && !S.tex_info.Mips.empty()) {
-                        int best_mip = -1;
-                        size_t best_area = 0;
-                        for (int i = 0; i < (int)S.tex_info.Mips.size(); ++i) {
-                            if (S.tex_info.Mips[i].CompFlag == 7) {
-                                int w = S.tex_info.Mips[i].HasWH ? (int)S.tex_info.Mips[i].MipWidth : std::max(1, (int)S.tex_info.TextureWidth >> i);
-                                int h = S.tex_info.Mips[i].HasWH ? (int)S.tex_info.Mips[i].MipHeight : std::max(1, (int)S.tex_info.TextureHeight >> i);
-                                size_t area = (size_t)w * (size_t)h;
-                                if (area > best_area) {
-                                    best_area = area;
-                                    best_mip = i;
-                                }
-                            }
-                        }
-                        if (best_mip >= 0) {
-                            S.preview_mip_index = best_mip;
-                            S.show_preview_popup = true;
-                        }
+                    int best_mip = S.tex_info_ok ? largest_raw_mip(S.tex_info) : -1;
+                    if (best_mip >= 0) {
+                        S.preview_mip_index = best_mip;
+                        S.show_preview_popup = true;
                     }
                 } else if (can_mdl) {
                     S.mdl_info_ok = parse_mdl_info(S.hex_data, S.mdl_info, name);
@@ -1278,7 +1283,7 @@ if (!can_preview) {
     bool has_mdl_files = false;
     if (!S.global_search.empty()) {
         for (const auto& h : g_global_hits) {
-            if (is_mdl_file(h.file_name)) {
+            if (h.type == AssetType::Mdl) {
                 has_mdl_files = true;
                 break;
             }
@@ -1311,10 +1316,7 @@ if (!can_preview) {
 
     bool can_export_mdl = false;
     if (has_selection && !S.viewing_adb) {
-        std::string n = S.files[(size_t)S.selected_file_index].name;
-        std::string l = n;
-        std::transform(l.begin(), l.end(), l.begin(), ::tolower);
-        can_export_mdl = l.size() >= 4 && l.rfind(".mdl") == l.size() - 4;
+        can_export_mdl = S.files[(size_t)S.selected_file_index].type == AssetType::Mdl;
     }
 
     if (!can_export_mdl) {
@@ -1333,13 +1335,49 @@ if (!can_preview) {
         ImGui::EndDisabled();
     }
 
+    ImGui::SameLine();
+    ImGui::Checkbox("Optimize", &S.glb_optimize_meshes);
+    if (!S.hide_tooltips && ImGui::IsItemHovered()) {
+        ImGui::BeginTooltip();
+        ImGui::TextUnformatted("Weld duplicate vertices and reorder triangles for the\nvertex cache and overdraw in exported GLBs");
+        ImGui::EndTooltip();
+    }
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(70);
+    ImGui::SliderInt("LODs", &S.glb_lod_levels, 0, 4);
+    if (!S.hide_tooltips && ImGui::IsItemHovered()) {
+        ImGui::BeginTooltip();
+        ImGui::TextUnformatted("Simplified levels of detail written into each GLB (MSFT_lod)");
+        ImGui::EndTooltip();
+    }
+    if (S.glb_lod_levels > 0) {
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(70);
+        ImGui::SliderFloat("Ratio", &S.glb_lod_ratio, 0.1f, 0.9f, "%.2f");
+        if (!S.hide_tooltips && ImGui::IsItemHovered()) {
+            ImGui::BeginTooltip();
+            ImGui::TextUnformatted("Share of triangles each level keeps from the one before");
+            ImGui::EndTooltip();
+        }
+    }
+
     ImGui::PopStyleVar();
     ImGui::EndGroup();
 
     static bool hide_tt = false;
     if (ImGui::Checkbox("Hide Paths Tooltip", &hide_tt)) { S.hide_tooltips = hide_tt; }
+    ImGui::SameLine();
+    if (ImGui::Checkbox("Watch Folder", &S.watch_root)) {
+        if (S.watch_root && !S.root_dir.empty()) watcher_start(S.root_dir);
+        else watcher_stop();
+    }
+    if (!S.hide_tooltips && ImGui::IsItemHovered()) {
+        ImGui::BeginTooltip();
+        ImGui::TextUnformatted("Pick up added, removed or rebuilt BNK/ADB files without rescanning");
+        ImGui::EndTooltip();
+    }
 
-    int visible = count_visible_files();
+    int visible = count_visible_files(prepare_file_filter(S.file_filter));
     ImGui::Text("Files found: %d/%d", visible, (int) S.files.size());
 
     ImGui::PopItemWidth();
@@ -1351,11 +1389,22 @@ if (!can_preview) {
 
     ImGui::SetNextItemWidth(field_width);
     ImGui::InputTextWithHint("##file_filter", S.viewing_adb ? "Filter ADB Files" : "Filter Current BNK", &S.file_filter);
+    if (!S.hide_tooltips && ImGui::IsItemHovered()) {
+        ImGui::BeginTooltip();
+        ImGui::TextUnformatted("Textures also filter on fmt:bc1/bc3/bc5, w, h, size and mips,\ne.g. \"fmt:bc3 size>=1024\"");
+        ImGui::EndTooltip();
+    }
 
     ImGui::SameLine();
     ImGui::SetNextItemWidth(field_width);
     bool search_changed = ImGui::InputTextWithHint("##global_search", "Search All BNKs", &S.global_search);
 
+    // Archives changed on disk since the results were gathered: search again.
+    if (g_global_search_gen != S.catalog_gen && !g_global_busy) {
+        g_global_search_gen = S.catalog_gen;
+        g_last_global_search.clear();
+    }
+
     if (S.global_search != g_last_global_search) {
         g_last_global_search = S.global_search;
         g_global_hits.clear();
@@ -1366,84 +1415,13 @@ if (!can_preview) {
             if (!g_global_busy) {
                 g_global_busy = true;
                 std::string search_term = S.global_search;
+                std::vector<std::string> paths = S.bnk_paths;
+                uint32_t gen = S.catalog_gen;
 
-                std::thread([search_term]() {
+                std::thread([search_term, paths, gen]() {
                     std::vector<GlobalHit> local_hits;
-                    std::string needle = search_term;
-                    std::transform(needle.begin(), needle.end(), needle.begin(), ::tolower);
-
-                    auto is_header_bnk = [](const std::string& bnk_path) -> bool {
-                        std::string lower_path = bnk_path;
-                        std::transform(lower_path.begin(), lower_path.end(), lower_path.begin(), ::tolower);
-                        std::string filename = std::filesystem::path(lower_path).filename().string();
-                        return filename.find("header") != std::string::npos;
-                    };
-
-                    auto is_nested_bnk = [](const std::string& filename) -> bool {
-                        std::string lower = filename;
-                        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
-                        return lower.size() >= 4 && lower.substr(lower.size() - 4) == ".bnk";
-                    };
-
                     try {
-                        for (const auto& bnk_path : S.bnk_paths) {
-                            if (is_header_bnk(bnk_path)) {
-                                continue;
-                            }
-
-                            BNKReader reader(bnk_path);
-                            const auto& files = reader.list_files();
-
-                            for (size_t i = 0; i < files.size(); ++i) {
-                                std::string fname = files[i].name;
-                                std::string fname_lower = fname;
-                                std::transform(fname_lower.begin(), fname_lower.end(), fname_lower.begin(), ::tolower);
-
-                                if (fname_lower.find(needle) != std::string::npos) {
-                                    local_hits.push_back({
-                                        bnk_path,
-                                        fname,
-                                        (int)i,
-                                        files[i].uncompressed_size
-                                    });
-                                }
-
-                                if (is_nested_bnk(fname)) {
-                                    try {
-                                        auto tmpdir = std::filesystem::temp_directory_path() / "f2_global_search_nested";
-                                        std::error_code ec;
-                                        std::filesystem::create_directories(tmpdir, ec);
-
-                                        std::string temp_name = "search_nested_" + std::to_string(std::hash<std::string>{}(bnk_path + fname)) + ".bnk";
-                                        auto temp_bnk_path = tmpdir / temp_name;
-
-                                        extract_one(bnk_path, (int)i, temp_bnk_path.string());
-
-                                        BNKReader nested_reader(temp_bnk_path.string());
-                                        const auto& nested_files = nested_reader.list_files();
-
-                                        std::filesystem::path nested_parent = std::filesystem::path(fname).parent_path();
-                                        std::string prefix = nested_parent.empty() ? "" : nested_parent.string() + "/";
-
-                                        for (size_t j = 0; j < nested_files.size(); ++j) {
-                                            const auto& nested_file = nested_files[j];
-                                            std::string nested_fname = prefix + nested_file.name;
-                                            std::string nested_fname_lower = nested_fname;
-                                            std::transform(nested_fname_lower.begin(), nested_fname_lower.end(), nested_fname_lower.begin(), ::tolower);
-
-                                            if (nested_fname_lower.find(needle) != std::string::npos) {
-                                                local_hits.push_back({
-                                                    temp_bnk_path.string(),
-                                                    nested_fname,
-                                                    (int)j,
-                                                    nested_files[j].uncompressed_size
-                                                });
-                                            }
-                                        }
-                                    } catch (...) {}
-                                }
-                            }
-                        }
+                        local_hits = search_index_query(gen, paths, search_term);
                     } catch (...) {}
 
                     g_global_hits = std::move(local_hits);
@@ -1455,18 +1433,51 @@ if (!can_preview) {
 
     if (!S.hide_tooltips && ImGui::IsItemHovered()) {
         ImGui::BeginTooltip();
-        ImGui::TextUnformatted("Type to search across all BNK files");
+        ImGui::TextUnformatted("Type to search across all BNK files\nTexture terms such as \"fmt:bc3 size>=1024\" work here too");
         ImGui::EndTooltip();
     }
 
+    bool can_grid = S.global_search.empty() && !S.viewing_adb && any_tex_in_bnk();
+    if (can_grid) {
+        ImGui::Checkbox("Thumbnails", &S.show_thumb_grid);
+        if (ImGui::IsItemHovered()) {
+            TexCacheStats cs = tex_cache_stats();
+            ImGui::SetTooltip("Texture cache\nBlobs: %zu (%.1f MB), %llu hits / %llu misses\n"
+                              "Images: %zu (%.1f MB), %llu hits / %llu misses",
+                              cs.blob_count, cs.blob_bytes / 1048576.0, (unsigned long long) cs.blob_hits,
+                              (unsigned long long) cs.blob_misses, cs.image_count, cs.image_bytes / 1048576.0,
+                              (unsigned long long) cs.image_hits, (unsigned long long) cs.image_misses);
+        }
+    }
+
     ImGui::BeginChild("right_table_container", ImVec2(0, 0), false);
     if (!S.global_search.empty()) {
         draw_global_results_table();
+    } else if (can_grid && S.show_thumb_grid) {
+        draw_thumb_grid(device);
     } else {
         draw_file_table();
     }
     ImGui::EndChild();
 
+    {
+        std::lock_guard<std::mutex> lk(S.preview_stage_mutex);
+        if (S.preview_stage_ready) {
+            S.preview_stage_ready = false;
+            S.hex_data.swap(S.preview_stage_data);
+            S.preview_stage_data.clear();
+            S.tex_info = S.preview_stage_info;
+            S.tex_info_ok = true;
+            int best_mip = largest_raw_mip(S.tex_info);
+            if (best_mip >= 0) {
+                S.preview_mip_index = best_mip;
+                if (S.preview_srv) { S.preview_srv->Release(); S.preview_srv = nullptr; }
+                if (S.preview_stage_first) S.show_preview_popup = true;
+            }
+            S.preview_stage_first = false;
+        }
+    }
+
     if(S.show_preview_popup){
         ImGui::OpenPopup("Mip Preview");
         S.show_preview_popup = false;
@@ -1475,6 +1486,14 @@ if (!can_preview) {
     if(ImGui::BeginPopupModal("Mip Preview", nullptr, ImGuiWindowFlags_None)){
         if(S.preview_mip_index >= 0 && S.preview_mip_index < (int)S.tex_info.Mips.size()){
             const auto& m = S.tex_info.Mips[S.preview_mip_index];
+            std::string tex_name;
+            if(S.selected_file_index >= 0 && S.selected_file_index < (int)S.files.size())
+                tex_name = S.files[(size_t)S.selected_file_index].name;
+            bool tiled = !tex_name.empty() && texture_is_tiled(tex_name);
+            if(!tex_name.empty() && ImGui::Checkbox("Tiled (Xbox 360)", &tiled)){
+                set_texture_tiled(tex_name, tiled);
+                if(S.preview_srv) { S.preview_srv->Release(); S.preview_srv = nullptr; }
+            }
             if(!S.preview_srv){
                 uint32_t base_w = S.tex_info.TextureWidth;
                 uint32_t base_h = S.tex_info.TextureHeight;
@@ -1484,34 +1503,33 @@ if (!can_preview) {
                     const uint8_t* src = S.hex_data.data() + m.MipDataOffset;
                     size_t src_sz = m.MipDataSizeParsed;
 
+                    BCFormat bc_fmt = bc_format_from_pixel_format(S.tex_info.PixelFormat);
+                    if(bc_fmt == BCFormat::None) bc_fmt = BCFormat::BC1;
                     DXGI_FORMAT fmt = DXGI_FORMAT_BC1_UNORM;
-                    if(S.tex_info.PixelFormat == 39) fmt = DXGI_FORMAT_BC3_UNORM;
-                    else if(S.tex_info.PixelFormat == 40) fmt = DXGI_FORMAT_BC5_UNORM;
+                    switch(bc_fmt){
+                        case BCFormat::BC2: fmt = DXGI_FORMAT_BC2_UNORM; break;
+                        case BCFormat::BC3: fmt = DXGI_FORMAT_BC3_UNORM; break;
+                        case BCFormat::BC4: fmt = DXGI_FORMAT_BC4_UNORM; break;
+                        case BCFormat::BC5: fmt = DXGI_FORMAT_BC5_UNORM; break;
+                        default: break;
+                    }
 
+                    // Row pitch is whole 4x4 blocks of this format: 8 bytes for
+                    // BC1/BC4, 16 for BC2/BC3/BC5.
                     size_t blocks_x = (w + 3) / 4;
-                    std::vector<uint8_t> payload(src, src + src_sz);
-
-                    for(size_t i = 0; i + 8 <= payload.size(); i += 8) {
-                        uint16_t c0 = (payload[i+0] << 8) | payload[i+1];
-                        uint16_t c1 = (payload[i+2] << 8) | payload[i+3];
-                        uint32_t idx = (payload[i+4] << 24) | (payload[i+5] << 16) | (payload[i+6] << 8) | payload[i+7];
-
-                        payload[i+0] = c0 & 0xFF;
-                        payload[i+1] = (c0 >> 8) & 0xFF;
-                        payload[i+2] = c1 & 0xFF;
-                        payload[i+3] = (c1 >> 8) & 0xFF;
-                        payload[i+4] = idx & 0xFF;
-                        payload[i+5] = (idx >> 8) & 0xFF;
-                        payload[i+6] = (idx >> 16) & 0xFF;
-                        payload[i+7] = (idx >> 24) & 0xFF;
-                    }
+                    std::vector<uint8_t> payload;
+                    if(tiled) x360_untile_bc(bc_fmt, src, src_sz, (int)w, (int)h, payload);
+                    else payload.assign(src, src + src_sz);
+                    // Whole blocks of the mip's own format; the old swap only
+                    // handled 8-byte BC1 blocks.
+                    bc_to_little_endian(bc_fmt, payload.data(), payload.size(), payload.data());
 
                     D3D11_TEXTURE2D_DESC td{};
                     td.Width = w; td.Height = h; td.MipLevels = 1; td.ArraySize = 1; td.Format = fmt;
                     td.SampleDesc.Count = 1; td.Usage = D3D11_USAGE_IMMUTABLE; td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-                    D3D11_SUBRESOURCE_DATA sd{}; sd.pSysMem = payload.data(); sd.SysMemPitch = (UINT)(blocks_x * 8);
+                    D3D11_SUBRESOURCE_DATA sd{}; sd.pSysMem = payload.data(); sd.SysMemPitch = (UINT)(blocks_x * bc_block_bytes(bc_fmt));
                     ID3D11Texture2D* tex = nullptr;
-                    if(device->CreateTexture2D(&td, &sd, &tex) == S_OK){
+                    if(payload.size() >= bc_surface_bytes(bc_fmt, (int)w, (int)h) && device->CreateTexture2D(&td, &sd, &tex) == S_OK){
                         D3D11_SHADER_RESOURCE_VIEW_DESC svd{};
                         svd.Format = td.Format; svd.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D; svd.Texture2D.MipLevels = 1;
                         device->CreateShaderResourceView(tex, &svd, &S.preview_srv); tex->Release();
@@ -1525,6 +1543,7 @@ if (!can_preview) {
         }
         if(ImGui::Button("Close", ImVec2(-1,0))) {
             if(S.preview_srv) { S.preview_srv->Release(); S.preview_srv = nullptr; }
+            ++S.preview_ticket;
             ImGui::CloseCurrentPopup();
         }
         ImGui::EndPopup();
@@ -0,0 +1,302 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include "Simd.h"
+
+// Decoders for the MDL vertex streams, specialized per layout at compile time.
+// Positions and UVs are big-endian halfs; each vertex is byte-swapped and
+// converted in one register (F16C when the CPU has it, SSE2 otherwise) and
+// stored straight into the caller's arrays.
+
+// 28-byte vertices of the main and foliage paths: position at 0, packed
+// normal at 8, bone index at 15, bone weight at 19, UV at 20, packed tangent
+// at 24.
+struct MdlVertexMain {
+    static constexpr size_t stride = 28;
+    static constexpr size_t normal_offset = 8;
+    static constexpr size_t tangent_offset = 24;
+    static constexpr size_t uv_offset = 20;
+    static constexpr bool skinned = true;
+    static constexpr size_t bone_offset = 15;
+    static constexpr size_t weight_offset = 19;
+};
+
+// 20-byte vertices of the alternate path: position at 0, packed normal at 8,
+// UV at 12, packed tangent at 16, unskinned.
+struct MdlVertexAlt {
+    static constexpr size_t stride = 20;
+    static constexpr size_t normal_offset = 8;
+    static constexpr size_t tangent_offset = 16;
+    static constexpr size_t uv_offset = 12;
+    static constexpr bool skinned = false;
+    static constexpr size_t bone_offset = 0;
+    static constexpr size_t weight_offset = 0;
+};
+
+// Where decoded attributes go; null pointers skip an attribute. Strides are
+// in bytes, so the defaults describe packed arrays (glTF accessors,
+// MDLMeshGeom) and an interleaved vertex such as MPVertex just passes
+// sizeof(MPVertex) with pointers into the first element.
+struct VertexSink {
+    float *position = nullptr;  // xyz
+    size_t position_stride = 12;
+    float *uv = nullptr;
+    size_t uv_stride = 8;
+    uint16_t *bone_ids = nullptr;  // four per vertex
+    size_t bone_ids_stride = 8;
+    float *bone_weights = nullptr;  // four per vertex
+    size_t bone_weights_stride = 16;
+};
+
+// Encodings of the 32-bit big-endian normal/tangent words, x in the low bits.
+enum class PackedVectorFormat : uint8_t {
+    Dec3N,    // 10:10:10 signed, 2-bit signed w
+    HEnd3N,   // 11:11:10 signed
+    UByte4N,  // 8:8:8 biased, x in the low byte
+};
+
+namespace vertex_decode_detail {
+    template<class T>
+    inline T *at(T *base, size_t stride, size_t v) {
+        return reinterpret_cast<T *>(reinterpret_cast<uint8_t *>(base) + v * stride);
+    }
+
+    // f holds x, y, z, (pad), u, v.
+    template<class Layout>
+    inline void store_vertex(const uint8_t *p, const float *f, size_t v, const VertexSink &out) {
+        if (out.position) std::memcpy(at(out.position, out.position_stride, v), f, 12);
+        if (out.uv) std::memcpy(at(out.uv, out.uv_stride, v), f + 4, 8);
+
+        uint16_t ids[4] = {0, 0, 0, 0};
+        float weights[4] = {1.0f, 0.0f, 0.0f, 0.0f};
+        if constexpr (Layout::skinned) {
+            uint8_t bone = p[Layout::bone_offset];
+            uint8_t weight = p[Layout::weight_offset];
+            if (bone < 255) {
+                ids[0] = bone;
+                if (weight > 0) weights[0] = weight / 255.0f;
+            }
+        }
+        if (out.bone_ids) std::memcpy(at(out.bone_ids, out.bone_ids_stride, v), ids, sizeof(ids));
+        if (out.bone_weights) std::memcpy(at(out.bone_weights, out.bone_weights_stride, v), weights, sizeof(weights));
+    }
+
+    inline uint16_t load_be16(const uint8_t *p) { return (uint16_t) ((p[0] << 8) | p[1]); }
+
+    // Exact half -> float for every input, denormals, infinities and NaN included.
+    inline float half_to_float(uint16_t h) {
+        uint32_t sign = (uint32_t) (h & 0x8000u) << 16;
+        uint32_t expmant = h & 0x7FFFu;
+        float scaled;
+        uint32_t bits = expmant << 13;
+        std::memcpy(&scaled, &bits, 4);
+        scaled *= 5.192296858534828e+33f;  // 2^112 rebiases the exponent
+        std::memcpy(&bits, &scaled, 4);
+        if (expmant >= 0x7C00u) bits |= 255u << 23;
+        bits |= sign;
+        float out;
+        std::memcpy(&out, &bits, 4);
+        return out;
+    }
+
+    template<class Layout>
+    void decode_scalar(const uint8_t *src, size_t count, const VertexSink &out) {
+        float f[8] = {};
+        for (size_t v = 0; v < count; ++v) {
+            const uint8_t *p = src + v * Layout::stride;
+            for (int i = 0; i < 3; ++i) f[i] = half_to_float(load_be16(p + i * 2));
+            f[4] = half_to_float(load_be16(p + Layout::uv_offset));
+            f[5] = half_to_float(load_be16(p + Layout::uv_offset + 2));
+            store_vertex<Layout>(p, f, v, out);
+        }
+    }
+
+    inline uint32_t load_be32(const uint8_t *p) {
+        return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+    }
+
+    inline int32_t sext(uint32_t v, int shift, int bits) {
+        return (int32_t) (v << (32 - shift - bits)) >> (32 - bits);
+    }
+
+    // One word to unnormalized xyz plus w (the Dec3N sign bit pair, else 1).
+    inline void unpack_vector(uint32_t w, PackedVectorFormat fmt, float *out) {
+        switch (fmt) {
+            case PackedVectorFormat::Dec3N:
+                out[0] = sext(w, 0, 10) / 511.0f;
+                out[1] = sext(w, 10, 10) / 511.0f;
+                out[2] = sext(w, 20, 10) / 511.0f;
+                out[3] = sext(w, 30, 2) < 0 ? -1.0f : 1.0f;
+                break;
+            case PackedVectorFormat::HEnd3N:
+                out[0] = sext(w, 0, 11) / 1023.0f;
+                out[1] = sext(w, 11, 11) / 1023.0f;
+                out[2] = sext(w, 22, 10) / 511.0f;
+                out[3] = 1.0f;
+                break;
+            case PackedVectorFormat::UByte4N:
+                out[0] = (w & 0xFF) / 127.5f - 1.0f;
+                out[1] = ((w >> 8) & 0xFF) / 127.5f - 1.0f;
+                out[2] = ((w >> 16) & 0xFF) / 127.5f - 1.0f;
+                out[3] = 1.0f;
+                break;
+        }
+    }
+
+    // Stored unit vectors come back within a quantization step of length 1.
+    inline bool near_unit(float len2) { return len2 > 0.81f && len2 < 1.21f; }
+
+    template<class Layout>
+    size_t decode_packed_scalar(const uint8_t *src, size_t begin, size_t count, size_t offset,
+                                PackedVectorFormat fmt, float *out, size_t out_stride, bool with_w) {
+        size_t unit = 0;
+        for (size_t v = begin; v < count; ++v) {
+            float f[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+            unpack_vector(load_be32(src + v * Layout::stride + offset), fmt, f);
+            float len2 = f[0] * f[0] + f[1] * f[1] + f[2] * f[2];
+            if (near_unit(len2)) ++unit;
+            float inv = len2 > 1e-12f ? 1.0f / std::sqrt(len2) : 0.0f;
+            for (int i = 0; i < 3; ++i) f[i] *= inv;
+            std::memcpy(at(out, out_stride, v), f, with_w ? 16 : 12);
+        }
+        return unit;
+    }
+
+#if F2_SIMD_X86
+    // Four words to normalized xyz lanes; returns the near-unit lane mask.
+    inline int unpack_vectors_sse2(__m128i w, PackedVectorFormat fmt, __m128 &x, __m128 &y, __m128 &z,
+                                   __m128 &wout) {
+        x = y = z = _mm_setzero_ps();
+        wout = _mm_set1_ps(1.0f);
+        switch (fmt) {
+            case PackedVectorFormat::Dec3N: {
+                const __m128 s = _mm_set1_ps(1.0f / 511.0f);
+                x = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(w, 22), 22)), s);
+                y = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(w, 12), 22)), s);
+                z = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(w, 2), 22)), s);
+                __m128 neg = _mm_castsi128_ps(_mm_srai_epi32(w, 31));
+                wout = _mm_or_ps(_mm_andnot_ps(neg, wout), _mm_and_ps(neg, _mm_set1_ps(-1.0f)));
+                break;
+            }
+            case PackedVectorFormat::HEnd3N:
+                x = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(w, 21), 21)), _mm_set1_ps(1.0f / 1023.0f));
+                y = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(w, 10), 21)), _mm_set1_ps(1.0f / 1023.0f));
+                z = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(w, 22)), _mm_set1_ps(1.0f / 511.0f));
+                break;
+            case PackedVectorFormat::UByte4N: {
+                const __m128i m = _mm_set1_epi32(0xFF);
+                const __m128 s = _mm_set1_ps(1.0f / 127.5f), one = _mm_set1_ps(1.0f);
+                x = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(w, m)), s), one);
+                y = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(w, 8), m)), s), one);
+                z = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(w, 16), m)), s), one);
+                break;
+            }
+        }
+        __m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+        int unit = _mm_movemask_ps(_mm_and_ps(_mm_cmpgt_ps(len2, _mm_set1_ps(0.81f)),
+                                              _mm_cmplt_ps(len2, _mm_set1_ps(1.21f))));
+        __m128 nonzero = _mm_cmpgt_ps(len2, _mm_set1_ps(1e-12f));
+        __m128 inv = _mm_and_ps(nonzero, _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_max_ps(len2, _mm_set1_ps(1e-12f)))));
+        x = _mm_mul_ps(x, inv);
+        y = _mm_mul_ps(y, inv);
+        z = _mm_mul_ps(z, inv);
+        return unit;
+    }
+
+    template<class Layout>
+    size_t decode_packed_sse2(const uint8_t *src, size_t count, size_t offset, PackedVectorFormat fmt, float *out,
+                              size_t out_stride, bool with_w) {
+        static const int popcount4[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+        size_t unit = 0, v = 0;
+        alignas(16) float lanes[4][4];
+        for (; v + 4 <= count; v += 4) {
+            const uint8_t *p = src + v * Layout::stride + offset;
+            __m128i w = _mm_set_epi32((int) load_be32(p + 3 * Layout::stride), (int) load_be32(p + 2 * Layout::stride),
+                                      (int) load_be32(p + Layout::stride), (int) load_be32(p));
+            __m128 x, y, z, ww;
+            unit += popcount4[unpack_vectors_sse2(w, fmt, x, y, z, ww)];
+            _MM_TRANSPOSE4_PS(x, y, z, ww);
+            _mm_store_ps(lanes[0], x);
+            _mm_store_ps(lanes[1], y);
+            _mm_store_ps(lanes[2], z);
+            _mm_store_ps(lanes[3], ww);
+            for (size_t k = 0; k < 4; ++k) std::memcpy(at(out, out_stride, v + k), lanes[k], with_w ? 16 : 12);
+        }
+        return unit + decode_packed_scalar<Layout>(src, v, count, offset, fmt, out, out_stride, with_w);
+    }
+#endif
+
+#if F2_SIMD_X86
+    // x, y, z, pad, u, v, 0, 0 as byte-swapped halfs.
+    template<class Layout>
+    inline __m128i load_halfs(const uint8_t *p) {
+        __m128i pos = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p));
+        int32_t uv;
+        std::memcpy(&uv, p + Layout::uv_offset, 4);
+        __m128i h = _mm_unpacklo_epi64(pos, _mm_cvtsi32_si128(uv));
+        return _mm_or_si128(_mm_slli_epi16(h, 8), _mm_srli_epi16(h, 8));
+    }
+
+    // The same rebias as half_to_float, four lanes at a time.
+    inline __m128 halfs_to_floats_sse2(__m128i h32) {
+        const __m128i expmant = _mm_and_si128(h32, _mm_set1_epi32(0x7FFF));
+        const __m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(expmant, 13)),
+                                         _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23)));
+        const __m128i infnan = _mm_and_si128(_mm_cmpgt_epi32(expmant, _mm_set1_epi32(0x7BFF)),
+                                             _mm_set1_epi32(255 << 23));
+        const __m128i sign = _mm_slli_epi32(_mm_and_si128(h32, _mm_set1_epi32(0x8000)), 16);
+        return _mm_or_ps(scaled, _mm_castsi128_ps(_mm_or_si128(sign, infnan)));
+    }
+
+    template<class Layout>
+    void decode_sse2(const uint8_t *src, size_t count, const VertexSink &out) {
+        alignas(16) float f[8];
+        const __m128i zero = _mm_setzero_si128();
+        for (size_t v = 0; v < count; ++v) {
+            const uint8_t *p = src + v * Layout::stride;
+            __m128i h = load_halfs<Layout>(p);
+            _mm_store_ps(f, halfs_to_floats_sse2(_mm_unpacklo_epi16(h, zero)));
+            _mm_store_ps(f + 4, halfs_to_floats_sse2(_mm_unpackhi_epi16(h, zero)));
+            store_vertex<Layout>(p, f, v, out);
+        }
+    }
+
+    template<class Layout>
+    F2_TARGET_F16C void decode_f16c(const uint8_t *src, size_t count, const VertexSink &out) {
+        alignas(32) float f[8];
+        for (size_t v = 0; v < count; ++v) {
+            const uint8_t *p = src + v * Layout::stride;
+            _mm256_store_ps(f, _mm256_cvtph_ps(load_halfs<Layout>(p)));
+            store_vertex<Layout>(p, f, v, out);
+        }
+    }
+#endif
+}
+
+// Decodes `count` vertices of `Layout` starting at `src` into `out`. The
+// caller has checked that count * Layout::stride bytes are readable.
+template<class Layout>
+void decode_mdl_vertices(const uint8_t *src, size_t count, const VertexSink &out) {
+#if F2_SIMD_X86
+    if (cpu_has_f16c()) vertex_decode_detail::decode_f16c<Layout>(src, count, out);
+    else vertex_decode_detail::decode_sse2<Layout>(src, count, out);
+#else
+    vertex_decode_detail::decode_scalar<Layout>(src, count, out);
+#endif
+}
+
+// Unpacks the packed vector at `offset` (Layout::normal_offset or
+// tangent_offset) of every vertex to unit xyz, plus w when `with_w`, at
+// `out` with a byte stride. Returns how many were stored near unit length,
+// which tells real normals from bytes of another format.
+template<class Layout>
+size_t decode_mdl_packed_vectors(const uint8_t *src, size_t count, size_t offset, PackedVectorFormat fmt, float *out,
+                                 size_t out_stride, bool with_w = false) {
+#if F2_SIMD_X86
+    return vertex_decode_detail::decode_packed_sse2<Layout>(src, count, offset, fmt, out, out_stride, with_w);
+#else
+    return vertex_decode_detail::decode_packed_scalar<Layout>(src, 0, count, offset, fmt, out, out_stride, with_w);
+#endif
+}
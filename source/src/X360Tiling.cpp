@@ -0,0 +1,194 @@
+#include "X360Tiling.h"
+#include "Simd.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <unordered_set>
+
+namespace {
+    constexpr int TILE = 32;
+
+    int log2_bpb(int bytes_per_block) {
+        return (bytes_per_block >> 2) + ((bytes_per_block >> 1) >> (bytes_per_block >> 2));
+    }
+
+    // XGAddress2DTiledOffset restricted to one macro tile: the block offset of
+    // (x, y) inside its 32x32 tile. Everything above the tile is a plain
+    // multiple of TILE * TILE blocks, which the per-dimension tables add in.
+    uint32_t tile_offset(uint32_t x, uint32_t y, uint32_t log_bpp) {
+        uint32_t micro = ((x & 7) + ((y & 6) << 2)) << log_bpp;
+        uint32_t offset = ((micro & ~15u) << 1) + (micro & 15) + ((y & 8) << (3 + log_bpp)) + ((y & 1) << 4);
+        return ((((offset & ~511u) << 3) + ((offset & 448) << 2) + (offset & 63)) + ((y & 16) << 7) +
+                (((((y & 8) >> 2) + (x >> 3)) & 3) << 6)) >> log_bpp;
+    }
+
+    struct TileTables {
+        std::vector<uint32_t> cols;     // macro tile column base per block x
+        std::vector<uint32_t> rows;     // macro tile row base per block y
+        std::vector<uint16_t> in_tile;  // offset inside the tile, by (y & 31) * 32 + (x & 31)
+    };
+
+    std::mutex g_tables_mutex;
+    std::map<std::tuple<int, int, int>, std::shared_ptr<const TileTables>> g_tables;
+
+    std::shared_ptr<const TileTables> tables_for(int wb, int hb, int bpb) {
+        std::lock_guard<std::mutex> lock(g_tables_mutex);
+        auto key = std::make_tuple(wb, hb, bpb);
+        auto it = g_tables.find(key);
+        if (it != g_tables.end()) return it->second;
+
+        // Textures come in a handful of sizes; this only guards against a
+        // long session filling the cache with one-off dimensions.
+        if (g_tables.size() >= 64) g_tables.clear();
+
+        auto t = std::make_shared<TileTables>();
+        const uint32_t tiles_x = (uint32_t) (wb + TILE - 1) / TILE;
+        const uint32_t log_bpp = (uint32_t) log2_bpb(bpb);
+
+        t->cols.resize(wb);
+        for (int x = 0; x < wb; ++x) t->cols[x] = ((uint32_t) x / TILE) * TILE * TILE;
+        t->rows.resize(hb);
+        for (int y = 0; y < hb; ++y) t->rows[y] = ((uint32_t) y / TILE) * tiles_x * TILE * TILE;
+        t->in_tile.resize(TILE * TILE);
+        for (uint32_t y = 0; y < TILE; ++y)
+            for (uint32_t x = 0; x < TILE; ++x)
+                t->in_tile[y * TILE + x] = (uint16_t) tile_offset(x, y, log_bpp);
+
+        g_tables.emplace(key, t);
+        return t;
+    }
+
+    // Whatever the block size, the swizzle keeps 16 bytes of a row together:
+    // 4 blocks of 4 bytes, 2 of 8 or 1 of 16 sit next to each other in the
+    // tiled data too. Rows are therefore moved one 16-byte vector at a time,
+    // with per-block copies only for a ragged right edge or truncated data.
+    template<int BPB>
+    void untile_rows(const TileTables &t, const uint8_t *src, size_t src_blocks, int wb, int hb, uint8_t *dst) {
+        constexpr int RUN = 16 / BPB;
+        for (int y = 0; y < hb; ++y) {
+            const uint16_t *in_tile = t.in_tile.data() + (y % TILE) * TILE;
+            const uint32_t row = t.rows[y];
+            uint8_t *out = dst + (size_t) y * wb * BPB;
+            int x = 0;
+            for (; x + RUN <= wb; x += RUN) {
+                size_t s = (size_t) row + t.cols[x] + in_tile[x % TILE];
+                if (s + RUN > src_blocks) break;
+#if F2_SIMD_X86
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + (size_t) x * BPB),
+                                 _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + s * BPB)));
+#else
+                std::memcpy(out + (size_t) x * BPB, src + s * BPB, 16);
+#endif
+            }
+            for (; x < wb; ++x) {
+                size_t s = (size_t) row + t.cols[x] + in_tile[x % TILE];
+                if (s < src_blocks) std::memcpy(out + (size_t) x * BPB, src + s * BPB, BPB);
+            }
+        }
+    }
+
+    bool untile_surface(const uint8_t *src, size_t src_size, int width_blocks, int height_blocks, int bytes_per_block,
+                        std::vector<uint8_t> &out) {
+        auto t = tables_for(width_blocks, height_blocks, bytes_per_block);
+        // Mips are sometimes stored without the padding of their last tile row;
+        // blocks that fall past the data stay zero rather than failing the image.
+        size_t src_blocks = src_size / (size_t) bytes_per_block;
+        out.assign((size_t) width_blocks * height_blocks * bytes_per_block, 0);
+
+        switch (bytes_per_block) {
+            case 4: untile_rows<4>(*t, src, src_blocks, width_blocks, height_blocks, out.data()); break;
+            case 8: untile_rows<8>(*t, src, src_blocks, width_blocks, height_blocks, out.data()); break;
+            default: untile_rows<16>(*t, src, src_blocks, width_blocks, height_blocks, out.data()); break;
+        }
+        return true;
+    }
+
+    // Known answers from XGAddress2DTiledOffset for a 64-block-wide surface,
+    // as (x, y, tiled block offset) at 4, 8 and 16 bytes per block.
+    const uint32_t KNOWN[3][6][3] = {
+        {{7, 0, 11}, {5, 3, 77}, {13, 9, 317}, {31, 31, 991}, {40, 17, 1556}, {17, 45, 2437}},
+        {{7, 0, 37}, {5, 3, 99}, {13, 9, 571}, {31, 31, 1007}, {40, 17, 1290}, {17, 45, 2691}},
+        {{7, 0, 50}, {5, 3, 99}, {13, 9, 559}, {31, 31, 1015}, {40, 17, 1157}, {17, 45, 2819}},
+    };
+    const int KNOWN_BPB[3] = {4, 8, 16};
+    std::string tiled_key(const std::string &tex_name) {
+        std::string n = tex_name;
+        std::replace(n.begin(), n.end(), '\\', '/');
+        std::string stem = std::filesystem::path(n).stem().string();
+        std::transform(stem.begin(), stem.end(), stem.begin(), ::tolower);
+        return stem;
+    }
+
+    std::mutex g_tiled_mutex;
+    std::unordered_set<std::string> g_tiled;
+}
+
+size_t x360_tiled_surface_bytes(int width_blocks, int height_blocks, int bytes_per_block) {
+    if (width_blocks <= 0 || height_blocks <= 0 || bytes_per_block <= 0) return 0;
+    size_t tiles_x = (size_t) (width_blocks + TILE - 1) / TILE;
+    size_t tiles_y = (size_t) (height_blocks + TILE - 1) / TILE;
+    return tiles_x * tiles_y * TILE * TILE * (size_t) bytes_per_block;
+}
+
+bool x360_untile(const uint8_t *src, size_t src_size, int width_blocks, int height_blocks, int bytes_per_block,
+                 std::vector<uint8_t> &out) {
+    if (!src || width_blocks <= 0 || height_blocks <= 0) return false;
+    if (bytes_per_block != 4 && bytes_per_block != 8 && bytes_per_block != 16) return false;
+
+    // A table or copy-loop regression must not quietly scramble exports.
+    static const bool self_test_ok = x360_tiling_self_test();
+    if (!self_test_ok) return false;
+    return untile_surface(src, src_size, width_blocks, height_blocks, bytes_per_block, out);
+}
+
+bool x360_tiling_self_test() {
+    const int wb = 64, hb = 64;
+    for (int b = 0; b < 3; ++b) {
+        const int bpb = KNOWN_BPB[b];
+
+        // The vector row copy relies on 16 bytes of a tile row staying together.
+        auto t = tables_for(wb, hb, bpb);
+        const int run = 16 / bpb;
+        for (int i = 0; i < TILE * TILE; ++i)
+            if (i % run != 0 && t->in_tile[i] != t->in_tile[i - 1] + 1) return false;
+
+        // Tiled fixture: a numbered block at each known offset, zero elsewhere.
+        // Untiled, each must land at its (x, y) and nothing else may be set.
+        std::vector<uint8_t> tiled(x360_tiled_surface_bytes(wb, hb, bpb), 0);
+        std::vector<uint8_t> linear((size_t) wb * hb * bpb, 0);
+        for (int k = 0; k < 6; ++k) {
+            const uint32_t *e = KNOWN[b][k];
+            for (int i = 0; i < bpb; ++i) {
+                uint8_t v = (uint8_t) (k * 16 + i + 1);
+                tiled[(size_t) e[2] * bpb + i] = v;
+                linear[((size_t) e[1] * wb + e[0]) * bpb + i] = v;
+            }
+        }
+        std::vector<uint8_t> out;
+        if (!untile_surface(tiled.data(), tiled.size(), wb, hb, bpb, out) || out != linear) return false;
+    }
+    return true;
+}
+
+bool x360_untile_bc(BCFormat fmt, const uint8_t *src, size_t src_size, int w, int h, std::vector<uint8_t> &out) {
+    size_t bpb = bc_block_bytes(fmt);
+    if (!bpb || w <= 0 || h <= 0) return false;
+    return x360_untile(src, src_size, (w + 3) / 4, (h + 3) / 4, (int) bpb, out);
+}
+
+bool texture_is_tiled(const std::string &tex_name) {
+    std::string key = tiled_key(tex_name);
+    std::lock_guard<std::mutex> lock(g_tiled_mutex);
+    return g_tiled.count(key) != 0;
+}
+
+void set_texture_tiled(const std::string &tex_name, bool tiled) {
+    std::string key = tiled_key(tex_name);
+    std::lock_guard<std::mutex> lock(g_tiled_mutex);
+    if (tiled) g_tiled.insert(key);
+    else g_tiled.erase(key);
+}
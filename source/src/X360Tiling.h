@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "BCDecode.h"
+
+// Xbox 360 surfaces can be stored in the GPU's tiled order: the image is cut
+// into 32x32-block macro tiles laid out row by row, with a fixed swizzle of
+// the blocks inside each tile. Both dimensions are padded to 32 blocks.
+// These helpers rearrange such data into plain row-major block order so it
+// can go through bc_decode. Blocks are moved whole, so the big-endian swap
+// still happens in the decoder.
+size_t x360_tiled_surface_bytes(int width_blocks, int height_blocks, int bytes_per_block);
+bool x360_untile(const uint8_t *src, size_t src_size, int width_blocks, int height_blocks, int bytes_per_block,
+                 std::vector<uint8_t> &out);
+bool x360_untile_bc(BCFormat fmt, const uint8_t *src, size_t src_size, int w, int h, std::vector<uint8_t> &out);
+
+// Untiles a small fixture with blocks at offsets taken from the reference
+// XGAddress2DTiledOffset and checks where they land. Runs in every build the
+// first time x360_untile is called, which refuses to untile if it fails.
+bool x360_tiling_self_test();
+
+// Per-texture choice, keyed by the lower-cased file stem so "foo", "foo.tex"
+// and "textures\foo.tex" all refer to the same texture. Safe to call from
+// export workers.
+bool texture_is_tiled(const std::string &tex_name);
+void set_texture_tiled(const std::string &tex_name, bool tiled);
@@ -1,6 +1,11 @@
 #include "Files.h"
 #include <fstream>
 #include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <thread>
+#include <unordered_map>
 
 std::string load_last_dir() {
     std::ifstream f("last_dir.txt");
@@ -14,36 +19,158 @@ void save_last_dir(const std::string &p) {
     if (f) f << p;
 }
 
-std::vector<std::string> scan_bnks_recursive(const std::string &root) {
-    std::vector<std::string> out;
+// One walk over the root for every extension we care about. Directories are
+// handed out from a shared queue so sibling subtrees are listed in parallel,
+// which is what matters on network-mounted installs. Size and mtime come
+// from the directory entry, so no extra stat per file on Windows. The first
+// exception a worker hits (a path that will not convert, an allocation)
+// stops the walk and is rethrown to the caller.
+ScanResult scan_game_dir(const std::string &root) {
+    ScanResult result;
     std::error_code ec;
-    for (auto it = std::filesystem::recursive_directory_iterator(
-             root, std::filesystem::directory_options::skip_permission_denied, ec);
-         it != std::filesystem::recursive_directory_iterator(); ++it) {
-        if (it->is_regular_file(ec)) {
-            auto p = it->path();
-            auto ext = p.extension().string();
-            std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
-            if (ext == ".bnk") out.push_back(p.string());
+    if (!std::filesystem::is_directory(root, ec)) return result;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<std::filesystem::path> queue{std::filesystem::path(root)};
+    size_t busy = 0;
+    std::exception_ptr error;
+
+    auto worker = [&]() {
+        bool counted = false;
+        try {
+            std::vector<ScannedFile> bnks, adbs;
+            std::vector<std::filesystem::path> subdirs;
+            for (;;) {
+                std::filesystem::path dir;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait(lock, [&]() { return error || !queue.empty() || busy == 0; });
+                    if (error || queue.empty()) break;
+                    dir = std::move(queue.back());
+                    queue.pop_back();
+                    ++busy;
+                    counted = true;
+                }
+
+                subdirs.clear();
+                std::error_code dec;
+                for (std::filesystem::directory_iterator it(dir, std::filesystem::directory_options::skip_permission_denied, dec), end;
+                     !dec && it != end; it.increment(dec)) {
+                    const auto &entry = *it;
+                    std::error_code eec;
+                    if (entry.is_directory(eec)) {
+                        if (!entry.is_symlink(eec)) subdirs.push_back(entry.path());
+                        continue;
+                    }
+                    if (!entry.is_regular_file(eec)) continue;
+
+                    std::string ext = entry.path().extension().string();
+                    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+                    std::vector<ScannedFile> *dst = ext == ".bnk" ? &bnks : ext == ".adb" ? &adbs : nullptr;
+                    if (!dst) continue;
+
+                    ScannedFile f;
+                    f.path = entry.path().string();
+                    f.size = entry.file_size(eec);
+                    if (eec) f.size = 0;
+                    f.mtime = (int64_t) entry.last_write_time(eec).time_since_epoch().count();
+                    dst->push_back(std::move(f));
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    for (auto &d: subdirs) queue.push_back(std::move(d));
+                    --busy;
+                    counted = false;
+                }
+                cv.notify_all();
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto &f: bnks) result.bnks.push_back(std::move(f));
+            for (auto &f: adbs) result.adbs.push_back(std::move(f));
+        } catch (...) {
+            // Still give back the directory, or the others wait forever.
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) error = std::current_exception();
+                if (counted) --busy;
+            }
+            cv.notify_all();
         }
-    }
-    return out;
+    };
+
+    int n = std::min(8, std::max(1, (int) std::thread::hardware_concurrency()));
+    std::vector<std::thread> pool;
+    for (int t = 0; t < n; ++t) pool.emplace_back(worker);
+    for (auto &th: pool) th.join();
+    if (error) std::rethrow_exception(error);
+
+    auto by_path = [](const ScannedFile &a, const ScannedFile &b) { return a.path < b.path; };
+    std::sort(result.bnks.begin(), result.bnks.end(), by_path);
+    std::sort(result.adbs.begin(), result.adbs.end(), by_path);
+    return result;
 }
 
-std::vector<std::string> scan_adbs_recursive(const std::string &root) {
-    std::vector<std::string> out;
-    std::error_code ec;
-    for (auto it = std::filesystem::recursive_directory_iterator(
-             root, std::filesystem::directory_options::skip_permission_denied, ec);
-         it != std::filesystem::recursive_directory_iterator(); ++it) {
-        if (it->is_regular_file(ec)) {
-            auto p = it->path();
-            auto ext = p.extension().string();
-            std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
-            if (ext == ".adb") out.push_back(p.string());
+ScanDiff diff_scans(const ScanResult &before, const ScanResult &after) {
+    ScanDiff diff;
+    auto diff_list = [&](const std::vector<ScannedFile> &a, const std::vector<ScannedFile> &b) {
+        std::unordered_map<std::string, const ScannedFile *> old;
+        old.reserve(a.size());
+        for (auto &f: a) old.emplace(f.path, &f);
+        for (auto &f: b) {
+            auto it = old.find(f.path);
+            if (it == old.end()) {
+                diff.added.push_back(f.path);
+                continue;
+            }
+            if (it->second->size != f.size || it->second->mtime != f.mtime) diff.changed.push_back(f.path);
+            old.erase(it);
+        }
+        for (auto &kv: old) diff.removed.push_back(kv.first);
+    };
+    diff_list(before.bnks, after.bnks);
+    diff_list(before.adbs, after.adbs);
+    std::sort(diff.removed.begin(), diff.removed.end());
+    return diff;
+}
+
+ScanDiff rescan_paths(ScanResult &scan, const std::vector<std::string> &paths) {
+    ScanDiff diff;
+    auto by_path = [](const ScannedFile &a, const ScannedFile &b) { return a.path < b.path; };
+    for (const auto &p: paths) {
+        std::string ext = std::filesystem::path(p).extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        std::vector<ScannedFile> *list = ext == ".bnk" ? &scan.bnks : ext == ".adb" ? &scan.adbs : nullptr;
+        if (!list) continue;
+
+        ScannedFile f;
+        f.path = p;
+        auto it = std::lower_bound(list->begin(), list->end(), f, by_path);
+        bool known = it != list->end() && it->path == p;
+
+        std::error_code ec;
+        bool present = std::filesystem::is_regular_file(p, ec);
+        if (present) {
+            f.size = std::filesystem::file_size(p, ec);
+            if (ec) f.size = 0;
+            f.mtime = (int64_t) std::filesystem::last_write_time(p, ec).time_since_epoch().count();
+        }
+
+        if (!present) {
+            if (!known) continue;
+            list->erase(it);
+            diff.removed.push_back(p);
+        } else if (!known) {
+            list->insert(it, f);
+            diff.added.push_back(p);
+        } else if (it->size != f.size || it->mtime != f.mtime) {
+            *it = f;
+            diff.changed.push_back(p);
         }
     }
-    return out;
+    return diff;
 }
 
 std::vector<unsigned char> read_all_bytes(const std::filesystem::path &p) {
@@ -2,11 +2,34 @@
 #include <string>
 #include <vector>
 #include <filesystem>
+#include <cstdint>
 
 std::string load_last_dir();
 void save_last_dir(const std::string &p);
-std::vector<std::string> scan_bnks_recursive(const std::string &root);
-std::vector<std::string> scan_adbs_recursive(const std::string &root);
+
+struct ScannedFile {
+    std::string path;
+    uint64_t size = 0;
+    int64_t mtime = 0;
+};
+
+struct ScanResult {
+    std::vector<ScannedFile> bnks;
+    std::vector<ScannedFile> adbs;
+};
+
+struct ScanDiff {
+    std::vector<std::string> added;
+    std::vector<std::string> removed;
+    std::vector<std::string> changed;
+    bool empty() const { return added.empty() && removed.empty() && changed.empty(); }
+};
+
+ScanResult scan_game_dir(const std::string &root);
+ScanDiff diff_scans(const ScanResult &before, const ScanResult &after);
+// Re-stats just these paths and updates scan in place; the diff says what
+// actually changed, since a watcher may report the same file twice.
+ScanDiff rescan_paths(ScanResult &scan, const std::vector<std::string> &paths);
 std::vector<unsigned char> read_all_bytes(const std::filesystem::path &p);
 bool rd32be(const std::vector<unsigned char> &d, size_t o, uint32_t &v);
 bool rd16be(const std::vector<unsigned char> &d, size_t o, uint16_t &v);
\ No newline at end of file
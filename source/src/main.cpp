@@ -14,6 +14,8 @@
 #include "HexView.h"
 #include "files.h"
 #include "play_audio.h"
+#include "ArchiveWatcher.h"
+#include "ThumbCache.h"
 #include <string>
 #include <mutex>
 #include <algorithm>
@@ -367,6 +369,8 @@ int main() {
 
     S.exiting = true;
     BackgroundAudio::instance().stop();
+    watcher_stop();
+    thumb_shutdown();
 
 
     ImGui_ImplDX11_Shutdown();
@@ -1,8 +1,14 @@
 // mdl_converter.cpp
 #include "mdl_converter.h"
 #include "ModelParser.h"
+#include "MeshProcess.h"
 #include "TexParser.h"
+#include "X360Tiling.h"
+#include "PngEncode.h"
+#include "QoiEncode.h"
+#include "TexCache.h"
 #include "Files.h"
+#include "Utils.h"
 #include <vector>
 #include <string>
 #include <fstream>
@@ -12,6 +18,7 @@
 #include <algorithm>
 #include <sstream>
 #include <cmath>
+#include <unordered_map>
 
 namespace {
 
@@ -138,354 +145,108 @@ struct Matrix4 {
     }
 };
 
-static inline uint8_t ex5(uint16_t v){ return (uint8_t)((v<<3)|(v>>2)); }
-static inline uint8_t ex6(uint16_t v){ return (uint8_t)((v<<2)|(v>>4)); }
-
-static void decode_bc1_block(const uint8_t* b, uint32_t* outRGBA) {
-    uint16_t c0 = (uint16_t)(b[0] | (b[1]<<8));
-    uint16_t c1 = (uint16_t)(b[2] | (b[3]<<8));
-    uint8_t r0=ex5((c0>>11)&31), g0=ex6((c0>>5)&63), b0=ex5(c0&31);
-    uint8_t r1=ex5((c1>>11)&31), g1=ex6((c1>>5)&63), b1=ex5(c1&31);
-    uint32_t cols[4];
-    cols[0] = (0xFFu<<24) | (b0<<16) | (g0<<8) | r0;
-    cols[1] = (0xFFu<<24) | (b1<<16) | (g1<<8) | r1;
-    if(c0 > c1){
-        cols[2] = (0xFFu<<24) | (((2*b0+b1)/3)<<16) | (((2*g0+g1)/3)<<8) | ((2*r0+r1)/3);
-        cols[3] = (0xFFu<<24) | (((b0+2*b1)/3)<<16) | (((g0+2*g1)/3)<<8) | ((r0+2*r1)/3);
-    }else{
-        cols[2] = (0xFFu<<24) | (((b0+b1)>>1)<<16) | (((g0+g1)>>1)<<8) | ((r0+r1)>>1);
-        cols[3] = 0x00000000u;
-    }
-    const uint32_t idx = b[4] | (b[5]<<8) | (b[6]<<16) | (b[7]<<24);
-    for(int py=0; py<4; ++py){
-        for(int px=0; px<4; ++px){
-            int s = (idx >> (2*(py*4+px))) & 3;
-            outRGBA[py*4+px] = cols[s];
-        }
-    }
+static bool decode_texture_to_png(const std::vector<unsigned char>& tex_buf, std::vector<uint8_t>& png_out, bool tiled,
+                                  int max_threads = 0) {
+    std::vector<uint8_t> rgba;
+    int w = 0, h = 0;
+    if (!tex_decode_largest_mip(tex_buf, tiled, rgba, w, h)) return false;
+    return png_encode_rgba(rgba.data(), w, h, png_out, 6, max_threads);
 }
 
-static void decode_bc3_block(const uint8_t* b, uint32_t* outRGBA) {
-    uint8_t a0 = b[0], a1 = b[1];
-    uint64_t abits = 0;
-    for(int i=0; i<6; ++i) abits |= (uint64_t)b[2+i] << (8*i);
-
-    uint8_t atab[8];
-    atab[0] = a0; atab[1] = a1;
-    if(a0 > a1) {
-        for(int i=1; i<=6; i++) atab[i+1] = (uint8_t)(((7-i)*a0 + i*a1)/7);
-    } else {
-        for(int i=1; i<=4; i++) atab[i+1] = (uint8_t)(((5-i)*a0 + i*a1)/5);
-        atab[6] = 0; atab[7] = 255;
-    }
-
-    uint32_t color[16];
-    decode_bc1_block(b+8, color);
-
-    for(int i=0; i<16; ++i) {
-        uint8_t ai = (uint8_t)((abits >> (3*i)) & 7);
-        color[i] = (color[i] & 0x00FFFFFFu) | (((uint32_t)atab[ai]) << 24);
-    }
-
-    for(int i=0; i<16; ++i) outRGBA[i] = color[i];
-}
-
-static void decode_bc5_block(const uint8_t* b, uint32_t* outRGBA) {
-    uint8_t r0 = b[0], r1 = b[1];
-    uint64_t rbits = 0;
-    for(int i=0; i<6; ++i) rbits |= (uint64_t)b[2+i] << (8*i);
-
-    uint8_t g0 = b[8], g1 = b[9];
-    uint64_t gbits = 0;
-    for(int i=0; i<6; ++i) gbits |= (uint64_t)b[10+i] << (8*i);
-
-    uint8_t rtab[8], gtab[8];
-    rtab[0] = r0; rtab[1] = r1;
-    if(r0 > r1) {
-        for(int i=1; i<=6; i++) rtab[i+1] = (uint8_t)(((7-i)*r0 + i*r1)/7);
-    } else {
-        for(int i=1; i<=4; i++) rtab[i+1] = (uint8_t)(((5-i)*r0 + i*r1)/5);
-        rtab[6] = 0; rtab[7] = 255;
-    }
-
-    gtab[0] = g0; gtab[1] = g1;
-    if(g0 > g1) {
-        for(int i=1; i<=6; i++) gtab[i+1] = (uint8_t)(((7-i)*g0 + i*g1)/7);
-    } else {
-        for(int i=1; i<=4; i++) gtab[i+1] = (uint8_t)(((5-i)*g0 + i*g1)/5);
-        gtab[6] = 0; gtab[7] = 255;
-    }
-
-    for(int i=0; i<16; ++i) {
-        uint8_t ri = (uint8_t)((rbits >> (3*i)) & 7);
-        uint8_t gi = (uint8_t)((gbits >> (3*i)) & 7);
-        uint8_t r = rtab[ri];
-        uint8_t g = gtab[gi];
-
-        float nx = (r / 255.0f) * 2.0f - 1.0f;
-        float ny = (g / 255.0f) * 2.0f - 1.0f;
-        float nz = sqrtf(std::max(0.0f, 1.0f - nx*nx - ny*ny));
-
-        uint8_t br = (uint8_t)((nx * 0.5f + 0.5f) * 255.0f);
-        uint8_t bg = (uint8_t)((ny * 0.5f + 0.5f) * 255.0f);
-        uint8_t bb = (uint8_t)((nz * 0.5f + 0.5f) * 255.0f);
+// Welds exact duplicates, orders triangles for the post-transform cache and
+// overdraw, then vertices by first use. Tangents must already be final.
+// A mesh with a stream that does not match its vertex count is left as is.
+static void optimize_geom_for_export(MDLMeshGeom& g) {
+    size_t vcount = g.positions.size() / 3;
+    auto fits = [&](size_t n, size_t width) { return n == 0 || n == vcount * width; };
+    if (!fits(g.normals.size(), 3) || !fits(g.tangents.size(), 4) || !fits(g.uvs.size(), 2) ||
+        !fits(g.bone_ids.size(), 4) || !fits(g.bone_weights.size(), 4))
+        return;
+
+    std::vector<VertexStream> streams = {{g.positions.data(), 12}};
+    if (!g.normals.empty()) streams.push_back({g.normals.data(), 12});
+    if (!g.tangents.empty()) streams.push_back({g.tangents.data(), 16});
+    if (!g.uvs.empty()) streams.push_back({g.uvs.data(), 8});
+    if (!g.bone_ids.empty()) streams.push_back({g.bone_ids.data(), 8});
+    if (!g.bone_weights.empty()) streams.push_back({g.bone_weights.data(), 16});
+
+    auto apply = [&](const std::vector<uint32_t>& remap, size_t n) {
+        remap_vertices(g.positions, 3, remap, n);
+        if (!g.normals.empty()) remap_vertices(g.normals, 3, remap, n);
+        if (!g.tangents.empty()) remap_vertices(g.tangents, 4, remap, n);
+        if (!g.uvs.empty()) remap_vertices(g.uvs, 2, remap, n);
+        if (!g.bone_ids.empty()) remap_vertices(g.bone_ids, 4, remap, n);
+        if (!g.bone_weights.empty()) remap_vertices(g.bone_weights, 4, remap, n);
+    };
 
-        outRGBA[i] = (0xFFu << 24) | (bb << 16) | (bg << 8) | br;
-    }
+    std::vector<uint32_t> remap;
+    size_t n = weld_vertex_remap(g.indices, streams, vcount, remap);
+    apply(remap, n);
+    optimize_triangle_order(g.indices, g.positions);
+    n = vertex_fetch_remap(g.indices, n, remap);
+    apply(remap, n);
 }
 
-static void swap_bc1_endian(uint8_t* data, size_t size) {
-    for(size_t i = 0; i + 8 <= size; i += 8) {
-        uint16_t c0 = (data[i+0] << 8) | data[i+1];
-        uint16_t c1 = (data[i+2] << 8) | data[i+3];
-        uint32_t idx = (data[i+4] << 24) | (data[i+5] << 16) | (data[i+6] << 8) | data[i+7];
-        data[i+0] = c0 & 0xFF;
-        data[i+1] = (c0 >> 8) & 0xFF;
-        data[i+2] = c1 & 0xFF;
-        data[i+3] = (c1 >> 8) & 0xFF;
-        data[i+4] = idx & 0xFF;
-        data[i+5] = (idx >> 8) & 0xFF;
-        data[i+6] = (idx >> 16) & 0xFF;
-        data[i+7] = (idx >> 24) & 0xFF;
+// Simplification error allowed per LOD level, as a fraction of the mesh's
+// bounding-box diagonal.
+constexpr float LOD_ERROR_PER_LEVEL = 0.01f;
+
+// Tangents, the optional optimization pass and the LOD chain for one mesh.
+// Each level simplifies the one before and shares its vertices; the chain
+// ends early once a level no longer sheds a tenth of its triangles.
+// `inner_threads` caps the threads tangent generation may start.
+static void prepare_geom_for_export(MDLMeshGeom& g, const GlbExportOptions& opts, int inner_threads,
+                                    std::vector<std::vector<uint32_t>>& lods) {
+    if (g.positions.empty() || g.indices.empty()) return;
+    size_t vcount = g.positions.size() / 3;
+
+    // Tangents stored in the vertex stream win; otherwise they are
+    // generated so the material's normal map can be hooked up downstream.
+    if (g.tangents.size() != vcount * 4 && g.normals.size() == vcount * 3 && g.uvs.size() == vcount * 2) {
+        generate_tangents(g.positions, g.normals, g.uvs, g.indices, g.tangents, inner_threads);
+    }
+    if (opts.optimize) {
+        optimize_geom_for_export(g);
+        vcount = g.positions.size() / 3;
+    }
+    if (opts.lod_levels <= 0 || g.indices.empty()) return;
+
+    std::vector<VertexStream> attributes;
+    if (g.normals.size() == vcount * 3) attributes.push_back({g.normals.data(), 12});
+    if (g.tangents.size() == vcount * 4) attributes.push_back({g.tangents.data(), 16});
+    if (g.uvs.size() == vcount * 2) attributes.push_back({g.uvs.data(), 8});
+    bool skinned = g.bone_ids.size() == vcount * 4 && g.bone_weights.size() == vcount * 4;
+    float ratio = std::clamp(opts.lod_ratio, 0.05f, 0.95f);
+
+    for (int level = 1; level <= opts.lod_levels; ++level) {
+        const std::vector<uint32_t>& src = lods.empty() ? g.indices : lods.back();
+        size_t target = (size_t)((float)(src.size() / 3) * ratio) * 3;
+        std::vector<uint32_t> lod;
+        simplify_mesh(src, g.positions, attributes, skinned ? g.bone_ids.data() : nullptr,
+                      skinned ? g.bone_weights.data() : nullptr, target, LOD_ERROR_PER_LEVEL * (float)level, lod);
+        if (lod.empty() || lod.size() * 10 > src.size() * 9) break;
+        if (opts.optimize) optimize_triangle_order(lod, g.positions);
+        lods.push_back(std::move(lod));
     }
 }
-
-static void swap_bc3_endian(uint8_t* data, size_t size) {
-    for(size_t i = 0; i + 16 <= size; i += 16) {
-        uint64_t alpha_bits = 0;
-        for(int j = 0; j < 6; j++) {
-            alpha_bits |= ((uint64_t)data[i+2+j]) << (j*8);
-        }
-
-        uint64_t alpha_swapped = 0;
-        for(int j = 0; j < 6; j++) {
-            alpha_swapped |= ((alpha_bits >> (j*8)) & 0xFF) << ((5-j)*8);
-        }
-
-        for(int j = 0; j < 6; j++) {
-            data[i+2+j] = (alpha_swapped >> (j*8)) & 0xFF;
-        }
-
-        swap_bc1_endian(data + i + 8, 8);
-    }
 }
 
-static void swap_bc5_endian(uint8_t* data, size_t size) {
-    for(size_t i = 0; i + 16 <= size; i += 16) {
-        uint64_t r_bits = 0;
-        for(int j = 0; j < 6; j++) {
-            r_bits |= ((uint64_t)data[i+2+j]) << (j*8);
-        }
-
-        uint64_t r_swapped = 0;
-        for(int j = 0; j < 6; j++) {
-            r_swapped |= ((r_bits >> (j*8)) & 0xFF) << ((5-j)*8);
-        }
-
-        for(int j = 0; j < 6; j++) {
-            data[i+2+j] = (r_swapped >> (j*8)) & 0xFF;
-        }
-
-        uint64_t g_bits = 0;
-        for(int j = 0; j < 6; j++) {
-            g_bits |= ((uint64_t)data[i+10+j]) << (j*8);
-        }
-
-        uint64_t g_swapped = 0;
-        for(int j = 0; j < 6; j++) {
-            g_swapped |= ((g_bits >> (j*8)) & 0xFF) << ((5-j)*8);
-        }
-
-        for(int j = 0; j < 6; j++) {
-            data[i+10+j] = (g_swapped >> (j*8)) & 0xFF;
-        }
-    }
+bool texture_to_png(const std::vector<unsigned char>& tex_buf, std::vector<uint8_t>& out, bool tiled, int max_threads) {
+    return decode_texture_to_png(tex_buf, out, tiled, max_threads);
 }
 
-static bool decode_texture_to_png(const std::vector<unsigned char>& tex_buf, std::vector<uint8_t>& png_out) {
-    TexInfo tex_info;
-    if (!parse_tex_info(tex_buf, tex_info) || tex_info.Mips.empty()) return false;
-
-    size_t best = 0;
-    size_t best_area = 0;
-    for (size_t i = 0; i < tex_info.Mips.size(); ++i) {
-        if (tex_info.Mips[i].CompFlag != 7) continue;
-        int w = tex_info.Mips[i].HasWH ? (int)tex_info.Mips[i].MipWidth : std::max(1, (int)tex_info.TextureWidth >> (int)i);
-        int h = tex_info.Mips[i].HasWH ? (int)tex_info.Mips[i].MipHeight : std::max(1, (int)tex_info.TextureHeight >> (int)i);
-        size_t area = (size_t)w * (size_t)h;
-        if (area > best_area) {
-            best_area = area;
-            best = i;
-        }
-    }
-
-    const auto& mip = tex_info.Mips[best];
-    int w = mip.HasWH ? (int)mip.MipWidth : std::max(1, (int)tex_info.TextureWidth >> (int)best);
-    int h = mip.HasWH ? (int)mip.MipHeight : std::max(1, (int)tex_info.TextureHeight >> (int)best);
-
-    if (mip.MipDataOffset + mip.MipDataSizeParsed > tex_buf.size()) return false;
-
-    size_t bx = (size_t)((w+3)/4), by = (size_t)((h+3)/4);
-    std::vector<uint8_t> rgba((size_t)w*(size_t)h*4, 0xFF);
-    const uint8_t* src = tex_buf.data() + mip.MipDataOffset;
-
-    if (tex_info.PixelFormat == 35) {
-        size_t sz_bc1 = bx*by*8;
-        if (mip.MipDataSizeParsed < sz_bc1) return false;
-
-        std::vector<uint8_t> swapped(src, src + sz_bc1);
-        swap_bc1_endian(swapped.data(), swapped.size());
-
-        size_t off=0;
-        for(size_t byy=0; byy<by; ++byy){
-            for(size_t bxx=0; bxx<bx; ++bxx){
-                uint32_t block[16];
-                decode_bc1_block(swapped.data()+off, block); off += 8;
-                for(int py=0; py<4; ++py){
-                    int yy = (int)byy*4 + py; if(yy>=h) break;
-                    for(int px=0; px<4; ++px){
-                        int xx=(int)bxx*4 + px; if(xx>=w) break;
-                        ((uint32_t*)rgba.data())[yy*w+xx] = block[py*4+px];
-                    }
-                }
-            }
-        }
-    } else if (tex_info.PixelFormat == 39) {
-        size_t sz_bc3 = bx*by*16;
-        if (mip.MipDataSizeParsed < sz_bc3) return false;
-
-        std::vector<uint8_t> swapped(src, src + sz_bc3);
-        swap_bc3_endian(swapped.data(), swapped.size());
-
-        size_t off=0;
-        for(size_t byy=0; byy<by; ++byy){
-            for(size_t bxx=0; bxx<bx; ++bxx){
-                uint32_t block[16];
-                decode_bc3_block(swapped.data()+off, block); off += 16;
-                for(int py=0; py<4; ++py){
-                    int yy = (int)byy*4 + py; if(yy>=h) break;
-                    for(int px=0; px<4; ++px){
-                        int xx=(int)bxx*4 + px; if(xx>=w) break;
-                        ((uint32_t*)rgba.data())[yy*w+xx] = block[py*4+px];
-                    }
-                }
-            }
-        }
-    } else if (tex_info.PixelFormat == 40) {
-        size_t sz_bc5 = bx*by*16;
-        if (mip.MipDataSizeParsed < sz_bc5) return false;
-
-        std::vector<uint8_t> swapped(src, src + sz_bc5);
-        swap_bc5_endian(swapped.data(), swapped.size());
-
-        size_t off=0;
-        for(size_t byy=0; byy<by; ++byy){
-            for(size_t bxx=0; bxx<bx; ++bxx){
-                uint32_t block[16];
-                decode_bc5_block(swapped.data()+off, block); off += 16;
-                for(int py=0; py<4; ++py){
-                    int yy = (int)byy*4 + py; if(yy>=h) break;
-                    for(int px=0; px<4; ++px){
-                        int xx=(int)bxx*4 + px; if(xx>=w) break;
-                        ((uint32_t*)rgba.data())[yy*w+xx] = block[py*4+px];
-                    }
-                }
-            }
-        }
-    } else {
-        return false;
-    }
-
-    png_out.clear();
-    png_out.push_back(0x89); png_out.push_back(0x50); png_out.push_back(0x4E); png_out.push_back(0x47);
-    png_out.push_back(0x0D); png_out.push_back(0x0A); png_out.push_back(0x1A); png_out.push_back(0x0A);
-
-    auto write_chunk = [&](const char* type, const std::vector<uint8_t>& data) {
-        uint32_t len = (uint32_t)data.size();
-        png_out.push_back((len>>24)&0xFF);
-        png_out.push_back((len>>16)&0xFF);
-        png_out.push_back((len>>8)&0xFF);
-        png_out.push_back(len&0xFF);
-
-        size_t crc_start = png_out.size();
-        png_out.push_back(type[0]); png_out.push_back(type[1]);
-        png_out.push_back(type[2]); png_out.push_back(type[3]);
-        png_out.insert(png_out.end(), data.begin(), data.end());
-
-        uint32_t crc = 0xFFFFFFFF;
-        for (size_t i = crc_start; i < png_out.size(); ++i) {
-            uint8_t byte = png_out[i];
-            crc ^= byte;
-            for (int j = 0; j < 8; ++j) {
-                if (crc & 1) crc = (crc >> 1) ^ 0xEDB88320;
-                else crc >>= 1;
-            }
-        }
-        crc ^= 0xFFFFFFFF;
-        png_out.push_back((crc>>24)&0xFF);
-        png_out.push_back((crc>>16)&0xFF);
-        png_out.push_back((crc>>8)&0xFF);
-        png_out.push_back(crc&0xFF);
-    };
-
-    std::vector<uint8_t> ihdr(13);
-    ihdr[0] = (w>>24)&0xFF; ihdr[1] = (w>>16)&0xFF; ihdr[2] = (w>>8)&0xFF; ihdr[3] = w&0xFF;
-    ihdr[4] = (h>>24)&0xFF; ihdr[5] = (h>>16)&0xFF; ihdr[6] = (h>>8)&0xFF; ihdr[7] = h&0xFF;
-    ihdr[8] = 8; ihdr[9] = 6; ihdr[10] = 0; ihdr[11] = 0; ihdr[12] = 0;
-    write_chunk("IHDR", ihdr);
-
-    std::vector<uint8_t> idat_raw;
-    for (int y = 0; y < h; ++y) {
-        idat_raw.push_back(0);
-        for (int x = 0; x < w; ++x) {
-            uint32_t px = ((uint32_t*)rgba.data())[y*w+x];
-            idat_raw.push_back((px>>0)&0xFF);
-            idat_raw.push_back((px>>8)&0xFF);
-            idat_raw.push_back((px>>16)&0xFF);
-            idat_raw.push_back((px>>24)&0xFF);
-        }
-    }
-
-    std::vector<uint8_t> idat_compressed;
-    idat_compressed.push_back(0x78); idat_compressed.push_back(0x01);
-
-    size_t block_size = 65535;
-    for (size_t pos = 0; pos < idat_raw.size(); pos += block_size) {
-        size_t chunk = std::min(block_size, idat_raw.size() - pos);
-        bool last = (pos + chunk >= idat_raw.size());
-
-        idat_compressed.push_back(last ? 0x01 : 0x00);
-        idat_compressed.push_back(chunk & 0xFF);
-        idat_compressed.push_back((chunk >> 8) & 0xFF);
-        idat_compressed.push_back((~chunk) & 0xFF);
-        idat_compressed.push_back(((~chunk) >> 8) & 0xFF);
-
-        idat_compressed.insert(idat_compressed.end(), idat_raw.begin() + pos, idat_raw.begin() + pos + chunk);
-    }
-
-    uint32_t s1 = 1, s2 = 0;
-    for (uint8_t byte : idat_raw) {
-        s1 = (s1 + byte) % 65521;
-        s2 = (s2 + s1) % 65521;
-    }
-    uint32_t adler = (s2 << 16) | s1;
-
-    idat_compressed.push_back((adler>>24)&0xFF);
-    idat_compressed.push_back((adler>>16)&0xFF);
-    idat_compressed.push_back((adler>>8)&0xFF);
-    idat_compressed.push_back(adler&0xFF);
-
-    write_chunk("IDAT", idat_compressed);
-    write_chunk("IEND", {});
-
-    return true;
-}
+bool texture_to_qoi(const std::vector<unsigned char>& tex_buf, std::vector<uint8_t>& out, bool tiled) {
+    std::vector<uint8_t> rgba;
+    int w = 0, h = 0;
+    if (!tex_decode_largest_mip(tex_buf, tiled, rgba, w, h)) return false;
+    return qoi_encode_rgba(rgba.data(), w, h, out);
 }
 
 bool mdl_to_glb_full(const std::vector<unsigned char>& mdl_data,
                      const std::string& glb_path,
                      const std::string& mdl_source_path,
-                     std::string& err_msg)
+                     std::string& err_msg,
+                     const GlbExportOptions& opts)
 {
     err_msg.clear();
 
@@ -524,6 +285,7 @@ bool mdl_to_glb_full(const std::vector<unsigned char>& mdl_data,
     int tex_count = 0;
     int mat_count = 0;
     int mesh_count = 0;
+    std::unordered_map<std::string, std::pair<int, bool>> exported_textures;
 
     auto add_data = [&](const void* data, size_t size) -> size_t {
         size_t offset = bin_data.size();
@@ -659,6 +421,46 @@ bool mdl_to_glb_full(const std::vector<unsigned char>& mdl_data,
         skin_idx = 0;
     }
 
+    // Meshes are prepared in parallel; the JSON and binary chunk below are
+    // written in mesh order. With several meshes the pool already covers
+    // max_threads, so each mesh stays on its worker.
+    std::vector<std::vector<std::vector<uint32_t>>> geom_lods(geoms.size());
+    const int inner_threads = geoms.size() > 1 ? 1 : opts.max_threads;
+    parallel_for(geoms.size(), [&](size_t gi) { prepare_geom_for_export(geoms[gi], opts, inner_threads, geom_lods[gi]); },
+                 opts.max_threads);
+
+    // Per written mesh, the ordinals of its LOD meshes (which follow all the
+    // full meshes, with one node each after the root).
+    std::ostringstream lod_meshes;
+    int lod_count = 0;
+    std::vector<std::vector<int>> mesh_lods;
+
+    // 16-bit indices whenever they fit; glTF reserves each type's largest
+    // value, so that caps the vertex count at 65535. Returns -1, writing
+    // nothing, when an index points past the mesh's vertices.
+    auto add_indices = [&](const std::vector<uint32_t>& idx, size_t vcount) -> int {
+        if (!idx.empty() && *std::max_element(idx.begin(), idx.end()) >= vcount) return -1;
+        size_t idx_offset, idx_bytes;
+        int idx_type;
+        if (vcount <= 0xFFFF) {
+            std::vector<uint16_t> narrow(idx.begin(), idx.end());
+            idx_bytes = narrow.size() * sizeof(uint16_t);
+            idx_offset = add_data(narrow.data(), idx_bytes);
+            idx_type = 5123;
+        } else {
+            idx_bytes = idx.size() * sizeof(uint32_t);
+            idx_offset = add_data(idx.data(), idx_bytes);
+            idx_type = 5125;
+        }
+        if (bv_count > 0) bufferViews << ",";
+        bufferViews << "{\"buffer\":0,\"byteOffset\":" << idx_offset << ",\"byteLength\":" << idx_bytes << ",\"target\":34963}";
+        int idx_bv = bv_count++;
+
+        if (acc_count > 0) accessors << ",";
+        accessors << "{\"bufferView\":" << idx_bv << ",\"componentType\":" << idx_type << ",\"count\":" << idx.size() << ",\"type\":\"SCALAR\"}";
+        return acc_count++;
+    };
+
     for (size_t gi = 0; gi < geoms.size(); ++gi) {
         const auto& geom = geoms[gi];
         if (geom.positions.empty() || geom.indices.empty()) continue;
@@ -720,6 +522,18 @@ bool mdl_to_glb_full(const std::vector<unsigned char>& mdl_data,
         accessors << "{\"bufferView\":" << uv_bv << ",\"componentType\":5126,\"count\":" << (geom.uvs.size()/2) << ",\"type\":\"VEC2\"}";
         int uv_acc = acc_count++;
 
+        int tan_acc = -1;
+        if (geom.tangents.size() == vcount * 4) {
+            size_t tan_offset = add_data(geom.tangents.data(), geom.tangents.size() * sizeof(float));
+            if (bv_count > 0) bufferViews << ",";
+            bufferViews << "{\"buffer\":0,\"byteOffset\":" << tan_offset << ",\"byteLength\":" << (geom.tangents.size() * sizeof(float)) << ",\"target\":34962}";
+            int tan_bv = bv_count++;
+
+            if (acc_count > 0) accessors << ",";
+            accessors << "{\"bufferView\":" << tan_bv << ",\"componentType\":5126,\"count\":" << vcount << ",\"type\":\"VEC4\"}";
+            tan_acc = acc_count++;
+        }
+
         int joints_acc = -1;
         int weights_acc = -1;
 
@@ -757,14 +571,11 @@ bool mdl_to_glb_full(const std::vector<unsigned char>& mdl_data,
             weights_acc = acc_count++;
         }
 
-        size_t idx_offset = add_data(geom.indices.data(), geom.indices.size() * sizeof(uint32_t));
-        if (bv_count > 0) bufferViews << ",";
-        bufferViews << "{\"buffer\":0,\"byteOffset\":" << idx_offset << ",\"byteLength\":" << (geom.indices.size() * sizeof(uint32_t)) << ",\"target\":34963}";
-        int idx_bv = bv_count++;
-
-        if (acc_count > 0) accessors << ",";
-        accessors << "{\"bufferView\":" << idx_bv << ",\"componentType\":5125,\"count\":" << geom.indices.size() << ",\"type\":\"SCALAR\"}";
-        int idx_acc = acc_count++;
+        int idx_acc = add_indices(geom.indices, vcount);
+        if (idx_acc < 0) {
+            err_msg = "Mesh " + std::to_string(gi) + " has indices past its " + std::to_string(vcount) + " vertices";
+            return false;
+        }
 
         std::string mesh_name = model_name + "_mesh_" + std::to_string(gi);
 
@@ -785,14 +596,15 @@ bool mdl_to_glb_full(const std::vector<unsigned char>& mdl_data,
         if (!geom.diffuse_tex_name.empty()) {
             material_name = std::filesystem::path(geom.diffuse_tex_name).stem().string();
 
-            std::vector<unsigned char> tex_buf;
-            if (build_any_tex_buffer_for_name(geom.diffuse_tex_name, tex_buf)) {
+            // Meshes sharing a texture share one glTF image.
+            auto done = exported_textures.find(geom.diffuse_tex_name);
+            if (done != exported_textures.end()) {
+                tex_idx = done->second.first;
+                has_alpha = done->second.second;
+            } else if (TexImagePtr img = tex_cache_image(geom.diffuse_tex_name, texture_is_tiled(geom.diffuse_tex_name))) {
                 std::vector<uint8_t> png_data;
-                if (decode_texture_to_png(tex_buf, png_data)) {
-                    TexInfo tex_info;
-                    if (parse_tex_info(tex_buf, tex_info)) {
-                        has_alpha = (tex_info.PixelFormat == 39);
-                    }
+                if (png_encode_rgba(img->rgba.data(), img->width, img->height, png_data, 6)) {
+                    has_alpha = (img->pixel_format == 39);
 
                     size_t img_offset = add_data(png_data.data(), png_data.size());
 
@@ -808,6 +620,7 @@ bool mdl_to_glb_full(const std::vector<unsigned char>& mdl_data,
                     textures << "{\"source\":" << img_idx << "}";
                     tex_idx = tex_count++;
                 }
+                exported_textures[geom.diffuse_tex_name] = {tex_idx, has_alpha};
             }
 
             if (mat_count > 0) materials << ",";
@@ -824,26 +637,43 @@ bool mdl_to_glb_full(const std::vector<unsigned char>& mdl_data,
             this_mat_idx = mat_count++;
         }
 
-        meshes << "{";
-        meshes << "\"attributes\":{";
-        meshes << "\"POSITION\":" << pos_acc << ",";
-        meshes << "\"NORMAL\":" << norm_acc << ",";
-        meshes << "\"TEXCOORD_0\":" << uv_acc;
+        std::ostringstream attributes;
+        attributes << "\"attributes\":{";
+        attributes << "\"POSITION\":" << pos_acc << ",";
+        attributes << "\"NORMAL\":" << norm_acc << ",";
+        attributes << "\"TEXCOORD_0\":" << uv_acc;
+        if (tan_acc >= 0) attributes << ",\"TANGENT\":" << tan_acc;
 
         if (joints_acc >= 0 && weights_acc >= 0) {
-            meshes << ",\"JOINTS_0\":" << joints_acc;
-            meshes << ",\"WEIGHTS_0\":" << weights_acc;
+            attributes << ",\"JOINTS_0\":" << joints_acc;
+            attributes << ",\"WEIGHTS_0\":" << weights_acc;
         }
 
-        meshes << "},";
+        attributes << "},";
+        std::string material = this_mat_idx >= 0 ? ",\"material\":" + std::to_string(this_mat_idx) : "";
+
+        meshes << "{" << attributes.str();
         meshes << "\"indices\":" << idx_acc;
-        if (this_mat_idx >= 0) {
-            meshes << ",\"material\":" << this_mat_idx;
-        }
+        meshes << material;
         meshes << "}";
 
         meshes << "]}";
         mesh_count++;
+
+        // LOD meshes reuse this mesh's vertex accessors with their own indices.
+        mesh_lods.emplace_back();
+        for (size_t li = 0; li < geom_lods[gi].size(); ++li) {
+            int lod_idx_acc = add_indices(geom_lods[gi][li], vcount);
+            if (lod_idx_acc < 0) {
+                err_msg = "LOD " + std::to_string(li + 1) + " of mesh " + std::to_string(gi) + " has indices past its " +
+                          std::to_string(vcount) + " vertices";
+                return false;
+            }
+            if (lod_count > 0) lod_meshes << ",";
+            lod_meshes << "{\"name\":\"" << json_escape(mesh_name + "_LOD" + std::to_string(li + 1)) << "\",\"primitives\":[{";
+            lod_meshes << attributes.str() << "\"indices\":" << lod_idx_acc << material << "}]}";
+            mesh_lods.back().push_back(lod_count++);
+        }
     }
 
     int first_mesh_node = bone_node_count;
@@ -856,6 +686,7 @@ bool mdl_to_glb_full(const std::vector<unsigned char>& mdl_data,
 
     json << "{";
     json << "\"asset\":{\"version\":\"2.0\",\"generator\":\"fable2_exporter\"},";
+    if (lod_count > 0) json << "\"extensionsUsed\":[\"MSFT_lod\"],";
     json << "\"scene\":0,";
     json << "\"scenes\":[{\"nodes\":[" << root_wrapper_node << "]}],";
 
@@ -870,6 +701,17 @@ bool mdl_to_glb_full(const std::vector<unsigned char>& mdl_data,
         if (skin_idx >= 0) {
             json << ",\"skin\":" << skin_idx;
         }
+        const auto& lods = mesh_lods[(size_t)i];
+        if (!lods.empty()) {
+            // Switch points follow the triangle ratio, so the on-screen
+            // triangle density stays about the same from level to level.
+            json << ",\"extensions\":{\"MSFT_lod\":{\"ids\":[";
+            for (size_t k = 0; k < lods.size(); ++k) json << (k ? "," : "") << (root_wrapper_node + 1 + lods[k]);
+            json << "]}},\"extras\":{\"MSFT_screencoverage\":[";
+            float coverage = 0.5f;
+            for (size_t k = 0; k < lods.size(); ++k, coverage *= opts.lod_ratio) json << coverage << ",";
+            json << "0]}";
+        }
         json << "}";
     }
     json << ",{\"name\":\"Root\",\"rotation\":[-0.7071068,0,0,0.7071068],\"children\":[";
@@ -878,9 +720,18 @@ bool mdl_to_glb_full(const std::vector<unsigned char>& mdl_data,
         json << wrapper_children[i];
     }
     json << "]}";
+    for (int i = 0; i < lod_count; ++i) {
+        json << ",{\"mesh\":" << (mesh_count + i);
+        if (skin_idx >= 0) {
+            json << ",\"skin\":" << skin_idx;
+        }
+        json << "}";
+    }
     json << "],";
 
-    json << "\"meshes\":[" << meshes.str() << "],";
+    json << "\"meshes\":[" << meshes.str();
+    if (lod_count > 0) json << "," << lod_meshes.str();
+    json << "],";
     json << "\"buffers\":[{\"byteLength\":" << bin_data.size() << "}],";
     json << "\"bufferViews\":[" << bufferViews.str() << "],";
     json << "\"accessors\":[" << accessors.str() << "]";
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -6,11 +7,33 @@ bool mdl_to_glb_file_ex(const std::string& mdl_path,
                         const std::string& glb_path,
                         std::string& err_msg);
 
+struct GlbExportOptions {
+    // Weld each mesh and reorder it for the vertex cache and overdraw
+    // (see MeshProcess.h).
+    bool optimize = false;
+    // Simplified levels written after the full mesh, linked with MSFT_lod;
+    // each keeps about lod_ratio of the triangles of the one before.
+    int lod_levels = 0;
+    float lod_ratio = 0.5f;
+    // Meshes are prepared in parallel; bulk exports that already run one
+    // model per thread pass fewer.
+    int max_threads = 8;
+};
+
+// Indices are 16-bit whenever the vertex count allows.
 bool mdl_to_glb_full(const std::vector<unsigned char>& mdl_data,
                      const std::string& glb_path,
                      const std::string& mdl_source_path,
-                     std::string& err_msg);
+                     std::string& err_msg,
+                     const GlbExportOptions& opts = {});
 
 bool mdl_to_glb_file_ex(const std::string& mdl_path,
                         const std::string& glb_path,
-                        std::string& err_msg);
\ No newline at end of file
+                        std::string& err_msg);
+
+// Decode the largest raw mip of a rebuilt .tex and encode it on its own,
+// for texture export outside of GLB. PNG is compact, QOI is quick. Bulk
+// exports that already run one texture per thread pass max_threads = 1.
+bool texture_to_png(const std::vector<unsigned char>& tex_buf, std::vector<uint8_t>& out, bool tiled = false,
+                    int max_threads = 0);
+bool texture_to_qoi(const std::vector<unsigned char>& tex_buf, std::vector<uint8_t>& out, bool tiled = false);
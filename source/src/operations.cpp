@@ -15,6 +15,7 @@
 #include <optional>
 #include "HexView.h"
 #include "mdl_converter.h"
+#include "RebuildEngine.h"
 
 static std::string apply_folder_prefix_to_filename(const std::string& full_path, const std::string& extension) {
     std::string lower_path = full_path;
@@ -41,13 +42,57 @@ static std::string apply_folder_prefix_to_filename(const std::string& full_path,
     return result;
 }
 
+static GlbExportOptions glb_export_options() {
+    GlbExportOptions opts;
+    opts.optimize = S.glb_optimize_meshes;
+    opts.lod_levels = S.glb_lod_levels;
+    opts.lod_ratio = S.glb_lod_ratio;
+    return opts;
+}
+
+static std::filesystem::path rebuilt_model_path(const std::string &out_root, const std::string &name) {
+    return std::filesystem::path(out_root) / std::filesystem::path(name).parent_path() /
+           apply_folder_prefix_to_filename(name, ".mdl");
+}
+
+// Plans and runs a rebuild on a background thread; opening and listing the
+// global BNKs is itself slow enough to keep off the UI thread. With
+// `missing_failed`, names that had no header count towards the failures.
+static void start_rebuild(const std::string &title, const std::string &done_text, const std::string &empty_error,
+                          const std::string &out_root, bool missing_failed,
+                          std::function<bool(RebuildPlan &, std::string &)> plan_fn) {
+    TexExportFormat tex_fmt = S.tex_export_format;
+    progress_open(1, title);
+    progress_update(0, 1, "Resolving names...");
+    std::thread([=]() {
+        RebuildPlan plan;
+        std::string err;
+        if (!plan_fn(plan, err) || plan.jobs.empty()) {
+            progress_done();
+            show_error_box(err.empty() ? empty_error : err);
+            S.cancel_requested = false;
+            return;
+        }
+
+        RebuildStats stats = run_rebuild(plan, tex_fmt);
+        progress_done();
+        int failed = stats.failed + (missing_failed ? (int) plan.missing.size() : 0);
+        if (!stats.cancelled) {
+            std::string msg = done_text + "\n\nOutput folder:\n" + std::filesystem::absolute(out_root).string();
+            if (failed) msg += std::string("\nFailed: ") + std::to_string(failed);
+            show_completion_box(msg);
+        }
+        S.cancel_requested = false;
+    }).detach();
+}
+
 void extract_file_one(const std::string &bnk_path, const BNKItemUI &item, const std::string &base_out_dir,
                              bool convert_audio) {
     std::filesystem::create_directories(base_out_dir);
     auto dst = std::filesystem::path(base_out_dir) / item.name;
     std::filesystem::create_directories(dst.parent_path());
     extract_one(bnk_path, item.index, dst.string());
-    if (convert_audio && is_audio_file(item.name)) convert_wav_inplace_same_name(dst);
+    if (convert_audio && item.type == AssetType::Wav) convert_wav_inplace_same_name(dst);
 }
 
 void on_extract_selected_raw() {
@@ -96,7 +141,7 @@ void on_extract_selected_wav() {
         return;
     }
     auto item = S.files[(size_t) idx];
-    if (!is_audio_file(item.name)) {
+    if (item.type != AssetType::Wav) {
         show_error_box("Selected file is not .wav");
         return;
     }
@@ -179,7 +224,7 @@ void on_export_wavs() {
         return;
     }
     std::vector<BNKItemUI> audio_files;
-    for (auto &f: S.files) if (is_audio_file(f.name)) audio_files.push_back(f);
+    for (auto &f: S.files) if (f.type == AssetType::Wav) audio_files.push_back(f);
     if (audio_files.empty()) {
         show_error_box("No .wav files in this BNK.");
         return;
@@ -226,132 +271,23 @@ void on_export_wavs() {
 }
 
 void on_rebuild_and_extract() {
-    auto p_headers = find_bnk_by_filename("globals_texture_headers.bnk");
-    auto p_mip0 = find_bnk_by_filename("1024mip0_textures.bnk");
-    auto p_rest = find_bnk_by_filename("globals_textures.bnk");
-    if (!p_headers || !p_rest) {
-        show_error_box("Required BNKs not found.");
-        return;
-    }
-
-    BNKReader r_headers(*p_headers);
-    BNKReader r_rest(*p_rest);
-    std::optional<BNKReader> r_mip0;
-    if (p_mip0) r_mip0.emplace(*p_mip0);
-
-    struct Entry {
-        int idx;
-        std::string name;
-        uint32_t size;
-    };
-    std::vector<Entry> H, R, M;
-    for (size_t i = 0; i < r_headers.list_files().size(); ++i) {
-        auto &e = r_headers.list_files()[i];
-        H.push_back({(int) i, e.name, e.uncompressed_size});
-    }
-    for (size_t i = 0; i < r_rest.list_files().size(); ++i) {
-        auto &e = r_rest.list_files()[i];
-        R.push_back({(int) i, e.name, e.uncompressed_size});
-    }
-    if (r_mip0) for (size_t i = 0; i < r_mip0->list_files().size(); ++i) {
-        auto &e = r_mip0->list_files()[i];
-        M.push_back({(int) i, e.name, e.uncompressed_size});
-    }
-
-    std::unordered_map<std::string, int> mapH, mapR, mapM;
-    mapH.reserve(H.size() * 2 + 1);
-    mapR.reserve(R.size() * 2 + 1);
-    mapM.reserve(M.size() * 2 + 1);
-    for (auto &e: H) {
-        std::string fname = std::filesystem::path(e.name).filename().string();
-        std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-        mapH.emplace(fname, e.idx);
-    }
-    for (auto &e: R) {
-        std::string fname = std::filesystem::path(e.name).filename().string();
-        std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-        mapR.emplace(fname, e.idx);
-    }
-    for (auto &e: M) {
-        std::string fname = std::filesystem::path(e.name).filename().string();
-        std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-        mapM.emplace(fname, e.idx);
-    }
-
-    std::vector<std::string> names;
-    names.reserve(std::max(H.size(), R.size()));
-    for (auto &e: H) names.push_back(e.name);
-    for (auto &e: R) {
-        std::string fname = std::filesystem::path(e.name).filename().string();
-        std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-        if (!mapH.count(fname)) names.push_back(e.name);
-    }
-
-    int total = (int) names.size();
-    if (total <= 0) {
-        show_error_box("No texture names found.");
-        return;
-    }
-
     auto out_root = (std::filesystem::current_path() / "extracted").string();
-    progress_open(total, "Rebuilding...");
-    progress_update(0, total, "Starting...");
-    std::thread([=]() {
-        int done = 0;
-        auto tmpdir = std::filesystem::temp_directory_path() / "f2_tex_rebuild";
-        std::error_code ec;
-        std::filesystem::create_directories(tmpdir, ec);
-        for (auto &name: names) {
-            if (S.cancel_requested || S.exiting) break;
-            std::string fname = std::filesystem::path(name).filename().string();
-            std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-            if (!mapH.count(fname) || !mapR.count(fname)) {
-                progress_update(++done, total, name);
-                continue;
-            }
-            auto out_path = std::filesystem::path(out_root) / name;
-            std::filesystem::create_directories(out_path.parent_path(), ec);
-
-            auto tmp_h = tmpdir / ("h_" + std::to_string(done) + ".bin");
-            auto tmp_m = tmpdir / ("m_" + std::to_string(done) + ".bin");
-            auto tmp_r = tmpdir / ("r_" + std::to_string(done) + ".bin");
-
-            try {
-                extract_one(*p_headers, mapH.at(fname), tmp_h.string());
-                if (mapM.count(fname) && p_mip0) extract_one(*p_mip0, mapM.at(fname), tmp_m.string());
-                extract_one(*p_rest, mapR.at(fname), tmp_r.string());
-
-                std::ofstream out(out_path, std::ios::binary);
-                std::ifstream fh(tmp_h, std::ios::binary);
-                out << fh.rdbuf();
-                if (std::filesystem::exists(tmp_m)) {
-                    std::ifstream fm(tmp_m, std::ios::binary);
-                    out << fm.rdbuf();
-                }
-                std::ifstream fr(tmp_r, std::ios::binary);
-                out << fr.rdbuf();
-
-                std::filesystem::remove(tmp_h, ec);
-                if (std::filesystem::exists(tmp_m)) std::filesystem::remove(tmp_m, ec);
-                std::filesystem::remove(tmp_r, ec);
-            } catch (...) {
-            }
-            progress_update(++done, total, name);
-        }
-        progress_done();
-        if (!S.cancel_requested) show_completion_box(
-            std::string("Rebuild complete.\n\nOutput folder:\n") + std::filesystem::absolute(out_root).string());
-        S.cancel_requested = false;
-    }).detach();
+    start_rebuild("Rebuilding...", "Rebuild complete.", "No texture names found.", out_root, false,
+                  [out_root](RebuildPlan &plan, std::string &err) {
+                      return plan_texture_rebuild(nullptr, [&](const std::string &name) {
+                          return std::filesystem::path(out_root) / name;
+                      }, plan, err);
+                  });
 }
 
 void on_rebuild_and_extract_models() {
-    bool is_nested = (S.selected_nested_index != -1 && !S.selected_nested_temp_path.empty());
+    auto out_root = (std::filesystem::current_path() / "extracted").string();
+    auto out_path_for = [out_root](const std::string &name) { return rebuilt_model_path(out_root, name); };
 
-    if (is_nested) {
+    if (S.selected_nested_index != -1 && !S.selected_nested_temp_path.empty()) {
         std::vector<BNKItemUI> mdl_files;
         for (auto &f: S.files) {
-            if (is_mdl_file(f.name)) {
+            if (f.type == AssetType::Mdl) {
                 mdl_files.push_back(f);
             }
         }
@@ -361,386 +297,53 @@ void on_rebuild_and_extract_models() {
             return;
         }
 
-        auto p_headers = find_bnk_by_filename("globals_model_headers.bnk");
-        if (!p_headers) {
-            show_error_box("globals_model_headers.bnk not found.");
-            return;
-        }
-
-        BNKReader r_headers(*p_headers);
-        std::unordered_map<std::string, int> mapH;
-        for (size_t i = 0; i < r_headers.list_files().size(); ++i) {
-            auto &e = r_headers.list_files()[i];
-            std::string fname = std::filesystem::path(e.name).filename().string();
-            std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-            mapH.emplace(fname, (int)i);
-        }
-
-        auto out_root = (std::filesystem::current_path() / "extracted").string();
-        int total = (int)mdl_files.size();
-        progress_open(total, "Rebuilding models...");
-        progress_update(0, total, "Starting...");
-
         std::string nested_path = S.selected_nested_temp_path;
-        std::string p_headers_copy = *p_headers;
-
-        std::thread([mdl_files, out_root, total, nested_path, p_headers_copy, mapH]() {
-            std::atomic<int> done{0};
-            std::mutex fail_m;
-            std::vector<std::string> failed;
-
-            auto work = [&](const BNKItemUI &it) {
-                if (S.cancel_requested || S.exiting) return;
-
-                std::string fname = std::filesystem::path(it.name).filename().string();
-                std::string fname_lower = fname;
-                std::transform(fname_lower.begin(), fname_lower.end(), fname_lower.begin(), ::tolower);
-
-                if (!mapH.count(fname_lower)) {
-                    std::lock_guard<std::mutex> lk(fail_m);
-                    failed.push_back(it.name);
-                    return;
-                }
-
-                try {
-                    auto tmpdir = std::filesystem::temp_directory_path() / "f2_mdl_rebuild_nested";
-                    std::error_code ec;
-                    std::filesystem::create_directories(tmpdir, ec);
-
-                    std::string output_filename = apply_folder_prefix_to_filename(it.name, ".mdl");
-                    auto out_dir = std::filesystem::path(out_root) / std::filesystem::path(it.name).parent_path();
-                    auto out_path = out_dir / output_filename;
-                    std::filesystem::create_directories(out_path.parent_path(), ec);
-
-                    auto tmp_h = tmpdir / ("h_" + std::to_string(it.index) + ".bin");
-                    auto tmp_r = tmpdir / ("r_" + std::to_string(it.index) + ".bin");
-
-                    extract_one(p_headers_copy, mapH.at(fname_lower), tmp_h.string());
-                    extract_one(nested_path, it.index, tmp_r.string());
-
-                    std::ofstream out(out_path, std::ios::binary);
-                    { std::ifstream fh(tmp_h, std::ios::binary); out << fh.rdbuf(); }
-                    { std::ifstream fr(tmp_r, std::ios::binary); out << fr.rdbuf(); }
-
-                    std::filesystem::remove(tmp_h, ec);
-                    std::filesystem::remove(tmp_r, ec);
-                } catch (...) {
-                    std::lock_guard<std::mutex> lk(fail_m);
-                    failed.push_back(it.name);
-                }
-
-                int cur = ++done;
-                progress_update(cur, total, std::filesystem::path(it.name).filename().string());
-            };
-
-            if (!S.cancel_requested) {
-                std::vector<std::thread> pool;
-                int n = std::min(4, std::max(1, (int)std::thread::hardware_concurrency() / 2));
-                std::atomic<size_t> i{0};
-                for (int t = 0; t < n; ++t) pool.emplace_back([&]() {
-                    for (;;) {
-                        size_t k = i.fetch_add(1);
-                        if (k >= mdl_files.size()) break;
-                        work(mdl_files[k]);
-                    }
-                });
-                for (auto &th: pool) th.join();
-            }
-
-            progress_done();
-            std::string msg = std::string("Model rebuild complete.\n\nOutput folder:\n") + std::filesystem::absolute(out_root).string();
-            if (!failed.empty()) {
-                msg += std::string("\nFailed: ") + std::to_string((int)failed.size());
-            }
-            show_completion_box(msg);
-            S.cancel_requested = false;
-        }).detach();
-
+        start_rebuild("Rebuilding models...", "Model rebuild complete.",
+                      "Model header not found in globals_model_headers.bnk.", out_root, true,
+                      [mdl_files, nested_path, out_path_for](RebuildPlan &plan, std::string &err) {
+                          return plan_nested_model_rebuild(mdl_files, nested_path, out_path_for, plan, err);
+                      });
         return;
     }
 
-    auto p_headers = find_bnk_by_filename("globals_model_headers.bnk");
-    auto p_rest    = find_bnk_by_filename("globals_models.bnk");
-    if (!p_headers || !p_rest) {
-        show_error_box("Required BNKs not found.");
-        return;
-    }
-
-    BNKReader r_headers(*p_headers);
-    BNKReader r_rest(*p_rest);
-
-    struct Entry { int idx; std::string name; uint32_t size; };
-    std::vector<Entry> H, R;
-    for (size_t i = 0; i < r_headers.list_files().size(); ++i) {
-        auto &e = r_headers.list_files()[i];
-        H.push_back({(int)i, e.name, e.uncompressed_size});
-    }
-    for (size_t i = 0; i < r_rest.list_files().size(); ++i) {
-        auto &e = r_rest.list_files()[i];
-        R.push_back({(int)i, e.name, e.uncompressed_size});
-    }
-
-    std::unordered_map<std::string, int> mapH, mapR;
-    mapH.reserve(H.size() * 2 + 1);
-    mapR.reserve(R.size() * 2 + 1);
-    for (auto &e : H) {
-        std::string fname = std::filesystem::path(e.name).filename().string();
-        std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-        mapH.emplace(fname, e.idx);
-    }
-    for (auto &e : R) {
-        std::string fname = std::filesystem::path(e.name).filename().string();
-        std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-        mapR.emplace(fname, e.idx);
-    }
-
-    std::vector<std::string> names;
-    names.reserve(std::max(H.size(), R.size()));
-    for (auto &e : H) names.push_back(e.name);
-    for (auto &e : R) {
-        std::string fname = std::filesystem::path(e.name).filename().string();
-        std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-        if (!mapH.count(fname)) names.push_back(e.name);
-    }
-
-    const int total = (int)names.size();
-    if (total <= 0) {
-        show_error_box("No model names found.");
-        return;
-    }
-
-    auto out_root = (std::filesystem::current_path() / "extracted").string();
-    progress_open(total, "Rebuilding models...");
-    progress_update(0, total, "Starting...");
-
-    std::thread([=]() {
-        int done = 0;
-        auto tmpdir = std::filesystem::temp_directory_path() / "f2_mdl_rebuild";
-        std::error_code ec;
-        std::filesystem::create_directories(tmpdir, ec);
-
-        for (auto &name : names) {
-            if (S.cancel_requested || S.exiting) break;
-
-            std::string fname = std::filesystem::path(name).filename().string();
-            std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-
-            if (!mapH.count(fname) || !mapR.count(fname)) {
-                progress_update(++done, total, name);
-                continue;
-            }
-
-            std::string output_filename = apply_folder_prefix_to_filename(name, ".mdl");
-            auto out_dir = std::filesystem::path(out_root) / std::filesystem::path(name).parent_path();
-            auto out_path = out_dir / output_filename;
-            std::filesystem::create_directories(out_path.parent_path(), ec);
-
-            auto tmp_h = tmpdir / ("h_" + std::to_string(done) + ".bin");
-            auto tmp_r = tmpdir / ("r_" + std::to_string(done) + ".bin");
-
-            try {
-                extract_one(*p_headers, mapH.at(fname), tmp_h.string());
-                extract_one(*p_rest,    mapR.at(fname), tmp_r.string());
-
-                std::ofstream out(out_path, std::ios::binary);
-                { std::ifstream fh(tmp_h, std::ios::binary); out << fh.rdbuf(); }
-                { std::ifstream fr(tmp_r, std::ios::binary); out << fr.rdbuf(); }
-
-                std::filesystem::remove(tmp_h, ec);
-                std::filesystem::remove(tmp_r, ec);
-            } catch (...) {}
-
-            progress_update(++done, total, name);
-        }
-
-        progress_done();
-        if (!S.cancel_requested)
-            show_completion_box(std::string("Model rebuild complete.\n\nOutput folder:\n") + std::filesystem::absolute(out_root).string());
-        S.cancel_requested = false;
-    }).detach();
+    start_rebuild("Rebuilding models...", "Model rebuild complete.", "No model names found.", out_root, false,
+                  [out_path_for](RebuildPlan &plan, std::string &err) {
+                      return plan_model_rebuild(nullptr, out_path_for, plan, err);
+                  });
 }
 
 void on_rebuild_and_extract_one(const std::string &tex_name) {
-    auto p_headers = find_bnk_by_filename("globals_texture_headers.bnk");
-    auto p_mip0 = find_bnk_by_filename("1024mip0_textures.bnk");
-    auto p_rest = find_bnk_by_filename("globals_textures.bnk");
-    if (!p_headers || !p_rest) {
-        show_error_box("Required BNKs not found.");
-        return;
-    }
-
-    BNKReader r_headers(*p_headers);
-    BNKReader r_rest(*p_rest);
-    std::optional<BNKReader> r_mip0;
-    if (p_mip0) r_mip0.emplace(*p_mip0);
-
-    std::unordered_map<std::string, int> mapH, mapR, mapM;
-    for (size_t i = 0; i < r_headers.list_files().size(); ++i) {
-        auto &e = r_headers.list_files()[i];
-        std::string fname = e.name;
-        std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-        std::replace(fname.begin(), fname.end(), '\\', '/');
-        mapH.emplace(fname, (int) i);
-    }
-    for (size_t i = 0; i < r_rest.list_files().size(); ++i) {
-        auto &e = r_rest.list_files()[i];
-        std::string fname = e.name;
-        std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-        std::replace(fname.begin(), fname.end(), '\\', '/');
-        mapR.emplace(fname, (int) i);
-    }
-    if (r_mip0)
-        for (size_t i = 0; i < r_mip0->list_files().size(); ++i) {
-            auto &e = r_mip0->list_files()[i];
-            std::string fname = e.name;
-            std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-            std::replace(fname.begin(), fname.end(), '\\', '/');
-            mapM.emplace(fname, (int) i);
-        }
-
-    std::string key = tex_name;
-    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
-    std::replace(key.begin(), key.end(), '\\', '/');
-    if (!mapH.count(key) || !mapR.count(key)) {
-        show_error_box("Texture not found in required BNKs.");
-        return;
-    }
-
     auto out_root = (std::filesystem::current_path() / "extracted").string();
-    progress_open(1, "Rebuilding...");
-    progress_update(0, 1, tex_name);
-    std::thread([=]() {
-        auto tmpdir = std::filesystem::temp_directory_path() / "f2_tex_rebuild_one";
-        std::error_code ec;
-        std::filesystem::create_directories(tmpdir, ec);
-        auto out_path = std::filesystem::path(out_root) / tex_name;
-        std::filesystem::create_directories(out_path.parent_path(), ec);
-        auto tmp_h = tmpdir / "h.bin";
-        auto tmp_m = tmpdir / "m.bin";
-        auto tmp_r = tmpdir / "r.bin";
-        try {
-            extract_one(*p_headers, mapH.at(key), tmp_h.string());
-            if (mapM.count(key) && p_mip0) extract_one(*p_mip0, mapM.at(key), tmp_m.string());
-            extract_one(*p_rest, mapR.at(key), tmp_r.string());
-            std::ofstream out(out_path, std::ios::binary);
-            std::ifstream fh(tmp_h, std::ios::binary);
-            out << fh.rdbuf();
-            if (std::filesystem::exists(tmp_m)) {
-                std::ifstream fm(tmp_m, std::ios::binary);
-                out << fm.rdbuf();
-            }
-            std::ifstream fr(tmp_r, std::ios::binary);
-            out << fr.rdbuf();
-            std::filesystem::remove(tmp_h, ec);
-            if (std::filesystem::exists(tmp_m)) std::filesystem::remove(tmp_m, ec);
-            std::filesystem::remove(tmp_r, ec);
-        } catch (...) {
-        }
-        progress_update(1, 1, tex_name);
-        progress_done();
-        if (!S.cancel_requested) show_completion_box(
-            std::string("Rebuild complete.\n\nOutput folder:\n") + std::filesystem::absolute(out_root).string());
-        S.cancel_requested = false;
-    }).detach();
+    start_rebuild("Rebuilding...", "Rebuild complete.", "Texture not found in required BNKs.", out_root, false,
+                  [out_root, tex_name](RebuildPlan &plan, std::string &err) {
+                      std::vector<std::string> names{tex_name};
+                      return plan_texture_rebuild(&names, [&](const std::string &name) {
+                          return std::filesystem::path(out_root) / name;
+                      }, plan, err, RebuildMatch::Path);
+                  });
 }
 
 void on_rebuild_and_extract_one_mdl(const std::string &mdl_name) {
-    std::string bnk_to_use_body;
-    int body_index = -1;
-    bool is_nested = false;
+    auto out_root = (std::filesystem::current_path() / "extracted").string();
+    auto out_path_for = [out_root](const std::string &name) { return rebuilt_model_path(out_root, name); };
 
     if (S.selected_nested_index != -1 && !S.selected_nested_temp_path.empty()) {
-        is_nested = true;
-        bnk_to_use_body = S.selected_nested_temp_path;
-        body_index = S.selected_file_index;
-    }
-
-    auto p_headers = find_bnk_by_filename("globals_model_headers.bnk");
-    if (!p_headers) {
-        show_error_box("globals_model_headers.bnk not found.");
-        return;
-    }
-
-    std::string key = mdl_name;
-    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
-    std::replace(key.begin(), key.end(), '\\', '/');
-
-    BNKReader r_headers(*p_headers);
-    std::unordered_map<std::string, int> mapH;
-    for (size_t i = 0; i < r_headers.list_files().size(); ++i) {
-        auto &e = r_headers.list_files()[i];
-        std::string fname = e.name;
-        std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-        std::replace(fname.begin(), fname.end(), '\\', '/');
-        mapH.emplace(fname, (int)i);
-    }
-
-    if (!mapH.count(key)) {
-        show_error_box("Model header not found in globals_model_headers.bnk.");
+        std::vector<BNKItemUI> items{BNKItemUI{S.selected_file_index, mdl_name, 0}};
+        std::string nested_path = S.selected_nested_temp_path;
+        start_rebuild("Rebuilding model...", "Model rebuild complete.",
+                      "Model header not found in globals_model_headers.bnk.", out_root, false,
+                      [items, nested_path, out_path_for](RebuildPlan &plan, std::string &err) {
+                          return plan_nested_model_rebuild(items, nested_path, out_path_for, plan, err,
+                                                           RebuildMatch::Path);
+                      });
         return;
     }
 
-    if (!is_nested) {
-        auto p_rest = find_bnk_by_filename("globals_models.bnk");
-        if (!p_rest) {
-            show_error_box("globals_models.bnk not found.");
-            return;
-        }
-        BNKReader r_rest(*p_rest);
-        std::unordered_map<std::string, int> mapR;
-        for (size_t i = 0; i < r_rest.list_files().size(); ++i) {
-            auto &e = r_rest.list_files()[i];
-            std::string fname = e.name;
-            std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-            std::replace(fname.begin(), fname.end(), '\\', '/');
-            mapR.emplace(fname, (int)i);
-        }
-        if (!mapR.count(key)) {
-            show_error_box("Model not found in globals_models.bnk.");
-            return;
-        }
-        bnk_to_use_body = *p_rest;
-        body_index = mapR.at(key);
-    }
-
-    auto out_root = (std::filesystem::current_path() / "extracted").string();
-    progress_open(1, "Rebuilding model...");
-    progress_update(0, 1, mdl_name);
-
-    std::string p_headers_copy = *p_headers;
-    int header_index = mapH.at(key);
-
-    std::thread([=]() {
-        auto tmpdir = std::filesystem::temp_directory_path() / "f2_mdl_rebuild_one";
-        std::error_code ec;
-        std::filesystem::create_directories(tmpdir, ec);
-
-        std::string output_filename = apply_folder_prefix_to_filename(mdl_name, ".mdl");
-        auto out_dir = std::filesystem::path(out_root) / std::filesystem::path(mdl_name).parent_path();
-        auto out_path = out_dir / output_filename;
-        std::filesystem::create_directories(out_path.parent_path(), ec);
-
-        auto tmp_h = tmpdir / "h.bin";
-        auto tmp_r = tmpdir / "r.bin";
-
-        try {
-            extract_one(p_headers_copy, header_index, tmp_h.string());
-            extract_one(bnk_to_use_body, body_index, tmp_r.string());
-
-            std::ofstream out(out_path, std::ios::binary);
-            { std::ifstream fh(tmp_h, std::ios::binary); out << fh.rdbuf(); }
-            { std::ifstream fr(tmp_r, std::ios::binary); out << fr.rdbuf(); }
-
-            std::filesystem::remove(tmp_h, ec);
-            std::filesystem::remove(tmp_r, ec);
-        } catch (...) {}
-
-        progress_update(1, 1, mdl_name);
-        progress_done();
-        if (!S.cancel_requested)
-            show_completion_box(std::string("Model rebuild complete.\n\nOutput folder:\n") + std::filesystem::absolute(out_root).string());
-        S.cancel_requested = false;
-    }).detach();
+    start_rebuild("Rebuilding model...", "Model rebuild complete.", "Model not found in required BNKs.", out_root,
+                  false, [mdl_name, out_path_for](RebuildPlan &plan, std::string &err) {
+                      std::vector<std::string> names{mdl_name};
+                      return plan_model_rebuild(&names, out_path_for, plan, err, RebuildMatch::Path);
+                  });
 }
 
 void on_dump_all_global(const std::vector<GlobalHit>& hits) {
@@ -801,7 +404,7 @@ void on_dump_all_global(const std::vector<GlobalHit>& hits) {
 
 void on_export_wavs_global(const std::vector<GlobalHit>& hits) {
     std::vector<GlobalHit> audio_files;
-    for (auto &h: hits) if (is_audio_file(h.file_name)) audio_files.push_back(h);
+    for (auto &h: hits) if (h.type == AssetType::Wav) audio_files.push_back(h);
 
     if (audio_files.empty()) {
         show_error_box("No .wav files in filtered results.");
@@ -859,197 +462,43 @@ void on_export_wavs_global(const std::vector<GlobalHit>& hits) {
 }
 
 void on_rebuild_and_extract_global_tex(const std::vector<GlobalHit>& hits) {
-    auto p_headers = find_bnk_by_filename("globals_texture_headers.bnk");
-    auto p_mip0 = find_bnk_by_filename("1024mip0_textures.bnk");
-    auto p_rest = find_bnk_by_filename("globals_textures.bnk");
-    if (!p_headers || !p_rest) {
-        show_error_box("Required BNKs not found.");
-        return;
-    }
+    std::vector<std::string> tex_names;
+    for (auto &h: hits) if (h.type == AssetType::Tex) tex_names.push_back(h.file_name);
 
-    std::vector<GlobalHit> tex_files;
-    for (auto &h: hits) if (is_tex_file(h.file_name)) tex_files.push_back(h);
-
-    if (tex_files.empty()) {
+    if (tex_names.empty()) {
         show_error_box("No .tex files in filtered results.");
         return;
     }
 
     auto out_root = (std::filesystem::current_path() / "extracted").string();
-    int total = (int)tex_files.size();
-    progress_open(total, "Rebuilding...");
-    progress_update(0, total, "Starting...");
-
-    std::thread([tex_files, out_root, total, p_headers, p_mip0, p_rest]() {
-        BNKReader r_headers(*p_headers);
-        BNKReader r_rest(*p_rest);
-        std::optional<BNKReader> r_mip0;
-        if (p_mip0) r_mip0.emplace(*p_mip0);
-
-        std::unordered_map<std::string, int> mapH, mapR, mapM;
-        for (size_t i = 0; i < r_headers.list_files().size(); ++i) {
-            auto &e = r_headers.list_files()[i];
-            std::string fname = std::filesystem::path(e.name).filename().string();
-            std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-            mapH.emplace(fname, (int)i);
-        }
-        for (size_t i = 0; i < r_rest.list_files().size(); ++i) {
-            auto &e = r_rest.list_files()[i];
-            std::string fname = std::filesystem::path(e.name).filename().string();
-            std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-            mapR.emplace(fname, (int)i);
-        }
-        if (r_mip0) {
-            for (size_t i = 0; i < r_mip0->list_files().size(); ++i) {
-                auto &e = r_mip0->list_files()[i];
-                std::string fname = std::filesystem::path(e.name).filename().string();
-                std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-                mapM.emplace(fname, (int)i);
-            }
-        }
-
-        int done = 0;
-        auto tmpdir = std::filesystem::temp_directory_path() / "f2_tex_rebuild_global";
-        std::error_code ec;
-        std::filesystem::create_directories(tmpdir, ec);
-
-        for (auto &h : tex_files) {
-            if (S.cancel_requested || S.exiting) break;
-
-            std::string fname = std::filesystem::path(h.file_name).filename().string();
-            std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-
-            if (!mapH.count(fname) || !mapR.count(fname)) {
-                progress_update(++done, total, h.file_name);
-                continue;
-            }
-
-            auto out_path = std::filesystem::path(out_root) / h.file_name;
-            std::filesystem::create_directories(out_path.parent_path(), ec);
-
-            auto tmp_h = tmpdir / ("h_" + std::to_string(done) + ".bin");
-            auto tmp_m = tmpdir / ("m_" + std::to_string(done) + ".bin");
-            auto tmp_r = tmpdir / ("r_" + std::to_string(done) + ".bin");
-
-            try {
-                extract_one(*p_headers, mapH.at(fname), tmp_h.string());
-                if (mapM.count(fname) && p_mip0) extract_one(*p_mip0, mapM.at(fname), tmp_m.string());
-                extract_one(*p_rest, mapR.at(fname), tmp_r.string());
-
-                std::ofstream out(out_path, std::ios::binary);
-                std::ifstream fh(tmp_h, std::ios::binary);
-                out << fh.rdbuf();
-                if (std::filesystem::exists(tmp_m)) {
-                    std::ifstream fm(tmp_m, std::ios::binary);
-                    out << fm.rdbuf();
-                }
-                std::ifstream fr(tmp_r, std::ios::binary);
-                out << fr.rdbuf();
-
-                std::filesystem::remove(tmp_h, ec);
-                if (std::filesystem::exists(tmp_m)) std::filesystem::remove(tmp_m, ec);
-                std::filesystem::remove(tmp_r, ec);
-            } catch (...) {}
-
-            progress_update(++done, total, h.file_name);
-        }
-
-        progress_done();
-        if (!S.cancel_requested)
-            show_completion_box(std::string("Rebuild complete.\n\nOutput folder:\n") + std::filesystem::absolute(out_root).string());
-        S.cancel_requested = false;
-    }).detach();
+    start_rebuild("Rebuilding...", "Rebuild complete.", "No texture names found.", out_root, false,
+                  [tex_names, out_root](RebuildPlan &plan, std::string &err) {
+                      return plan_texture_rebuild(&tex_names, [&](const std::string &name) {
+                          return std::filesystem::path(out_root) / name;
+                      }, plan, err);
+                  });
 }
 
 void on_rebuild_and_extract_global_mdl(const std::vector<GlobalHit>& hits) {
-    std::vector<GlobalHit> mdl_files;
+    std::vector<std::string> mdl_names;
     for (auto &h: hits) {
-        std::string name_lower = h.file_name;
-        std::transform(name_lower.begin(), name_lower.end(), name_lower.begin(), ::tolower);
-        if (name_lower.size() >= 4 && name_lower.substr(name_lower.size() - 4) == ".mdl") {
-            mdl_files.push_back(h);
+        if (h.type == AssetType::Mdl) {
+            mdl_names.push_back(h.file_name);
         }
     }
 
-    if (mdl_files.empty()) {
+    if (mdl_names.empty()) {
         show_error_box("No .mdl files in filtered results.");
         return;
     }
 
-    auto p_headers = find_bnk_by_filename("globals_model_headers.bnk");
-    auto p_rest    = find_bnk_by_filename("globals_models.bnk");
-    if (!p_headers || !p_rest) {
-        show_error_box("Required BNKs not found.");
-        return;
-    }
-
     auto out_root = (std::filesystem::current_path() / "extracted").string();
-    int total = (int)mdl_files.size();
-    progress_open(total, "Rebuilding models...");
-    progress_update(0, total, "Starting...");
-
-    std::thread([mdl_files, out_root, total, p_headers, p_rest]() {
-        BNKReader r_headers(*p_headers);
-        BNKReader r_rest(*p_rest);
-
-        std::unordered_map<std::string, int> mapH, mapR;
-        for (size_t i = 0; i < r_headers.list_files().size(); ++i) {
-            auto &e = r_headers.list_files()[i];
-            std::string fname = std::filesystem::path(e.name).filename().string();
-            std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-            mapH.emplace(fname, (int)i);
-        }
-        for (size_t i = 0; i < r_rest.list_files().size(); ++i) {
-            auto &e = r_rest.list_files()[i];
-            std::string fname = std::filesystem::path(e.name).filename().string();
-            std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-            mapR.emplace(fname, (int)i);
-        }
-
-        int done = 0;
-        auto tmpdir = std::filesystem::temp_directory_path() / "f2_mdl_rebuild_global";
-        std::error_code ec;
-        std::filesystem::create_directories(tmpdir, ec);
-
-        for (auto &h : mdl_files) {
-            if (S.cancel_requested || S.exiting) break;
-
-            std::string fname = std::filesystem::path(h.file_name).filename().string();
-            std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-
-            if (!mapH.count(fname) || !mapR.count(fname)) {
-                progress_update(++done, total, h.file_name);
-                continue;
-            }
-
-            std::string output_filename = apply_folder_prefix_to_filename(h.file_name, ".mdl");
-            auto out_dir = std::filesystem::path(out_root) / std::filesystem::path(h.file_name).parent_path();
-            auto out_path = out_dir / output_filename;
-            std::filesystem::create_directories(out_path.parent_path(), ec);
-
-            auto tmp_h = tmpdir / ("h_" + std::to_string(done) + ".bin");
-            auto tmp_r = tmpdir / ("r_" + std::to_string(done) + ".bin");
-
-            try {
-                extract_one(*p_headers, mapH.at(fname), tmp_h.string());
-                extract_one(*p_rest, mapR.at(fname), tmp_r.string());
-
-                std::ofstream out(out_path, std::ios::binary);
-                { std::ifstream fh(tmp_h, std::ios::binary); out << fh.rdbuf(); }
-                { std::ifstream fr(tmp_r, std::ios::binary); out << fr.rdbuf(); }
-
-                std::filesystem::remove(tmp_h, ec);
-                std::filesystem::remove(tmp_r, ec);
-            } catch (...) {}
-
-            progress_update(++done, total, h.file_name);
-        }
-
-        progress_done();
-        if (!S.cancel_requested)
-            show_completion_box(std::string("Model rebuild complete.\n\nOutput folder:\n") + std::filesystem::absolute(out_root).string());
-        S.cancel_requested = false;
-    }).detach();
+    start_rebuild("Rebuilding models...", "Model rebuild complete.", "No model names found.", out_root, false,
+                  [mdl_names, out_root](RebuildPlan &plan, std::string &err) {
+                      return plan_model_rebuild(&mdl_names, [&](const std::string &name) {
+                          return rebuilt_model_path(out_root, name);
+                      }, plan, err);
+                  });
 }
 
 void on_extract_adb_selected() {
@@ -1162,19 +611,18 @@ void on_export_mdl_to_glb() {
 
     auto item = S.files[(size_t)idx];
     std::string name = item.name;
-    std::string name_lower = name;
-    std::transform(name_lower.begin(), name_lower.end(), name_lower.begin(), ::tolower);
 
-    if (name_lower.size() < 4 || name_lower.substr(name_lower.size() - 4) != ".mdl") {
+    if (item.type != AssetType::Mdl) {
         show_error_box("Selected file is not .mdl");
         return;
     }
 
     auto base_out = (std::filesystem::current_path() / "exported_glb").string();
+    GlbExportOptions opts = glb_export_options();
     progress_open(1, "Exporting GLB...");
     progress_update(0, 1, name);
 
-    std::thread([item, name, base_out]() {
+    std::thread([item, name, base_out, opts]() {
         if (!S.cancel_requested && !S.exiting) {
             try {
                 std::vector<unsigned char> mdl_buf;
@@ -1189,7 +637,7 @@ void on_export_mdl_to_glb() {
                 std::filesystem::create_directories(out_path.parent_path());
 
                 std::string err;
-                if (!mdl_to_glb_full(mdl_buf, out_path.string(), name, err)) {
+                if (!mdl_to_glb_full(mdl_buf, out_path.string(), name, err, opts)) {
                     progress_done();
                     show_error_box("GLB export failed: " + err);
                     return;
@@ -1214,9 +662,7 @@ void on_export_mdl_to_glb() {
 void on_export_all_mdl_to_glb() {
     std::vector<BNKItemUI> mdl_files;
     for (auto &f: S.files) {
-        std::string name_lower = f.name;
-        std::transform(name_lower.begin(), name_lower.end(), name_lower.begin(), ::tolower);
-        if (name_lower.size() >= 4 && name_lower.substr(name_lower.size() - 4) == ".mdl") {
+        if (f.type == AssetType::Mdl) {
             mdl_files.push_back(f);
         }
     }
@@ -1228,13 +674,15 @@ void on_export_all_mdl_to_glb() {
 
     auto base_out = (std::filesystem::current_path() / "exported_glb").string();
     int total = (int)mdl_files.size();
+    GlbExportOptions opts = glb_export_options();
     progress_open(total, "Exporting GLBs...");
     progress_update(0, total, "Starting...");
 
-    std::thread([mdl_files, base_out, total]() {
+    std::thread([mdl_files, base_out, total, opts]() {
         std::atomic<int> done{0};
         std::mutex fail_m;
         std::vector<std::string> failed;
+        GlbExportOptions model_opts = opts;
 
         auto work = [&](const BNKItemUI &it) {
             if (S.cancel_requested || S.exiting) return;
@@ -1251,7 +699,7 @@ void on_export_all_mdl_to_glb() {
                 std::filesystem::create_directories(out_path.parent_path());
 
                 std::string err;
-                if (!mdl_to_glb_full(mdl_buf, out_path.string(), it.name, err)) {
+                if (!mdl_to_glb_full(mdl_buf, out_path.string(), it.name, err, model_opts)) {
                     std::lock_guard<std::mutex> lk(fail_m);
                     failed.push_back(it.name);
                 }
@@ -1266,6 +714,7 @@ void on_export_all_mdl_to_glb() {
         if (!S.cancel_requested) {
             std::vector<std::thread> pool;
             int n = std::min(4, std::max(1, (int)std::thread::hardware_concurrency() / 2));
+            model_opts.max_threads = std::max(1, (int)std::thread::hardware_concurrency() / n);
             std::atomic<size_t> i{0};
             for (int t = 0; t < n; ++t) pool.emplace_back([&]() {
                 for (;;) {
@@ -1291,9 +740,7 @@ void on_export_all_mdl_to_glb() {
 void on_export_global_mdl_to_glb(const std::vector<GlobalHit>& hits) {
     std::vector<GlobalHit> mdl_files;
     for (auto &h: hits) {
-        std::string name_lower = h.file_name;
-        std::transform(name_lower.begin(), name_lower.end(), name_lower.begin(), ::tolower);
-        if (name_lower.size() >= 4 && name_lower.substr(name_lower.size() - 4) == ".mdl") {
+        if (h.type == AssetType::Mdl) {
             mdl_files.push_back(h);
         }
     }
@@ -1305,13 +752,15 @@ void on_export_global_mdl_to_glb(const std::vector<GlobalHit>& hits) {
 
     auto base_out = (std::filesystem::current_path() / "exported_glb").string();
     int total = (int)mdl_files.size();
+    GlbExportOptions opts = glb_export_options();
     progress_open(total, "Exporting GLBs...");
     progress_update(0, total, "Starting...");
 
-    std::thread([mdl_files, base_out, total]() {
+    std::thread([mdl_files, base_out, total, opts]() {
         std::atomic<int> done{0};
         std::mutex fail_m;
         std::vector<std::string> failed;
+        GlbExportOptions model_opts = opts;
 
         auto work = [&](const GlobalHit &h) {
             if (S.cancel_requested || S.exiting) return;
@@ -1328,7 +777,7 @@ void on_export_global_mdl_to_glb(const std::vector<GlobalHit>& hits) {
                 std::filesystem::create_directories(out_path.parent_path());
 
                 std::string err;
-                if (!mdl_to_glb_full(mdl_buf, out_path.string(), h.file_name, err)) {
+                if (!mdl_to_glb_full(mdl_buf, out_path.string(), h.file_name, err, model_opts)) {
                     std::lock_guard<std::mutex> lk(fail_m);
                     failed.push_back(h.file_name);
                 }
@@ -1343,6 +792,7 @@ void on_export_global_mdl_to_glb(const std::vector<GlobalHit>& hits) {
         if (!S.cancel_requested) {
             std::vector<std::thread> pool;
             int n = std::min(4, std::max(1, (int)std::thread::hardware_concurrency() / 2));
+            model_opts.max_threads = std::max(1, (int)std::thread::hardware_concurrency() / n);
             std::atomic<size_t> i{0};
             for (int t = 0; t < n; ++t) pool.emplace_back([&]() {
                 for (;;) {
@@ -8,6 +8,8 @@ struct GlobalHit {
     std::string file_name;
     int index;
     uint32_t size;
+    InternedName folded{};
+    AssetType type = AssetType::Other;
 };
 
 void extract_file_one(const std::string &bnk_path, const BNKItemUI &item, const std::string &base_out_dir, bool convert_audio = true);
@@ -7,11 +7,23 @@
 #include <d3d11.h>
 #include "imgui_hex.h"
 #include "ModelParser.h"
+#include "Names.h"
+#include "Files.h"
 
 struct BNKItemUI {
     int index;
     std::string name;
     uint32_t size;
+    InternedName folded{};
+    AssetType type = AssetType::Other;
+};
+
+// What the texture rebuild operations write for each texture.
+enum class TexExportFormat : uint8_t {
+    Tex = 0,  // the rebuilt .tex bitstream as the game stores it
+    DDS,      // every raw mip, byte-swapped into a DX10 DDS
+    PNG,      // largest mip decoded, deflated
+    QOI,      // largest mip decoded, QOI for fast bulk dumps
 };
 
 struct TexInfo {
@@ -53,6 +65,21 @@ struct State {
     std::string root_dir;
     std::vector<std::string> bnk_paths;
     std::vector<std::string> adb_paths;
+    std::vector<InternedName> bnk_names;
+    ScanResult last_scan;
+    // Bumped on the UI thread whenever the root or its archives change. The
+    // only catalog field workers may read; they compare it, nothing else.
+    std::atomic<uint32_t> catalog_gen{0};
+    // catalog_gen at the last full rescan; archives that changed after it
+    // are listed in catalog_changes with the generation that saw them.
+    uint32_t catalog_reset_gen = 0;
+    std::vector<std::pair<uint32_t, std::string>> catalog_changes;
+    bool watch_root = false;
+    TexExportFormat tex_export_format = TexExportFormat::Tex;
+    bool show_thumb_grid = false;
+    bool glb_optimize_meshes = true;
+    int glb_lod_levels = 0;
+    float glb_lod_ratio = 0.5f;
     std::string bnk_filter;
     std::string selected_bnk;
     std::string selected_nested_bnk;
@@ -89,6 +116,15 @@ struct State {
     bool show_preview_popup = false;
     int preview_mip_index = -1;
     ID3D11ShaderResourceView *preview_srv = nullptr;
+    // Progressive texture preview: the loader posts each sharper stage here
+    // and the UI thread swaps it into hex_data. Loaders holding an older
+    // ticket stop before reading further.
+    std::atomic<uint64_t> preview_ticket{0};
+    std::mutex preview_stage_mutex;
+    std::vector<unsigned char> preview_stage_data;
+    TexInfo preview_stage_info;
+    bool preview_stage_ready = false;
+    bool preview_stage_first = false;
     std::string hex_file_path;
 
     bool mdl_info_ok = false;
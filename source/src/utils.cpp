@@ -2,91 +2,139 @@
 #include "State.h"
 #include <algorithm>
 #include <filesystem>
+#include <thread>
+#include <atomic>
 
 bool is_audio_file(const std::string &n) {
-    std::string s = n;
-    std::transform(s.begin(), s.end(), s.begin(), ::tolower);
-    return s.size() >= 4 && s.rfind(".wav") == s.size() - 4;
+    return classify_asset(n) == AssetType::Wav;
 }
 
 bool is_tex_file(const std::string &n) {
-    std::string s = n;
-    std::transform(s.begin(), s.end(), s.begin(), ::tolower);
-    return s.size() >= 4 && s.rfind(".tex") == s.size() - 4;
+    return classify_asset(n) == AssetType::Tex;
 }
 
 bool is_mdl_file(const std::string &n) {
-    std::string s = n;
-    std::transform(s.begin(), s.end(), s.begin(), ::tolower);
-    return s.size() >= 4 && s.rfind(".mdl") == s.size() - 4;
+    return classify_asset(n) == AssetType::Mdl;
+}
+
+namespace {
+    enum class BnkKind { None, Model, Texture };
+
+    // The selected BNK only changes on user action; classify it once per change.
+    BnkKind selected_bnk_kind() {
+        static std::string cached_path;
+        static BnkKind cached_kind = BnkKind::None;
+        if (S.selected_bnk == cached_path) return cached_kind;
+        cached_path = S.selected_bnk;
+        cached_kind = BnkKind::None;
+        if (cached_path.empty()) return cached_kind;
+
+        std::string b = fold_case(std::filesystem::path(cached_path).filename().string());
+        if (b == "globals_model_headers.bnk" || b == "globals_models.bnk") {
+            cached_kind = BnkKind::Model;
+        } else if (b == "globals_texture_headers.bnk" || b == "1024mip0_textures.bnk" || b == "globals_textures.bnk" ||
+                   b == "gui_texture_headers.bnk" || b == "gui_textures.bnk" || b == "textures.bnk" ||
+                   b.find("_texture_headers.bnk") != std::string::npos) {
+            cached_kind = BnkKind::Texture;
+        }
+        return cached_kind;
+    }
 }
 
 bool is_model_bnk_selected() {
-    if (S.selected_bnk.empty()) return false;
-    std::string b = std::filesystem::path(S.selected_bnk).filename().string();
-    std::transform(b.begin(), b.end(), b.begin(), ::tolower);
-    return b == "globals_model_headers.bnk" || b == "globals_models.bnk";
+    return selected_bnk_kind() == BnkKind::Model;
 }
 
 bool is_texture_bnk_selected() {
-    if (S.selected_bnk.empty()) return false;
-    std::string b = std::filesystem::path(S.selected_bnk).filename().string();
-    std::transform(b.begin(), b.end(), b.begin(), ::tolower);
-    return b == "globals_texture_headers.bnk" || b == "1024mip0_textures.bnk" || b == "globals_textures.bnk" ||
-           b == "gui_texture_headers.bnk" || b == "gui_textures.bnk" || b == "textures.bnk" ||
-           b.find("_texture_headers.bnk") != std::string::npos;
+    return selected_bnk_kind() == BnkKind::Texture;
 }
 
-std::vector<std::string> filtered_bnk_paths() {
-    if (S.bnk_filter.empty()) return S.bnk_paths;
-    std::vector<std::string> out;
-    out.reserve(S.bnk_paths.size());
-    std::string q = S.bnk_filter;
-    std::transform(q.begin(), q.end(), q.begin(), ::tolower);
-    for (auto &p: S.bnk_paths) {
-        auto b = std::filesystem::path(p).filename().string();
-        std::string t = b;
-        std::transform(t.begin(), t.end(), t.begin(), ::tolower);
-        if (t.find(q) != std::string::npos) out.push_back(p);
-    }
-    return out;
+void index_bnk_paths() {
+    S.bnk_names.clear();
+    S.bnk_names.reserve(S.bnk_paths.size());
+    for (auto &p: S.bnk_paths)
+        S.bnk_names.push_back(intern_folded(std::filesystem::path(p).filename().string()));
 }
 
-bool name_matches_filter(const std::string &name, const std::string &filter) {
-    if (filter.empty()) return true;
-    std::string n = name, f = filter;
-    std::transform(n.begin(), n.end(), n.begin(), ::tolower);
-    std::transform(f.begin(), f.end(), f.begin(), ::tolower);
-    return n.find(f) != std::string::npos;
+const std::vector<int> &filtered_bnk_rows() {
+    static std::vector<int> rows;
+    static std::string last_filter;
+    static const void *last_names = nullptr;
+    static size_t last_count = (size_t) -1;
+    static uint32_t last_gen = 0;
+
+    if (S.bnk_names.size() != S.bnk_paths.size()) index_bnk_paths();
+    if (last_names == S.bnk_names.data() && last_count == S.bnk_names.size() && last_gen == S.catalog_gen &&
+        last_filter == S.bnk_filter)
+        return rows;
+
+    last_names = S.bnk_names.data();
+    last_count = S.bnk_names.size();
+    last_gen = S.catalog_gen;
+    last_filter = S.bnk_filter;
+    std::string q = fold_case(S.bnk_filter);
+    rows.clear();
+    rows.reserve(S.bnk_names.size());
+    for (size_t i = 0; i < S.bnk_names.size(); ++i)
+        if (folded_contains(S.bnk_names[i].text, q)) rows.push_back((int) i);
+    return rows;
 }
 
-int count_visible_files() {
-    int c = 0;
-    for (auto &f: S.files) if (name_matches_filter(f.name, S.file_filter)) ++c;
-    return c;
+BNKItemUI make_bnk_item(int index, const std::string &name, uint32_t size) {
+    BNKItemUI it{index, name, size};
+    it.folded = intern_folded(name);
+    it.type = classify_asset(name);
+    return it;
+}
+
+bool name_matches_filter(const std::string &name, const std::string &filter) {
+    if (filter.empty()) return true;
+    return folded_contains(fold_case(name), fold_case(filter));
 }
 
 bool any_wav_in_bnk() {
-    for (auto &f: S.files) if (is_audio_file(f.name)) return true;
+    for (auto &f: S.files) if (f.type == AssetType::Wav) return true;
     return false;
 }
 
 bool any_tex_in_bnk() {
-    for (auto &f: S.files) if (is_tex_file(f.name)) return true;
+    for (auto &f: S.files) if (f.type == AssetType::Tex) return true;
     return false;
 }
 
 bool any_mdl_in_bnk() {
-    for (auto &f : S.files) if (is_mdl_file(f.name)) return true;
+    for (auto &f : S.files) if (f.type == AssetType::Mdl) return true;
     return false;
 }
 
 std::optional<std::string> find_bnk_by_filename(const std::string &fname_lower) {
+    if (S.bnk_names.size() == S.bnk_paths.size()) {
+        for (size_t i = 0; i < S.bnk_names.size(); ++i)
+            if (S.bnk_names[i].text == fname_lower) return S.bnk_paths[i];
+        return std::nullopt;
+    }
     for (auto &p: S.bnk_paths) {
-        std::string b = std::filesystem::path(p).filename().string();
-        std::transform(b.begin(), b.end(), b.begin(), ::tolower);
-        if (b == fname_lower) return p;
+        if (fold_case(std::filesystem::path(p).filename().string()) == fname_lower) return p;
     }
     return std::nullopt;
 }
 
+void parallel_for(size_t count, const std::function<void(size_t)> &fn, int max_threads) {
+    if (count == 0) return;
+    int n = std::min(max_threads, std::max(1, (int) std::thread::hardware_concurrency()));
+    if ((size_t) n > count) n = (int) count;
+    if (n <= 1) {
+        for (size_t k = 0; k < count; ++k) fn(k);
+        return;
+    }
+    std::vector<std::thread> pool;
+    std::atomic<size_t> i{0};
+    for (int t = 0; t < n; ++t) pool.emplace_back([&]() {
+        for (;;) {
+            size_t k = i.fetch_add(1);
+            if (k >= count) break;
+            fn(k);
+        }
+    });
+    for (auto &th: pool) th.join();
+}
@@ -2,16 +2,21 @@
 #include <string>
 #include <vector>
 #include <optional>
+#include <functional>
+
+struct BNKItemUI;
 
 bool is_audio_file(const std::string &n);
 bool is_tex_file(const std::string &n);
 bool is_mdl_file(const std::string &n);
 bool is_texture_bnk_selected();
 bool is_model_bnk_selected();
-std::vector<std::string> filtered_bnk_paths();
+const std::vector<int> &filtered_bnk_rows();
+void index_bnk_paths();
+BNKItemUI make_bnk_item(int index, const std::string &name, uint32_t size);
 bool name_matches_filter(const std::string &name, const std::string &filter);
-int count_visible_files();
 bool any_wav_in_bnk();
 bool any_tex_in_bnk();
 bool any_mdl_in_bnk();
-std::optional<std::string> find_bnk_by_filename(const std::string &fname_lower);
\ No newline at end of file
+std::optional<std::string> find_bnk_by_filename(const std::string &fname_lower);
+void parallel_for(size_t count, const std::function<void(size_t)> &fn, int max_threads = 8);